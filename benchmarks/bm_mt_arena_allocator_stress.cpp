@@ -42,6 +42,7 @@ struct queue_status_t {
 };
 
 using lock_free_arena = lock_free::arena_allocator<data_item_t,uint64_t, 10000, 10000, 0, 10000/3 >;
+//using lock_free_arena = lock_free::arena_allocator<data_item_t,uint64_t, 10000, 10000, 0, 10000/3, core::default_allocator<uint64_t>, 64 >;
 using status_queue    = std::queue<queue_status_t>;
 
 
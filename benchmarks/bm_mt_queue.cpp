@@ -3,8 +3,10 @@
 #include <iostream>
 #include <syncstream>
 #include <queue>
+#include <cstdlib>
 
 #include "core/utils.h"
+#include "core/stop_watch.h"
 #include "queue.h"
 
 /**
@@ -47,34 +49,66 @@ struct queue_status_t {
 //using lock_free_queue = typename lock_free::queue<uint32_t,uint32_t, core::ds_impl_t::raw, 1000000, 1000000, 0 >;
 //using lock_free_queue = typename lock_free::queue<uint32_t,uint32_t, core::ds_impl_t::mutex, 1000000, 1000000, 0 >;
 //using lock_free_queue = typename lock_free::queue<uint32_t,uint32_t, core::ds_impl_t::spinlock, 1000000, 1000000, 0 >;
+//using lock_free_queue = typename lock_free::queue<uint32_t,uint32_t, core::ds_impl_t::adaptive, 1000000, 1000000, 0 >;
 using lock_free_queue = typename lock_free::queue<uint32_t,uint32_t, core::ds_impl_t::lockfree, 1000000, 1000000, 0 >;
+// many producers and a single consumer, run with: bm_mt_queue <producers> 1
+//using lock_free_queue = typename lock_free::queue<uint32_t,uint32_t, core::ds_impl_t::mpsc, 1000000, 1000000, 0 >;
+// _head and _tail sharing the same cache line
+//using lock_free_queue = typename lock_free::queue<uint32_t,uint32_t, core::ds_impl_t::lockfree, 1000000, 1000000, 0, lock_free::arena_allocator<core::node_t<uint32_t,false,true,true>, uint32_t, 1000000, 1000000, 0, (1000000 / 3)>, core::no_reclaimer, core::layout_t::compact >;
+// nodes aligned to a cache line
+//using lock_free_queue = typename lock_free::queue<uint32_t,uint32_t, core::ds_impl_t::lockfree, 1000000, 1000000, 0, lock_free::arena_allocator<core::node_t<uint32_t,false,true,true,core::cache_line_size>, uint32_t, 1000000, 1000000, 0, (1000000 / 3)> >;
 
 using status_queue    = typename std::queue<queue_status_t>;
 
+// elapsed time is checked once every time_check_cycles, so that now() doesn't weigh on each operation.
+static constexpr const uint32_t time_check_cycles = 1024;
+
+// push() and pop() latencies in nanoseconds, each thread records in its own histogram and merge it at the end. 
+static core::histogram  push_latency;
+static core::histogram  pop_latency;
+
+static void print_latency( const char* name, const core::histogram& hist )
+{
+  std::osyncstream(std::cout) << name << " latency ns - count : [" << hist.count() 
+                                      << "] - p50 : [" << hist.percentile(50.0) 
+                                      << "] - p99 : [" << hist.percentile(99.0) 
+                                      << "] - p99.9 : [" << hist.percentile(99.9) 
+                                      << "] - max : [" << hist.max() << "]" << std::endl;
+}
+
 
 static void th_main_producer( uint32_t th_num, uint32_t run_time, lock_free_queue* q )
 {
   uint32_t     failures   = 0;
   uint32_t     successes  = 0;
   uint32_t     cycles     = 0;
+  core::histogram      latency;
+  core::tsc_stop_watch sw;
 
   auto th_start_ms = core::utils::now<std::chrono::milliseconds>();
 
   //double last_mon  = th_start_ms;
   for (;;)
   {
+    sw.reset();
     if ( q->push(th_num+1) == core::result_t::eFailure )
       ++failures;
     else
       ++successes;
+    sw.lap( latency );
     
     ++cycles;
 
+    if ( ( cycles % time_check_cycles ) != 0 )
+      continue;
+
     auto th_end_ms = core::utils::now<std::chrono::milliseconds>();
     if (double(th_end_ms-th_start_ms) >= run_time)
       break;
   }
 
+  push_latency.merge( latency );
+
   auto th_end_ms = core::utils::now<std::chrono::milliseconds>();
 
   std::osyncstream(std::cout) << "P TH [" <<  th_num <<  "] cycles : [" << cycles << "] - successes : [" << successes << "] - failures : [" << failures << "] - duration: " << double(th_end_ms-th_start_ms)/1000 << std::endl;
@@ -87,13 +121,19 @@ void th_main_consumer( uint32_t th_num, uint32_t run_time, lock_free_queue* q )
   uint32_t     got_doublefree  = 0;
   uint32_t     successes       = 0;
   uint32_t     cycles          = 0;
+  core::histogram      latency;
+  core::tsc_stop_watch sw;
 
   auto th_start_ms = core::utils::now<std::chrono::milliseconds>();
 
   //double last_mon  = th_start_ms;
   for (;;)
   {
-    switch (q->pop(dit_pop))
+    sw.reset();
+    const core::result_t result = q->pop(dit_pop);
+    sw.lap( latency );
+
+    switch (result)
     {
       case core::result_t::eEmpty:
         ++got_empty;
@@ -111,11 +151,16 @@ void th_main_consumer( uint32_t th_num, uint32_t run_time, lock_free_queue* q )
 
     ++cycles;
 
+    if ( ( cycles % time_check_cycles ) != 0 )
+      continue;
+
     auto th_end_ms = core::utils::now<std::chrono::milliseconds>();
     if (double(th_end_ms-th_start_ms) >= run_time)
       break;
   }
 
+  pop_latency.merge( latency );
+
   auto th_end_ms = core::utils::now<std::chrono::milliseconds>();
 
   std::osyncstream(std::cout) << "C TH [" <<  th_num <<  "] cycles : [" << cycles 
@@ -160,17 +205,17 @@ void th_main_monitor( status_queue* mon, uint32_t mon_time, uint32_t run_time, l
  */
 int main( int argc, const char* argv[] )
 { 
-  (void)argc;
-  (void)argv;
-
   lock_free_queue queue;
   status_queue    mon_queue;
 
-  uint32_t producers      = 1;
-  uint32_t consumers      = 5;//5;
+  // bm_mt_queue [producers] [consumers]
+  uint32_t producers      = (argc > 1)?static_cast<uint32_t>(std::atoi(argv[1])):1;
+  uint32_t consumers      = (argc > 2)?static_cast<uint32_t>(std::atoi(argv[2])):5;
   uint32_t mon_time_ms    = 1000;
   uint32_t run_time_ms    = 10000;       // milliseconds
 
+  core::tsc_clock::calibrate( std::chrono::milliseconds(100) );
+
   std::vector<std::thread>  vec_producers;
   std::vector<std::thread>  vec_consumers;
 
@@ -195,6 +240,8 @@ int main( int argc, const char* argv[] )
   th_mon.join();
 
   std::osyncstream(std::cout) << "NOT CONSUMED ITEMS = " << queue.size() << std::endl;
+  print_latency( "PUSH", push_latency );
+  print_latency( "POP ", pop_latency );
   std::osyncstream(std::cout) << std::endl;
   std::osyncstream(std::cout) << "----------------------------" << std::endl;
   std::osyncstream(std::cout) << std::endl;
@@ -0,0 +1,304 @@
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include <nanobench.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+# include <pthread.h>
+# include <sched.h>
+#endif
+
+#include "core/mutex.h"
+#include "queue.h"
+#include "ring_buffer.h"
+
+/**
+ * Benchmark suite comparing all queue implementations with the same workload, and with
+ * std::queue protected by std::mutex and ring_buffer as baselines.
+ *
+ * Each run moves a fixed number of items from producers to consumers and it is repeated for:
+ * - each ds_impl_t variant, mpsc only with a single consumer and raw only single threaded;
+ * - 1..max_producers x 1..max_consumers threads, doubling each time;
+ * - payloads of 8, 56 and 248 bytes, so that nodes take 16, 64 and 256 bytes;
+ * - chunk_size and alloc_threshold of the arena used by the lockfree queue.
+ *
+ * Threads are pinned to cpus in round robin, results are printed and written to
+ * bm_suite.csv and bm_suite.json.
+ *
+ * usage: bm_suite [max_producers] [max_consumers] [items]
+ */
+
+/**
+ * @brief Payload of @tparam words 64 bits words, written and read on each push and pop.
+ */
+template<std::size_t words>
+struct payload_t {
+  constexpr payload_t() noexcept
+    : data{}
+  {}
+
+  constexpr explicit payload_t( uint64_t value ) noexcept
+  {
+    for ( std::size_t i = 0; i < words; ++i )
+      data[i] = value;
+  }
+
+  uint64_t  data[words];
+};
+
+/**
+ * @brief Baseline, std::queue protected by std::mutex.
+ */
+template<typename data_t>
+class std_queue_mutex {
+public:
+  bool push( data_t&& data )
+  {
+    std::lock_guard<std::mutex> lock(_mtx);
+    _queue.push( std::move(data) );
+    return true;
+  }
+
+  bool pop( data_t& data )
+  {
+    std::lock_guard<std::mutex> lock(_mtx);
+    if ( _queue.empty() )
+      return false;
+    data = std::move(_queue.front());
+    _queue.pop();
+    return true;
+  }
+
+private:
+  std::mutex          _mtx;
+  std::queue<data_t>  _queue;
+};
+
+static constexpr const uint32_t reserve_items = 65536;
+
+template<typename data_t, core::ds_impl_t imp_type, uint32_t chunk_size = 1024, uint32_t alloc_threshold = (chunk_size / 3)>
+using ds_queue = lock_free::queue<data_t, uint32_t, imp_type, chunk_size, reserve_items, 0,
+                                  lock_free::arena_allocator<core::node_t<data_t,false,true,core::ds_is_lockfree<imp_type>>, uint32_t, chunk_size, reserve_items, 0, alloc_threshold>>;
+
+template<typename data_t, core::access_t access = core::access_t::mpmc>
+using ds_ring = lock_free::ring_buffer<data_t, uint32_t, reserve_items, access>;
+
+/**
+ * @brief lock_free::queue return core::result_t, ring_buffer and baselines return bool.
+ */
+template<typename result_t>
+static inline bool succeeded( result_t result ) noexcept
+{
+  if constexpr ( std::is_same_v<result_t,bool> )
+    return result;
+  else
+    return ( result == core::result_t::eSuccess );
+}
+
+/**
+ * @brief Pin the calling thread to cpu @param index modulo the number of cpus, only on linux.
+ */
+static void pin_thread( uint32_t index ) noexcept
+{
+#if defined(__linux__)
+  const uint32_t cpus = std::max( std::thread::hardware_concurrency(), 1u );
+  cpu_set_t      cpu_set;
+  CPU_ZERO( &cpu_set );
+  CPU_SET( index % cpus, &cpu_set );
+  (void)pthread_setaffinity_np( pthread_self(), sizeof(cpu_set), &cpu_set );
+#else
+  (void)index;
+#endif
+}
+
+/**
+ * @brief Wait for room or items, yielding since threads can be more than cpus.
+ */
+static inline void backoff( uint32_t& spins ) noexcept
+{
+  if ( ++spins < 64 )
+    core::cpu_relax();
+  else
+  {
+    spins = 0;
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * @brief Push and pop @param items from the calling thread, all structures including raw are compared.
+ */
+template<typename queue_t, typename data_t>
+static void run_single_thread( ankerl::nanobench::Bench& bench, const std::string& name, uint32_t items )
+{
+  auto queue = std::make_unique<queue_t>();
+
+  bench.batch( 2*items ).unit("op").run( name + " 1 thread", [&] {
+    data_t   data;
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+
+    // half of a ring buffer is filled each round, so that bounded and unbounded structures do the same work.
+    while ( popped < items )
+    {
+      const uint32_t round = std::min( items - pushed, reserve_items / 2 );
+      for ( uint32_t i = 0; i < round; ++i )
+        pushed += succeeded( queue->push( data_t(i) ) )?1:0;
+      while ( ( popped < pushed ) && succeeded( queue->pop( data ) ) )
+        ++popped;
+    }
+
+    ankerl::nanobench::doNotOptimizeAway( data );
+  });
+}
+
+/**
+ * @brief Move @param items from @param producers threads to @param consumers threads.
+ */
+template<typename queue_t, typename data_t>
+static void run_multi_thread( ankerl::nanobench::Bench& bench, const std::string& name,
+                              uint32_t producers, uint32_t consumers, uint32_t items )
+{
+  auto queue = std::make_unique<queue_t>();
+
+  const std::string title = name + " " + std::to_string(producers) + "P x " + std::to_string(consumers) + "C";
+
+  bench.batch( items ).unit("item").run( title, [&] {
+    std::atomic<uint32_t>     consumed{0};
+    std::vector<std::thread>  threads;
+    threads.reserve( producers+consumers );
+
+    for ( uint32_t ndx = 0; ndx < producers; ++ndx )
+    {
+      threads.emplace_back( [&, ndx]() {
+        pin_thread( ndx );
+
+        // first producer takes care of the remainder.
+        const uint32_t count = items / producers + ( ( ndx == 0 )?(items % producers):0 );
+        uint32_t       spins = 0;
+        for ( uint32_t i = 0; i < count; ++i )
+        {
+          while ( !succeeded( queue->push( data_t(i) ) ) )
+            backoff( spins );
+        }
+      });
+    }
+
+    for ( uint32_t ndx = 0; ndx < consumers; ++ndx )
+    {
+      threads.emplace_back( [&, ndx]() {
+        pin_thread( producers+ndx );
+
+        data_t   data;
+        uint32_t spins = 0;
+        while ( consumed.load( std::memory_order_relaxed ) < items )
+        {
+          if ( succeeded( queue->pop( data ) ) )
+            consumed.fetch_add( 1, std::memory_order_relaxed );
+          else
+            backoff( spins );
+        }
+        ankerl::nanobench::doNotOptimizeAway( data );
+      });
+    }
+
+    for ( auto& th : threads )
+      th.join();
+  });
+}
+
+/**
+ * @brief All structures and arena configurations for @tparam data_t payload.
+ */
+template<typename data_t>
+static void run_payload( ankerl::nanobench::Bench& bench, uint32_t max_producers, uint32_t max_consumers, uint32_t items )
+{
+  const std::string payload = " " + std::to_string(sizeof(data_t)) + "B";
+
+  run_single_thread<ds_queue<data_t,core::ds_impl_t::raw>,      data_t>( bench, "queue raw"       + payload, items );
+  run_single_thread<ds_queue<data_t,core::ds_impl_t::mutex>,    data_t>( bench, "queue mutex"     + payload, items );
+  run_single_thread<ds_queue<data_t,core::ds_impl_t::spinlock>, data_t>( bench, "queue spinlock"  + payload, items );
+  run_single_thread<ds_queue<data_t,core::ds_impl_t::adaptive>, data_t>( bench, "queue adaptive"  + payload, items );
+  run_single_thread<ds_queue<data_t,core::ds_impl_t::lockfree>, data_t>( bench, "queue lockfree"  + payload, items );
+  run_single_thread<ds_queue<data_t,core::ds_impl_t::mpsc>,     data_t>( bench, "queue mpsc"      + payload, items );
+  run_single_thread<std_queue_mutex<data_t>,                    data_t>( bench, "std::queue+mutex"+ payload, items );
+  run_single_thread<ds_ring<data_t>,                            data_t>( bench, "ring_buffer"     + payload, items );
+
+  for ( uint32_t producers = 1; producers <= max_producers; producers *= 2 )
+  {
+    for ( uint32_t consumers = 1; consumers <= max_consumers; consumers *= 2 )
+    {
+      run_multi_thread<ds_queue<data_t,core::ds_impl_t::mutex>,    data_t>( bench, "queue mutex"     + payload, producers, consumers, items );
+      run_multi_thread<ds_queue<data_t,core::ds_impl_t::spinlock>, data_t>( bench, "queue spinlock"  + payload, producers, consumers, items );
+      run_multi_thread<ds_queue<data_t,core::ds_impl_t::adaptive>, data_t>( bench, "queue adaptive"  + payload, producers, consumers, items );
+      run_multi_thread<ds_queue<data_t,core::ds_impl_t::lockfree>, data_t>( bench, "queue lockfree"  + payload, producers, consumers, items );
+      if ( consumers == 1 )
+      { run_multi_thread<ds_queue<data_t,core::ds_impl_t::mpsc>,   data_t>( bench, "queue mpsc"      + payload, producers, consumers, items ); }
+      run_multi_thread<std_queue_mutex<data_t>,                    data_t>( bench, "std::queue+mutex"+ payload, producers, consumers, items );
+      run_multi_thread<ds_ring<data_t>,                            data_t>( bench, "ring_buffer"     + payload, producers, consumers, items );
+      if ( ( producers == 1 ) && ( consumers == 1 ) )
+      { run_multi_thread<ds_ring<data_t,core::access_t::spsc>,     data_t>( bench, "ring_buffer spsc"+ payload, producers, consumers, items ); }
+    }
+  }
+}
+
+/**
+ * @brief chunk_size and alloc_threshold sweep for the lockfree queue, with the smallest payload.
+ */
+template<typename data_t>
+static void run_arena_configs( ankerl::nanobench::Bench& bench, uint32_t max_producers, uint32_t max_consumers, uint32_t items )
+{
+  const uint32_t producers = max_producers;
+  const uint32_t consumers = max_consumers;
+
+  run_multi_thread<ds_queue<data_t,core::ds_impl_t::lockfree,1024,0>,         data_t>( bench, "queue lockfree chunk 1024 sync",  producers, consumers, items );
+  run_multi_thread<ds_queue<data_t,core::ds_impl_t::lockfree,1024,341>,       data_t>( bench, "queue lockfree chunk 1024 async", producers, consumers, items );
+  run_multi_thread<ds_queue<data_t,core::ds_impl_t::lockfree,16384,0>,        data_t>( bench, "queue lockfree chunk 16K sync",   producers, consumers, items );
+  run_multi_thread<ds_queue<data_t,core::ds_impl_t::lockfree,16384,5461>,     data_t>( bench, "queue lockfree chunk 16K async",  producers, consumers, items );
+  run_multi_thread<ds_queue<data_t,core::ds_impl_t::lockfree,65536,0>,        data_t>( bench, "queue lockfree chunk 64K sync",   producers, consumers, items );
+  run_multi_thread<ds_queue<data_t,core::ds_impl_t::lockfree,65536,21845>,    data_t>( bench, "queue lockfree chunk 64K async",  producers, consumers, items );
+}
+
+/**
+ * The following program compare queue implementations, see description at the top.
+ *
+ */
+int main( int argc, const char* argv[] )
+{
+  const uint32_t cpus          = std::max( std::thread::hardware_concurrency(), 2u );
+  const uint32_t max_producers = (argc > 1)?static_cast<uint32_t>(std::atoi(argv[1])):(cpus/2);
+  const uint32_t max_consumers = (argc > 2)?static_cast<uint32_t>(std::atoi(argv[2])):(cpus/2);
+  const uint32_t items         = (argc > 3)?static_cast<uint32_t>(std::atoi(argv[3])):200000;
+
+  if ( ( max_producers == 0 ) || ( max_consumers == 0 ) || ( items == 0 ) )
+  {
+    std::cerr << "usage: bm_suite [max_producers] [max_consumers] [items]" << std::endl;
+    return 1;
+  }
+
+  ankerl::nanobench::Bench bench;
+  bench.title("queues").warmup(1).epochs(5).epochIterations(1).relative(false);
+
+  run_payload<payload_t<1>>( bench, max_producers, max_consumers, items );
+  run_payload<payload_t<7>>( bench, max_producers, max_consumers, items );
+  run_payload<payload_t<31>>( bench, max_producers, max_consumers, items );
+
+  run_arena_configs<payload_t<1>>( bench, max_producers, max_consumers, items );
+
+  std::ofstream _output_csv ("bm_suite.csv");
+  ankerl::nanobench::render( ankerl::nanobench::templates::csv() , bench, _output_csv  );
+
+  std::ofstream _output_json("bm_suite.json");
+  ankerl::nanobench::render( ankerl::nanobench::templates::json(), bench, _output_json );
+
+  return 0;
+}
@@ -3,6 +3,7 @@
 #include <assert.h>
 
 #include "core/abstract_factory.h"
+#include "core/arena_allocator.h"
 #include "core/unique_ptr.h"
 
 using namespace std::chrono_literals;
@@ -130,6 +131,27 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] const char* argv[] )
     assert( _ptrDerived1->get_name() == "derived_1"  );
   }
 
+  // products in arena slots, no heap allocation after the first chunk
+  {
+    using factory_t = core::abstract_factory< base_class, base_class, 
+                                            derived_0, 
+                                            derived_1>;
+    using arena_t   = core::arena_allocator<factory_t::product_storage, uint32_t, 64, 64, 0, 0>;
+    factory_t factory;
+    arena_t   arena;
+
+    parameter _empty_param;
+
+    factory_t::arena_product_ptr<arena_t> _ptrBase     = factory.create( arena, "undefined", "msg base"     , _empty_param );
+    factory_t::arena_product_ptr<arena_t> _ptrDerived0 = factory.create( arena, "derived_0", "msg derived_0", _empty_param );
+    factory_t::arena_product_ptr<arena_t> _ptrDerived1 = factory.create( arena, "derived_1", "msg derived_1", _empty_param );
+
+    assert( _ptrBase->get_name()     == "base_class" );
+    assert( _ptrDerived0->get_name() == "derived_0"  );
+    assert( _ptrDerived1->get_name() == "derived_1"  );
+    assert( arena.length()           == 3            );
+  }
+
   std::cout << std::endl;
   std::cout << std::endl;
 
@@ -3,6 +3,7 @@
 
 #include "core/arena_allocator.h"
 #include "core/unique_ptr.h"
+#include "core/arena_ptr.h"
 
 using namespace std::chrono_literals;
 
@@ -114,6 +115,19 @@ int main( int argc, const char* argv[] )
   std::cout << std::endl;
   std::cout << std::endl;
 
+  using allocator_t = decltype(allocator);
+  {
+    std::cout << "Create data_item_7 with core::make_arena_ptr(), it is deallocated when going out of scope" << std::endl;
+    core::arena_ptr<data_item_t,allocator_t> pDataItem_7 = core::make_arena_ptr( allocator, 7 );
+
+    core::arena_handle<allocator_t> hDataItem_7( allocator, pDataItem_7.get() );
+    std::cout << "sizeof(handle) : " << sizeof(hDataItem_7) << " - handle : " << hDataItem_7.value() << std::endl;
+    std::cout << "data_item_7    : " << hDataItem_7.get( allocator )->data << std::endl;
+  }
+
+  std::cout << std::endl;
+  std::cout << std::endl;
+
   std::cout << "deallocate data_item_1 calling allocator.deallocate()" << std::endl;
   (void)allocator.deallocate(pDataItem_1);
 
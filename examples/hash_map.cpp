@@ -0,0 +1,96 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include "hash_map.h"
+#include "core/utils.h"
+
+
+/**
+ * The following program make use of hash_map template.
+ * 
+ * The main thread open and close sessions, inserting and erasing them from the map, 
+ * meanwhile 3 threads lookup for sessions checking that the associated value is consistent.
+ * At the end, all sessions still open must be found in the map.
+ */
+int main( int argc, const char* argv[] )
+{ 
+  (void)argc;
+  (void)argv;
+
+  const uint32_t sessions = 4096;
+  const uint32_t rounds   = 2000000;
+  const uint32_t nreaders = 3;
+
+  using hash_map_type = lock_free::hash_map<uint64_t,uint64_t,uint32_t,sessions>;
+
+  hash_map_type          map;
+  
+  std::atomic<bool>      running { true };
+  std::atomic<uint64_t>  errors  { 0 };
+  std::thread*           readers[nreaders];
+
+  ////////////////////////
+  // Read START TIME
+  auto tp_start_ms = core::utils::now<std::chrono::milliseconds>();
+
+  for ( uint32_t tid = 0; tid < nreaders; ++tid )
+  {
+    readers[tid] = new std::thread( [&](uint32_t th_num ){
+      uint64_t  found   = 0;
+      uint64_t  lookups = 0;
+      uint64_t  value   = 0;
+
+      while ( running.load() )
+      {
+        const uint64_t session = lookups++ % sessions;
+        if ( map.find( session, value ) == core::result_t::eSuccess )
+        {
+          if ( value != session * 2 )
+            ++errors;
+          ++found;
+        }
+      }
+
+      std::cout << "R_TH[" << th_num << "] lookups = " << lookups << " found = " << found << std::endl;
+    }, tid );
+  }
+
+  for ( uint32_t counter = 0; counter < rounds; ++counter )
+  {
+    const uint64_t session = (counter * 2654435761u) % sessions;
+    core::result_t res = map.insert( session, session * 2 );
+
+    // arena_allocator is waiting for refill_service to allocate a new chunk.
+    while ( res == core::result_t::eFailure )
+    {
+      std::this_thread::yield();
+      res = map.insert( session, session * 2 );
+    }
+
+    if ( res == core::result_t::eAlreadyExists )
+      (void)map.erase( session );
+  }
+
+  running = false;
+
+  for ( uint32_t tid = 0; tid < nreaders; ++tid )
+  {
+    readers[tid]->join();
+    delete readers[tid];
+  }
+
+  ////////////////////////
+  // Read END TIME
+  auto tp_end_ms = core::utils::now<std::chrono::milliseconds>();
+  std::cout << "duration: " << double(tp_end_ms-tp_start_ms)/1000 << std::endl;
+
+  uint32_t open = 0;
+  for ( uint64_t session = 0; session < sessions; ++session )
+    open += map.contains( session )?1:0;
+
+  std::cout << "size=" << map.size() << " open=" << open << " errors=" << errors << std::endl;
+
+  return ( (open == map.size()) && (errors == 0) )?0:1;
+}
@@ -61,6 +61,8 @@ public:
 
 using mailbox_type = lock_free::mailbox<mbx_data, core::ds_impl_t::lockfree, 0>;
 //using mailbox_type = lock_free::mailbox<mbx_data, core::ds_impl_t::mutex, 0>;
+// only one reader is allowed
+//using mailbox_type = lock_free::mailbox<mbx_data, core::ds_impl_t::mpsc, 0>;
 
 void th_main_write( mailbox_type* mbx, [[maybe_unused]] uint32_t run_time_ms )
 {
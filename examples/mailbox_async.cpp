@@ -0,0 +1,143 @@
+#include <iostream>
+#include <coroutine>
+#include <exception>
+#include <thread>
+
+#include "mailbox.h"
+#include "core/utils.h"
+
+
+/**
+ * Minimal coroutine type, started immediately and destroyed at completion.
+ */
+struct task
+{
+  struct promise_type
+  {
+    task                get_return_object() noexcept    { return {}; }
+    std::suspend_never  initial_suspend() noexcept      { return {}; }
+    std::suspend_never  final_suspend() noexcept        { return {}; }
+    void                return_void() noexcept          {}
+    void                unhandled_exception() noexcept  { std::terminate(); }
+  };
+};
+
+/**
+ * Scheduler resuming coroutines from a single thread, coroutines woken up by 
+ * the mailbox are pushed from any thread in a lock-free mpsc queue.
+ */
+class scheduler
+{
+public:
+  void  schedule( std::coroutine_handle<> handle ) noexcept
+  {
+    // arena_allocator is waiting for refill_service to allocate a new chunk.
+    while ( _ready.push( std::move(handle) ) != core::result_t::eSuccess )
+      std::this_thread::yield();
+  }
+
+  bool  run_one() noexcept
+  {
+    std::coroutine_handle<> handle;
+    if ( _ready.pop( handle ) != core::result_t::eSuccess )
+      return false;
+
+    handle.resume();
+    return true;
+  }
+
+private:
+  lock_free::queue<std::coroutine_handle<>,uint32_t,core::ds_impl_t::mpsc>  _ready;
+};
+
+using mailbox_type = lock_free::mailbox<uint32_t, core::ds_impl_t::lockfree, 1024>;
+
+const uint32_t nreaders = 1000;
+const uint32_t nwriters = 4;
+const uint32_t items    = 250000;
+
+uint64_t       sum      = 0;
+uint32_t       readers  = nreaders;
+uint32_t       writers  = nwriters;
+
+/**
+ * Each reader stops when it reads 0.
+ */
+task reader( mailbox_type& mbx, scheduler& sched )
+{
+  for (;;)
+  {
+    uint32_t value = 0;
+    if ( co_await mbx.async_read( value, sched ) != core::result_t::eSuccess )
+      continue;
+
+    if ( value == 0 )
+      break;
+
+    sum += value;
+  }
+
+  --readers;
+}
+
+/**
+ * Writers are suspended when the mailbox is full, the last one stops all readers.
+ */
+task writer( mailbox_type& mbx, scheduler& sched )
+{
+  for ( uint32_t value = 1; value <= items; )
+  {
+    uint32_t data = value;
+    if ( co_await mbx.async_write( std::move(data), sched ) == core::result_t::eSuccess )
+      ++value;
+  }
+
+  if ( --writers > 0 )
+    co_return;
+
+  for ( uint32_t ndx = 0; ndx < nreaders; )
+  {
+    uint32_t data = 0;
+    if ( co_await mbx.async_write( std::move(data), sched ) == core::result_t::eSuccess )
+      ++ndx;
+  }
+}
+
+/**
+ * The following program run 1000 readers and 4 writers as coroutines, all of them
+ * exchanging data through the same mailbox and resumed by a single thread.
+ * At the end, the sum of all values read must match with the one of all values written.
+ */
+int main( int argc, const char* argv[] )
+{ 
+  (void)argc;
+  (void)argv;
+
+  mailbox_type mbx( "coroutines" );
+  scheduler    sched;
+
+  ////////////////////////
+  // Read START TIME
+  auto tp_start_ms = core::utils::now<std::chrono::milliseconds>();
+
+  for ( uint32_t ndx = 0; ndx < nreaders; ++ndx )
+    reader( mbx, sched );
+  for ( uint32_t ndx = 0; ndx < nwriters; ++ndx )
+    writer( mbx, sched );
+
+  while ( readers > 0 )
+  {
+    if ( sched.run_one() == false )
+      std::this_thread::yield();
+  }
+
+  ////////////////////////
+  // Read END TIME
+  auto tp_end_ms = core::utils::now<std::chrono::milliseconds>();
+  std::cout << "duration: " << double(tp_end_ms-tp_start_ms)/1000 << std::endl;
+
+  const uint64_t expected = uint64_t(nwriters) * items * (items + 1) / 2;
+  std::cout << "sum=" << sum << " expected=" << expected << " pending=" << mbx.size() << std::endl;
+
+  return ( sum == expected )?0:1;
+}
@@ -0,0 +1,112 @@
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "ring_buffer.h"
+#include "core/utils.h"
+
+/**
+ * @brief Message exchanged between processes, trivially copyable and without pointers.
+ */
+struct quote_t {
+  uint64_t  seq;
+  uint64_t  timestamp_ns;
+  char      symbol[8];
+  double    price;
+};
+
+using shared_ring = lock_free::ring_buffer<quote_t,uint32_t,65536,core::access_t::spsc,core::counter_t::exact,core::minimal_order,core::mapped_storage>;
+
+static constexpr const uint64_t c_quotes = 1000000;
+
+/***/
+static int producer( const std::string& path )
+{
+  shared_ring rbuffer( (core::mapped_storage(path)) );
+  if ( !rbuffer.is_valid() )
+  {
+    std::cout << "unable to map " << path << std::endl;
+    return 1;
+  }
+
+  std::cout << "producer: pending items found " << rbuffer.size() << std::endl;
+
+  for ( uint64_t seq = 0; seq < c_quotes; ++seq )
+  {
+    quote_t quote{ seq, uint64_t(core::utils::now<std::chrono::nanoseconds>()), "LFQ", 100.0 + double(seq % 100) / 100 };
+    while ( rbuffer.push( quote ) == false )
+      std::this_thread::yield();
+  }
+
+  std::cout << "producer: pushed " << c_quotes << " quotes" << std::endl;
+  return 0;
+}
+
+/***/
+static int consumer( const std::string& path )
+{
+  shared_ring rbuffer( (core::mapped_storage(path)) );
+  if ( !rbuffer.is_valid() )
+  {
+    std::cout << "unable to map " << path << std::endl;
+    return 1;
+  }
+
+  quote_t  quote;
+  uint64_t received = 0;
+  uint64_t latency  = 0;
+  while ( received < c_quotes )
+  {
+    if ( rbuffer.pop( quote ) == false )
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    latency += uint64_t(core::utils::now<std::chrono::nanoseconds>()) - quote.timestamp_ns;
+    ++received;
+  }
+
+  std::cout << "consumer: received " << received << " quotes - avg latency ns: " << latency/received << std::endl;
+  return 0;
+}
+
+/**
+ * The following program make use of ring_buffer with core::mapped_storage.
+ * 
+ * Run "rbuffer_shared producer" and "rbuffer_shared consumer" from two different shells, the two 
+ * processes exchange quotes through the same file mapping without any copy in the kernel. Items 
+ * pushed while the consumer is not running remain in the file and will be received when it restarts.
+ * 
+ * Without arguments producer and consumer run in two threads of the same process, each one with its 
+ * own mapping of the file.
+ */
+int main( int argc, const char* argv[] )
+{ 
+  const std::string path = (argc > 2)?argv[2]:"/dev/shm/lf_rbuffer_shared";
+
+  if ( ( argc > 1 ) && ( std::strcmp( argv[1], "producer" ) == 0 ) )
+    return producer( path );
+
+  if ( ( argc > 1 ) && ( std::strcmp( argv[1], "consumer" ) == 0 ) )
+    return consumer( path );
+
+  if ( argc > 1 )
+  {
+    std::cout << "usage: rbuffer_shared [producer|consumer] [path]" << std::endl;
+    return 1;
+  }
+
+  core::mapped_storage::remove( path );
+
+  int         prod_result = 0;
+  std::thread prod( [&]() { prod_result = producer( path ); } );
+  int         cons_result = consumer( path );
+  prod.join();
+
+  core::mapped_storage::remove( path );
+
+  return ( prod_result != 0 )?prod_result:cons_result;
+}
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include "timer_wheel.h"
+#include "core/utils.h"
+
+
+/**
+ * The following program make use of timer_wheel template.
+ * 
+ * 3 threads schedule retries with deadlines up to 2 seconds in the future, using milliseconds 
+ * as ticks, and cancel one retry every 4; meanwhile the main thread expires the timers checking
+ * that no timer is fired before its deadline.
+ * At the end, the number of expired timers plus the cancelled ones must match with the number 
+ * of scheduled timers.
+ */
+int main( int argc, const char* argv[] )
+{ 
+  (void)argc;
+  (void)argv;
+
+  const uint32_t timers     = 100000;
+  const uint32_t nproducers = 3;
+
+  using timer_wheel_type = lock_free::timer_wheel<uint64_t,uint32_t>;
+
+  timer_wheel_type       wheel( core::utils::now<std::chrono::milliseconds>() );
+  
+  std::atomic<uint32_t>  running   { nproducers };
+  std::atomic<uint64_t>  scheduled { 0 };
+  std::atomic<uint64_t>  cancelled { 0 };
+  std::thread*           producers[nproducers];
+
+  ////////////////////////
+  // Read START TIME
+  auto tp_start_ms = core::utils::now<std::chrono::milliseconds>();
+
+  for ( uint32_t tid = 0; tid < nproducers; ++tid )
+  {
+    producers[tid] = new std::thread( [&](uint32_t th_num ){
+      timer_wheel_type::handle_type handle;
+
+      for ( uint32_t counter = 0; counter < timers; ++counter )
+      {
+        const uint64_t deadline = core::utils::now<std::chrono::milliseconds>() + ( (counter * 7919) % 2000 );
+
+        // arena_allocator is waiting for refill_service to allocate a new chunk.
+        while ( wheel.schedule( deadline, handle, deadline ) != core::result_t::eSuccess )
+          std::this_thread::yield();
+
+        ++scheduled;
+
+        if ( ( ( counter % 4 ) == 0 ) && ( wheel.cancel( handle ) == core::result_t::eSuccess ) )
+          ++cancelled;
+      }
+
+      std::cout << "P_TH[" << th_num << "] completed" << std::endl;
+      --running;
+    }, tid );
+  }
+
+  uint64_t expired = 0;
+  uint64_t early   = 0;
+  while ( ( running.load() > 0 ) || !wheel.empty() )
+  {
+    const uint64_t now = core::utils::now<std::chrono::milliseconds>();
+
+    expired += wheel.expire( now, [&]( uint64_t& deadline ){
+      if ( deadline > now )
+        ++early;
+    });
+
+    std::this_thread::sleep_for( 1ms );
+  }
+
+  for ( uint32_t tid = 0; tid < nproducers; ++tid )
+  {
+    producers[tid]->join();
+    delete producers[tid];
+  }
+
+  ////////////////////////
+  // Read END TIME
+  auto tp_end_ms = core::utils::now<std::chrono::milliseconds>();
+  std::cout << "duration: " << double(tp_end_ms-tp_start_ms)/1000 << std::endl;
+
+  std::cout << "scheduled=" << scheduled << " expired=" << expired << " cancelled=" << cancelled << " early=" << early << std::endl;
+
+  return ( (expired+cancelled) == scheduled && (early == 0) )?0:1;
+}
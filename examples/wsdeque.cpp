@@ -0,0 +1,94 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include "ws_deque.h"
+#include "core/utils.h"
+
+
+/**
+ * The following program make use of ws_deque template.
+ * 
+ * The main thread own the deque and push 8 Million items, popping one item every 4 pushed,
+ * meanwhile 3 threads try to steal items from the top of the deque.
+ * When the owner completes, it pops all remaining items.
+ * At the end, the number of items extracted from the owner and from the thieves must match
+ * with the number of items pushed.
+ */
+int main( int argc, const char* argv[] )
+{ 
+  (void)argc;
+  (void)argv;
+
+  const uint32_t items    = 8000000;
+  const uint32_t nthieves = 3;
+
+  lock_free::ws_deque<u_int64_t,uint32_t>  deque;
+  
+  std::atomic<bool>     running { true };
+  std::atomic<uint64_t> stolen  { 0 };
+  std::thread*          thieves[nthieves];
+
+  ////////////////////////
+  // Read START TIME
+  auto tp_start_ms = core::utils::now<std::chrono::milliseconds>();
+
+  for ( uint32_t tid = 0; tid < nthieves; ++tid )
+  {
+    thieves[tid] = new std::thread( [&](uint32_t th_num ){
+      uint64_t  counter   = 0;
+      uint64_t  conflicts = 0;
+      u_int64_t value     = 0;
+
+      while ( running.load() || !deque.empty() )
+      {
+        core::result_t res = deque.steal( value );
+        if ( res == core::result_t::eSuccess )
+          ++counter;
+        else if ( res == core::result_t::eFailure )
+          ++conflicts;
+        else
+          std::this_thread::yield();
+      }
+
+      stolen += counter;
+      std::cout << "T_TH[" << th_num << "] stolen = " << counter << " conflicts = " << conflicts << std::endl;
+    }, tid );
+  }
+
+  uint64_t  popped = 0;
+  u_int64_t value  = 0;
+  for ( uint32_t counter = 0; counter < items; ++counter )
+  {
+    if ( deque.push( counter ) != core::result_t::eSuccess )
+      std::cout << "error push" << std::endl;
+
+    if ( ( counter % 4 ) == 0 )
+    {
+      if ( deque.pop( value ) == core::result_t::eSuccess )
+        ++popped;
+    }
+  }
+
+  while ( deque.pop( value ) == core::result_t::eSuccess )
+    ++popped;
+
+  running = false;
+
+  for ( uint32_t tid = 0; tid < nthieves; ++tid )
+  {
+    thieves[tid]->join();
+    delete thieves[tid];
+  }
+
+  ////////////////////////
+  // Read END TIME
+  auto tp_end_ms = core::utils::now<std::chrono::milliseconds>();
+  std::cout << "duration: " << double(tp_end_ms-tp_start_ms)/1000 << std::endl;
+
+  std::cout << "popped=" << popped << " stolen=" << stolen << " total=" << (popped+stolen) << std::endl;
+  std::cout << "capacity=" << deque.capacity() << " size=" << deque.size() << std::endl;
+
+  return ( (popped+stolen) == items )?0:1;
+}
@@ -25,14 +25,21 @@
 #define LOCK_FREE_ARENA_ALLOCATOR_H
 
 #include <vector>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <bit>
 #include <assert.h>
-#include <semaphore>
 
 #include "config.h"
 #include "core/semaphore.h"
 #include "core/memory_address.h"
 #include "core/memory_allocators.h"
 #include "core/fixed_lookup_table.h"
+#include "core/chunk_map.h"
+#include "core/refill_service.h"
+#include "core/stats.h"
 
 namespace lock_free {
 
@@ -57,17 +64,43 @@ namespace lock_free {
  * @tparam alloc_threshold  when 0 chunck allocation is synchronous, when >0 specify the threshold to activate
  *                          an auxiliare thread to add a new chunck. 
  * @tparam allocator_t      system memory allocator core::default_allocator, core::virtual_allocator or user defined allocator.
+ * @tparam magazine_size    when 0 (default) each allocate() and deallocate() operates directly on the shared free list.
+ *                          When >0 each thread keeps a private cache ("magazine") of up to magazine_size free slots 
+ *                          for each arena instance; the magazine is refilled from and flushed to the shared free list 
+ *                          in batches of (magazine_size/2) slots, so most operations never touch a shared atomic.
+ * @tparam numa_nodes       when 1 (default) there is a single shared free list. When >1 there is one free list
+ *                          for each NUMA node, chunks are bound to a node with core::numa::bind(), allocations are 
+ *                          served from the node of the calling thread, and deallocated slots always return to their 
+ *                          home node. When the local list is empty slots are taken from the other nodes. Up to 8 nodes
+ *                          are supported, and allocator_t should return page aligned memory (e.g. core::virtual_allocator) 
+ *                          so that binding can be applied.
+ * @tparam slot_layout      core::slot_layout_t::header (default) prefix each data_t with a header, on 64 bits
+ *                          it takes 8 bytes. With core::slot_layout_t::overlay the free-list link overlays 
+ *                          data_t, so slots take only max(sizeof(data_t),sizeof(void*)) and for small types 
+ *                          more objects fit in each cache line. In this case data_t must be trivially 
+ *                          destructible and double free is not detected.
+ * @tparam order_t          memory orders applied to free lists and counters, core::minimal_order (default) or 
+ *                          core::seq_cst_order for debugging.
+ * @tparam stats_t          core::no_stats (default) or core::thread_stats to account free list CAS failures, 
+ *                          chunk growth and allocate() returning nullptr; see stats().
  *
 */
 template< typename data_t, typename data_size_t, 
           data_size_t chunk_size = 1024, data_size_t initial_size = chunk_size, data_size_t size_limit = 0,
           data_size_t alloc_threshold = (chunk_size / 10),
-          typename allocator_t = core::default_allocator<data_size_t>
+          typename allocator_t = core::default_allocator<data_size_t>,
+          data_size_t magazine_size = 0,
+          data_size_t numa_nodes = 1,
+          core::slot_layout_t slot_layout = core::slot_layout_t::header,
+          typename order_t = core::minimal_order,
+          typename stats_t = core::no_stats
         > 
 requires std::is_unsigned_v<data_size_t> && (std::is_same_v<data_size_t,uint32_t> || std::is_same_v<data_size_t,uint64_t>)
          && ( ((sizeof(data_t) % alignof(std::max_align_t)) == 0 ) || ((alignof(std::max_align_t) % sizeof(data_t)) == 0 ) )
          && ( chunk_size > 0 ) && ( initial_size >= chunk_size )
-         && ((sizeof(void*)==4) || (sizeof(void*)==8))
+         && ( numa_nodes >= 1 ) && ( numa_nodes <= 8 )
+         && ( ( slot_layout == core::slot_layout_t::header ) || std::is_trivially_destructible_v<data_t> )
+         && ((sizeof(void*)==4) || (sizeof(void*)==8)) && core::memory_order_profile<order_t> && core::stats_policy<stats_t>
 class arena_allocator
 {
 private:
@@ -81,26 +114,36 @@ public:
   using allocator_type    = allocator_t;
   using lookup_table_type = core::fixed_lookup_table<arena_allocator*,size_type,max_instances_per_type,nullptr>;
   using mutex_type        = std::mutex;
+  using handle_type       = uint32_t;
 
   static constexpr const size_type         value_type_size  = sizeof(value_type);
   static lookup_table_type                 instances_table;
 
+  /** Returned by to_handle() for pointers that can't be represented. */
+  static constexpr const handle_type       null_handle        = std::numeric_limits<handle_type>::max();
+  /** A handle keeps the slot offset in the low bits and the chunk identifier in the high bits. */
+  static constexpr const uint32_t          handle_slot_bits   = (chunk_size > 1)?static_cast<uint32_t>(std::bit_width( static_cast<uint64_t>(chunk_size-1) )):0;
+  static constexpr const uint64_t          handle_max_chunks  = (handle_slot_bits < 32)?std::min<uint64_t>( (uint64_t(1) << (32-handle_slot_bits)) - 1, 65536 ):1;
+
 private:
-  /***/
-  struct memory_slot {
+  /**
+   * @brief Slot used with core::slot_layout_t::header, the header keeps the free-list link,
+   *        the DESTROY flag, the home NUMA node and the index of the owning arena.
+   */
+  struct header_slot {
     /***/
-    constexpr inline memory_slot() noexcept
+    constexpr inline header_slot() noexcept
       :_ptr_next(nullptr)
     {}
     /***/
-    constexpr inline explicit memory_slot( memory_slot* next ) noexcept
+    constexpr inline explicit header_slot( header_slot* next ) noexcept
       :_ptr_next(next)
     {}
 
     /**
      * @brief Return pointer to user data.
      */
-    constexpr inline memory_slot* next() noexcept
+    constexpr inline header_slot* next() noexcept
     { return _ptr_next; }
 
     /**
@@ -111,88 +154,212 @@ private:
 
     /***/
     constexpr inline bool         in_use() const noexcept
-    { return core::memory_address<memory_slot,size_type>::test_flag(_ptr_next, core::memory_address<memory_slot,size_type>::address_flags::DESTROY); }
+    { return core::memory_address<header_slot,size_type>::test_flag(_ptr_next, core::memory_address<header_slot,size_type>::address_flags::DESTROY); }
 
     /***/
     constexpr inline bool         is_free() const noexcept
-    { return !core::memory_address<memory_slot,size_type>::test_flag(_ptr_next, core::memory_address<memory_slot,size_type>::address_flags::DESTROY); }
+    { return !core::memory_address<header_slot,size_type>::test_flag(_ptr_next, core::memory_address<header_slot,size_type>::address_flags::DESTROY); }
 
     /***/
-    constexpr inline void         set_free( memory_slot* next_free ) noexcept
+    constexpr inline void         set_free( header_slot* next_free ) noexcept
     { 
       _ptr_next.set_address( next_free ); 
-      core::memory_address<memory_slot,size_type>::unset_flag ( _ptr_next, core::memory_address<memory_slot,size_type>::address_flags::DESTROY ); 
+      core::memory_address<header_slot,size_type>::unset_flag ( _ptr_next, core::memory_address<header_slot,size_type>::address_flags::DESTROY ); 
     }
 
     /***/
     constexpr inline void         set_in_use() noexcept
     { 
       _ptr_next.set_address( nullptr );
-      core::memory_address<memory_slot,size_type>::set_flag   ( _ptr_next, core::memory_address<memory_slot,size_type>::address_flags::DESTROY ); 
+      core::memory_address<header_slot,size_type>::set_flag   ( _ptr_next, core::memory_address<header_slot,size_type>::address_flags::DESTROY ); 
     }
     
     /***/
     constexpr inline size_type    get_index() noexcept
-    { return core::memory_address<memory_slot,size_type>::get_counter( _ptr_next ); }
+    { return core::memory_address<header_slot,size_type>::get_counter( _ptr_next ); }
 
     /***/
     constexpr inline void         set_index( const size_type& index ) noexcept
-    { core::memory_address<memory_slot,size_type>::set_counter( _ptr_next, index ); }
+    { core::memory_address<header_slot,size_type>::set_counter( _ptr_next, index ); }
+
+    /**
+     * @brief Return the home NUMA node, stored in flags bits not used by DESTROY.
+     */
+    constexpr inline size_type    get_node() const noexcept
+    { return static_cast<size_type>( core::memory_address<header_slot,size_type>::flags( _ptr_next ) >> node_shift ); }
+
+    /***/
+    constexpr inline void         set_node( const size_type& node ) noexcept
+    { 
+      using base_t = typename core::memory_address<header_slot,size_type>::base_t;
+      const base_t destroy = core::memory_address<header_slot,size_type>::flags( _ptr_next ) & static_cast<base_t>(core::memory_address<header_slot,size_type>::address_flags::DESTROY);
+      core::memory_address<header_slot,size_type>::set_flags( _ptr_next, destroy | (static_cast<base_t>(node) << node_shift) ); 
+    }
+
+    static constexpr const size_type node_shift = 1;
+
+    /** Offset of user data from the beginning of the slot, value_type may require a stricter alignment than the header. */
+    static constexpr const size_type user_data_offset = std::max<size_type>( core::memory_address<header_slot,size_type>::memory_address_size, alignof(value_type) );
 
     /***/
-    constexpr static inline memory_slot* slot_from_user_data( pointer ptr ) noexcept
-    { return std::bit_cast<memory_slot*>(std::bit_cast<char*>(ptr)-core::memory_address<memory_slot,size_type>::memory_address_size); }
+    constexpr static inline header_slot* slot_from_user_data( pointer ptr ) noexcept
+    { return std::bit_cast<header_slot*>(std::bit_cast<char*>(ptr)-user_data_offset); }
 
-    core::memory_address<memory_slot,size_type>  _ptr_next;
+    core::memory_address<header_slot,size_type>  _ptr_next;
     value_type                                   _user_data;
   };
 
+  struct chunk_header;
+  struct memory_chunk;
+
+  /**
+   * @brief Slot used with core::slot_layout_t::overlay, the free-list link overlays the user 
+   *        data, so the slot has the same size of value_type (at least a pointer). 
+   *        Owner index and home node are read from the chunk header, found by masking the
+   *        slot address with chunk_alignment.
+   *        There is no flag to tell whether the slot is in use, so both in_use() and is_free()
+   *        return false: double free is not detected and clear() does not invoke destructors,
+   *        that is the reason why value_type must be trivially destructible.
+   */
+  struct overlay_slot {
+    /***/
+    constexpr inline overlay_slot() noexcept
+      :_ptr_next(nullptr)
+    {}
+
+    /***/
+    constexpr inline overlay_slot* next() noexcept
+    { return _ptr_next; }
+
+    /**
+     * @brief Return pointer to user data.
+     */
+    constexpr inline pointer      prt() noexcept
+    { return &_user_data; }
+
+    /***/
+    constexpr inline bool         in_use() const noexcept
+    { return false; }
+
+    /***/
+    constexpr inline bool         is_free() const noexcept
+    { return false; }
+
+    /***/
+    constexpr inline void         set_free( overlay_slot* next_free ) noexcept
+    { _ptr_next = next_free; }
+
+    /***/
+    constexpr inline void         set_in_use() noexcept
+    {}
+    
+    /***/
+    inline size_type              get_index() noexcept
+    { return chunk_from_address( this )->_index; }
+
+    /***/
+    constexpr inline void         set_index( const size_type& ) noexcept
+    {}
+
+    /***/
+    inline size_type              get_node() const noexcept
+    { return chunk_from_address( this )->_node; }
+
+    /***/
+    constexpr inline void         set_node( const size_type& ) noexcept
+    {}
+
+    /** Offset of user data from the beginning of the slot. */
+    static constexpr const size_type user_data_offset = 0;
+
+    /***/
+    constexpr static inline overlay_slot* slot_from_user_data( pointer ptr ) noexcept
+    { return std::bit_cast<overlay_slot*>(ptr); }
+
+    union {
+      overlay_slot*  _ptr_next;
+      value_type     _user_data;
+    };
+  };
+
+  using memory_slot      = std::conditional_t<(slot_layout==core::slot_layout_t::header),header_slot,overlay_slot>;
   using slot_pointer     = memory_slot*;
+  using tagged_pointer   = core::memory_address<memory_slot,size_type>;
   
   static constexpr const size_type memory_slot_size           = sizeof(memory_slot);
-  static constexpr const size_type memory_required_per_chunk  = memory_slot_size*chunk_size;
+
+  /**
+   * @brief Placed at the beginning of each chunk, slots in the chunk with index 
+   *        below _high_water have been handed out at least once, while the others
+   *        have never been touched and are not linked to any free list.
+   *        Chunks with untouched slots are linked through _next, per NUMA node.
+   *        A chunk released by shrink_to() is cached, and it can be linked again 
+   *        only once _in_chain tells that it has been detached.
+   */
+  struct chunk_header {
+    std::atomic<size_type>  _high_water;
+    chunk_header*           _next;
+    size_type               _index;   // owner arena in instances_table
+    size_type               _node;    // home NUMA node
+    void*                   _memory;  // memory returned by allocator_t
+    uint32_t                _id;      // identifier used in handles
+    std::atomic<bool>       _in_chain;
+  };
+
+  using tagged_chunk     = core::memory_address<chunk_header,size_type>;
+
+  static constexpr const size_type chunk_header_size          = ((sizeof(chunk_header)+alignof(memory_slot)-1)/alignof(memory_slot))*alignof(memory_slot);
+  static constexpr const size_type memory_required_per_chunk  = chunk_header_size+memory_slot_size*chunk_size;
+
+  /**
+   * @brief With core::slot_layout_t::overlay chunks start at a multiple of chunk_alignment, so 
+   *        the header is found masking any slot address. allocator_t doesn't guarantee such 
+   *        alignment, then chunk_alignment extra bytes are reserved; pages that are not used
+   *        are never touched by the arena.
+   *        The same applies with core::slot_layout_t::header when value_type requires an alignment
+   *        stricter than std::max_align_t, in example a node aligned to a cache line.
+   */
+  static constexpr const size_type chunk_alignment            = (slot_layout==core::slot_layout_t::overlay)?std::bit_ceil(memory_required_per_chunk):
+                                                                ((alignof(memory_slot) > alignof(std::max_align_t))?alignof(memory_slot):1);
+  static constexpr const size_type memory_allocated_per_chunk = memory_required_per_chunk + ((chunk_alignment>1)?chunk_alignment:0);
+
+  /***/
+  static inline chunk_header* chunk_from_address( const void* ptr ) noexcept
+  { return std::bit_cast<chunk_header*>( std::bit_cast<uintptr_t>(ptr) & ~static_cast<uintptr_t>(chunk_alignment-1) ); }
 
 public:
 
   /***/
   constexpr inline arena_allocator() noexcept
-    : _ndx_instance( 0 ),
-      _next_free(nullptr), _max_length(0), _free_slots(0), _capacity(0),
-      _th_alloc(nullptr), _sem_th_alloc(0), _th_alloc_exit( false )
+    : _ndx_instance( 0 ), _epoch( next_epoch() ),
+      _next_chunk_id(0), _free_lists(), _max_length(0), _free_slots(0), _capacity(0), _grow_node(0),
+      _trim_mark(std::numeric_limits<size_type>::max()), _trim_high(0), _trim_low(0), _trim_pending(false),
+      _refill_client(nullptr)
   {
-    static_assert(decltype(_next_free )::is_always_lock_free);
+    static_assert(decltype(free_list_t::_next_free)::is_always_lock_free);
+    static_assert(decltype(free_list_t::_bump_chunk)::is_always_lock_free);
     static_assert(decltype(_max_length)::is_always_lock_free);
     static_assert(decltype(_free_slots)::is_always_lock_free);
     static_assert(decltype(_capacity  )::is_always_lock_free);
 
     capture_instance_index();
 
+    // threads exiting from now on can return the slots cached in their magazines.
+    if constexpr ( magazine_size > 0 )
+    { s_exit_guards[_ndx_instance]._arena.store( this, std::memory_order_seq_cst ); }
+
+    size_type node = 0;
     while ( max_length() < initial_size )
     {
-      if ( add_mem_chuck() == false )
+      // initial chunks are distributed over all nodes
+      if ( add_mem_chuck( node ) == false )
       { break; }
+      node = ((node+1)<numa_nodes)?(node+1):0;
     }
     
+    // Growth is delegated to the refill service shared by all arenas.
     if ( alloc_threshold > 0 )
-    {
-      _th_alloc = new std::thread( []( arena_allocator* pArena ){ 
-                                                                  while ( pArena->_th_alloc_exit.load(std::memory_order_acquire) == false )
-                                                                  {
-                                                                    pArena->_sem_th_alloc.acquire();
-
-                                                                    if ( pArena->_th_alloc_exit.load(std::memory_order_acquire) == true  )
-                                                                      break;
-                                                                    
-                                                                    if (( pArena->max_length() < size_limit ) || (size_limit == 0))
-                                                                    {
-                                                                      if ( pArena->add_mem_chuck( ) == false )
-                                                                      {
-                                                                        // Reached physical memory limit
-                                                                      }
-                                                                    }
-                                                                  }         
-                                                                }, this );
-    }
+    { _refill_client = core::refill_service::instance().subscribe( this, &arena_allocator::refill ); }
   }
 
   /***/
@@ -201,22 +368,23 @@ public:
   /***/
   inline ~arena_allocator() noexcept
   {
-    release_instance_index();
-
-    if ( alloc_threshold > 0 )
+    // no exiting thread can pin this arena anymore, wait for the ones already flushing their magazine.
+    if constexpr ( magazine_size > 0 )
     {
-      _th_alloc_exit.store( true, std::memory_order_release );
-      _sem_th_alloc.release();
+      exit_guard_t& guard = s_exit_guards[_ndx_instance];
+      guard._arena.store( nullptr, std::memory_order_seq_cst );
+      while ( guard._pins.load( std::memory_order_seq_cst ) != 0 )
+      { std::this_thread::yield(); }
     }
 
+    release_instance_index();
+
+    // Once returned no refill is running or will be started for this arena.
+    if ( _refill_client != nullptr )
+    { core::refill_service::instance().unsubscribe( _refill_client ); }
+
     // Release all chunks
     clear();
-
-    if (( alloc_threshold > 0 ) && (_th_alloc!=nullptr))
-    {
-      _th_alloc->join();
-      delete _th_alloc;
-    }
   }
 
   /***/
@@ -235,6 +403,10 @@ public:
   /**
    * @brief Retrieve length in terms of items currently used.
    * 
+   *        Note: when magazine_size > 0 the free slots cached by each thread
+   *              are accounted as in use until they are flushed back to the
+   *              shared free list.
+   * 
    * @return current number of items in use. 
    */
   constexpr inline size_type  length() const noexcept
@@ -263,6 +435,13 @@ public:
   constexpr inline size_type  capacity() const noexcept
   { return _capacity.load( std::memory_order_acquire ); }
 
+  /**
+   * @brief Counters collected by stats_t, chunks added by the constructor to reach 
+   *        initial_size are accounted as chunk_growth too.
+   */
+  constexpr inline core::stats_snapshot  stats() const noexcept
+  { return _stats.snapshot(); }
+
   /**
    * @brief Return the largest supported allocation size.
    */
@@ -294,31 +473,70 @@ public:
   template< typename... Args > 
   constexpr inline pointer    allocate( Args&&... args ) noexcept
   { 
-    if ( alloc_threshold > 0 ) [[likely]]
-    {
-      if ( _free_slots.load( std::memory_order_acquire ) <= alloc_threshold ) 
-      { _sem_th_alloc.release(); }
-    }
-    else if ( _next_free.load( std::memory_order_acquire ) == nullptr ) [[unlikely]] // && ( alloc_threshold == 0 ) second part is implicit.
-    { add_mem_chuck(); } 
-    
     slot_pointer pCurrSlot = nullptr;
-    for (;;)
+
+    if constexpr ( magazine_size > 0 )
     {
-      pCurrSlot = _next_free.load( std::memory_order_acquire );
+      magazine_t& mag = local_magazine();
+      if ( mag._count == 0 ) [[unlikely]]
+      { refill_magazine( mag ); }
+
+      pCurrSlot = mag.pop();
       if ( pCurrSlot == nullptr ) [[unlikely]]
+      {
+        _stats.add( core::stats_event_t::alloc_miss );
         return nullptr;
+      }
+    }
+    else if constexpr ( numa_nodes > 1 )
+    {
+      const size_type node = local_node();
+      check_threshold( node );
 
-      if ( _next_free.compare_exchange_weak( pCurrSlot, pCurrSlot->next(), std::memory_order_seq_cst, std::memory_order_relaxed ) == false )
-        continue;
+      slot_pointer pLastSlot = nullptr;
+      if ( pop_any( node, pCurrSlot, pLastSlot, 1 ) == 0 ) [[unlikely]]
+      {
+        _stats.add( core::stats_event_t::alloc_miss );
+        return nullptr;
+      }
+    }
+    else
+    {
+      check_threshold( 0 );
       
-      break;
+      std::atomic<tagged_pointer>& next_free = free_list( 0 );
+      tagged_pointer               currHead  = next_free.load( order_t::acquire );
+      for (;;)
+      {
+        pCurrSlot = currHead.get_address();
+        if ( pCurrSlot == nullptr ) [[unlikely]]
+          break;
+
+        // The generation tag makes the CAS fail if pCurrSlot was allocated and released in the meantime.
+        if ( next_free.compare_exchange_weak( currHead, tagged_pointer::next_tag( pCurrSlot->next(), currHead ), order_t::acq_rel, order_t::acquire ) == false )
+        { _stats.add( core::stats_event_t::cas_failure ); continue; }
+        
+        break;
+      }
+
+      if ( pCurrSlot == nullptr ) [[unlikely]]
+      {
+        // free list is empty, try with the untouched tail of the last chunk 
+        slot_pointer pLastSlot = nullptr;
+        if ( bump_chain( 0, pCurrSlot, pLastSlot, 1 ) == 0 )
+        {
+          _stats.add( core::stats_event_t::alloc_miss );
+          return nullptr;
+        }
+      }
+      else
+      {
+        _free_slots.fetch_sub(1, order_t::relaxed);
+      }
     }
 
     pCurrSlot->set_in_use();
 
-    _free_slots.fetch_sub(1, std::memory_order_seq_cst);
-
     return new(pCurrSlot->prt()) value_type( std::forward<Args>(args)... );
   }
 
@@ -330,9 +548,9 @@ public:
    * 
    *        Note: only memory allocated by this arena_allocator can be deallocated.
    *              In case the user try to deallocate memory not managed from the arena_allocator
-   *              application will experience unexpected behaviour. Consistency check require O(n) 
-   *              where 'n' is the number of chunks allocated, so not implemented in order to have
-   *              deallocation with O(1).
+   *              application will experience unexpected behaviour. Consistency check is available
+   *              with is_valid(), in constant time, but it is not applied here since it requires 
+   *              a lock on the chunks.
    *  
    * @param userdata  pointer to user data previously allocated with allocate().
    */
@@ -343,11 +561,10 @@ public:
 
     userdata->~value_type();
 
-    std::atomic_thread_fence( std::memory_order_acquire );
+    std::atomic_thread_fence( order_t::acquire );
 
     slot_pointer     pSlot     = memory_slot::slot_from_user_data(userdata);
     arena_allocator* pArena    = instances_table[pSlot->get_index()];
-    slot_pointer     pCurrNext = pArena->_next_free.load( std::memory_order_relaxed );
 
     if ( pSlot->is_free() )
     {
@@ -355,15 +572,130 @@ public:
       return core::result_t::eDoubleFree;
     }
 
-    do{
-      pSlot->set_free( pCurrNext );
-    } while ( !pArena->_next_free.compare_exchange_weak( pCurrNext, pSlot, std::memory_order_seq_cst, std::memory_order_acquire ) );
-   
-    pArena->_free_slots.fetch_add(1, std::memory_order_seq_cst);
+    if constexpr ( magazine_size > 0 )
+    {
+      // slots from a remote node are not cached, they go back to their home node.
+      if ( ( numa_nodes == 1 ) || ( pSlot->get_node() == local_node() ) )
+      {
+        magazine_t& mag = pArena->local_magazine();
+        mag.push( pSlot );
+
+        if ( mag._count >= magazine_size ) [[unlikely]]
+        { pArena->flush_magazine( mag, magazine_batch ); }
+
+        return core::result_t::eSuccess;
+      }
+    }
+
+    pArena->push_chain( pSlot->get_node(), pSlot, pSlot, 1 );
 
     return core::result_t::eSuccess;
   }
 
+  /**
+   * @brief Allocate memory for up to @param count data_t() objects and invoke
+   *        constructor for each of them with the same parameters.
+   *        Slots are detached from the free list in batches, so the cost of 
+   *        synchronization is paid once per batch instead of once per object.
+   * 
+   *        Note: this function is thread safe, if you are in single
+   *              thread context evaluate to use unsafe_allocate() instead.
+   * 
+   * @param items   output array with room for at least @param count pointers.
+   * @param count   number of objects to be allocated.
+   * @param args    list of arguments forwarded, as const reference, to each
+   *                data_t() constructor.
+   * @return number of objects constructed and stored in @param items. 
+   *         Returned value can be less than @param count in the same 
+   *         circumstances where allocate() return nullptr.
+   */
+  template< typename... Args > 
+  constexpr inline size_type  allocate_n( pointer* items, size_type count, const Args&... args ) noexcept
+  { return allocate_n_imp( items, count, [&args...]( void* slot ) noexcept { return new(slot) value_type( args... ); } ); }
+
+  /**
+   * @brief Same as allocate_n(), but each object is constructed in place from std::move(*@param first), 
+   *        so value_type doesn't need a default constructor nor an assignment.
+   * 
+   * @param first   iterator advanced once for each object constructed; there must be at least 
+   *                @param count elements in the range.
+   * @return number of objects constructed and stored in @param items.
+   */
+  template< typename input_iterator_t > 
+  constexpr inline size_type  allocate_n_from( pointer* items, size_type count, input_iterator_t& first ) noexcept
+  { return allocate_n_imp( items, count, [&first]( void* slot ) noexcept { pointer ptr = new(slot) value_type( std::move(*first) ); ++first; return ptr; } ); }
+
+  /**
+   * @brief Deallocate memory for @param count pointers in @param items and invoke ~data_t()
+   *        for each of them. Consecutive pointers owned by the same arena, and with the same
+   *        home node, are linked together and released to the free list with a single operation.
+   * 
+   *        Note: this function is thread safe, if you are in single
+   *              thread context evaluate to use unsafe_deallocate() instead.
+   * 
+   *        Note: same restrictions of deallocate() apply.
+   *  
+   * @param items   array of pointers previously allocated with allocate() or allocate_n().
+   * @param count   number of pointers in @param items.
+   * @return core::result_t::eSuccess if all pointers have been released, otherwise 
+   *         core::result_t::eNullPointer or core::result_t::eDoubleFree for the last 
+   *         invalid pointer found; valid pointers are released in any case.
+   */
+  [[nodiscard]] static constexpr inline core::result_t deallocate_n( pointer* items, size_type count ) noexcept
+  {
+    core::result_t   result      = core::result_t::eSuccess;
+    arena_allocator* pChainArena = nullptr;
+    size_type        chainNode   = 0;
+    slot_pointer     pFirst      = nullptr;
+    slot_pointer     pLast       = nullptr;
+    size_type        slots       = 0;
+
+    std::atomic_thread_fence( std::memory_order_acquire );
+
+    for ( size_type i = 0; i < count; ++i )
+    {
+      if ( items[i] == nullptr )
+      {
+        result = core::result_t::eNullPointer;
+        continue;
+      }
+
+      slot_pointer     pSlot  = memory_slot::slot_from_user_data(items[i]);
+      arena_allocator* pArena = instances_table[pSlot->get_index()];
+
+      if ( pSlot->is_free() )
+      {
+        // double free detected, also when the same pointer is repeated in items
+        result = core::result_t::eDoubleFree;
+        continue;
+      }
+
+      items[i]->~value_type();
+
+      if ( ( ( pArena != pChainArena ) || ( pSlot->get_node() != chainNode ) ) && ( slots > 0 ) )
+      {
+        pChainArena->push_chain( chainNode, pFirst, pLast, slots );
+        slots = 0;
+      }
+
+      if ( slots == 0 )
+      {
+        pChainArena = pArena;
+        chainNode   = pSlot->get_node();
+        pLast       = pSlot;
+      }
+
+      pSlot->set_free( pFirst );
+      pFirst = pSlot;
+      ++slots;
+    }
+
+    if ( slots > 0 )
+    { pChainArena->push_chain( chainNode, pFirst, pLast, slots ); }
+
+    return result;
+  }
+
   /**
    * @brief Allocate memory for data_t() object and invoke
    *        constructur accordingly with parameters.
@@ -393,18 +725,33 @@ public:
   template< typename... Args >
   constexpr inline pointer    unsafe_allocate( Args&&... args ) noexcept
   { 
-    if (( _next_free.load( std::memory_order_relaxed ) == nullptr ) && ( alloc_threshold == 0 ))
-    { unsafe_add_mem_chuck(); } 
+    size_type node = local_node();
+    if ( ( alloc_threshold == 0 ) && ( free_list( node ).load( std::memory_order_relaxed ).get_address() == nullptr ) && ( has_bump_slots( node ) == false ) )
+    { unsafe_add_mem_chuck( node ); } 
 
-    slot_pointer pCurrSlot = _next_free.load( std::memory_order_relaxed );
-    if ( pCurrSlot == nullptr )
-      return nullptr;
+    if constexpr ( numa_nodes > 1 )
+    {
+      for ( size_type ndx = 1; ( ndx < numa_nodes ) && ( free_list( node ).load( std::memory_order_relaxed ).get_address() == nullptr ) && ( has_bump_slots( node ) == false ); ++ndx )
+      { node = (node+1)%numa_nodes; }
+    }
 
-    _next_free.exchange( pCurrSlot->next(), std::memory_order_relaxed );
+    std::atomic<tagged_pointer>& next_free = free_list( node );
+    tagged_pointer               currHead  = next_free.load( std::memory_order_relaxed );
+    slot_pointer                 pCurrSlot = currHead.get_address();
+    if ( pCurrSlot != nullptr )
+    {
+      next_free.store( tagged_pointer::next_tag( pCurrSlot->next(), currHead ), std::memory_order_relaxed );
 
-    pCurrSlot->set_in_use();
+      _free_slots.fetch_sub( 1, std::memory_order_relaxed );
+    }
+    else 
+    {
+      slot_pointer pLastSlot = nullptr;
+      if ( bump_chain( node, pCurrSlot, pLastSlot, 1 ) == 0 )
+        return nullptr;
+    }
 
-    _free_slots.fetch_sub( 1, std::memory_order_relaxed );
+    pCurrSlot->set_in_use();
 
     return new(pCurrSlot->prt()) value_type( std::forward<Args>(args)... );
   }
@@ -420,9 +767,9 @@ public:
    *  
    *        Note: only memory allocated by this arena_allocator can be deallocated.
    *              In case the user try to deallocate memory not managed from the arena_allocator
-   *              application will experience unexpected behaviour. Consistency check require O(n) 
-   *              where 'n' is the number of chunks allocated, so not implemented in order to have
-   *              deallocation with O(1).
+   *              application will experience unexpected behaviour. Consistency check is available
+   *              with is_valid(), in constant time, but it is not applied here since it requires 
+   *              a lock on the chunks.
    *   
    * @param userdata  pointer to user data previously allocated with allocate().
    */
@@ -442,9 +789,12 @@ public:
       return core::result_t::eDoubleFree;
     }
 
-    pSlot->set_free( pArena->_next_free.load( std::memory_order_relaxed ) );
+    std::atomic<tagged_pointer>& next_free = pArena->free_list( pSlot->get_node() );
+    tagged_pointer               currHead  = next_free.load( std::memory_order_relaxed );
+
+    pSlot->set_free( currHead.get_address() );
     
-    pArena->_next_free.exchange( pSlot, std::memory_order_relaxed );
+    next_free.store( tagged_pointer::next_tag( pSlot, currHead ), std::memory_order_relaxed );
 
     pArena->_free_slots.fetch_add( 1, std::memory_order_relaxed );
 
@@ -465,19 +815,16 @@ public:
 
     using addr_base_type = typename core::memory_address<memory_slot,size_type>::base_t;
 
-    const addr_base_type addr_offset = core::memory_address<memory_slot,size_type>::memory_address_size;
+    const addr_base_type addr_offset = memory_slot::user_data_offset;
+    const addr_base_type addr_slot   = std::bit_cast<addr_base_type>(userdata) - addr_offset;
 
     core::lock_guard<mutex_type> lock(_mtx_mem_chunks);
-    for ( auto& mc : _mem_chunks )
-    {
-      if (
-          ( std::bit_cast<addr_base_type>(userdata) >= std::bit_cast<addr_base_type>(mc._first_slot)+addr_offset ) && 
-          ( std::bit_cast<addr_base_type>(userdata) <= std::bit_cast<addr_base_type>(mc._last_slot )+addr_offset )
-         )
-         return true;
-    }
+    const void* pFirstSlot = _chunk_map.find( std::bit_cast<const void*>(addr_slot) );
+    if ( pFirstSlot == nullptr )
+      return false;
 
-    return false;
+    // userdata must be at the beginning of a slot.
+    return ( ( ( addr_slot - std::bit_cast<addr_base_type>(pFirstSlot) ) % memory_slot_size ) == 0 );
   }
 
   /**
@@ -494,145 +841,1010 @@ public:
 
     using addr_base_type = typename core::memory_address<memory_slot,size_type>::base_t;
 
-    const addr_base_type addr_offset = core::memory_address<memory_slot,size_type>::memory_address_size;
+    const addr_base_type addr_offset = memory_slot::user_data_offset;
+    const addr_base_type addr_slot   = std::bit_cast<addr_base_type>(userdata) - addr_offset;
 
-    for ( auto& mc : _mem_chunks )
-    {
-      if (
-          ( std::bit_cast<addr_base_type>(userdata) >= std::bit_cast<addr_base_type>(mc._first_slot)+addr_offset ) && 
-          ( std::bit_cast<addr_base_type>(userdata) <= std::bit_cast<addr_base_type>(mc._last_slot )+addr_offset )
-         )
-         return true;
-    }
+    const void* pFirstSlot = _chunk_map.find( std::bit_cast<const void*>(addr_slot) );
+    if ( pFirstSlot == nullptr )
+      return false;
 
-    return false;
+    // userdata must be at the beginning of a slot.
+    return ( ( ( addr_slot - std::bit_cast<addr_base_type>(pFirstSlot) ) % memory_slot_size ) == 0 );
   }
 
   /**
-   * @brief Invoke valut_type destructor for each slot that is in use,
-   *        then release all the memory associated with the chuncks.
-   *        After the call to this methos the allocator will completely 
-   *        empty and no memroy chunck are reserved.
+   * @brief Return a compact handle for @param userdata, to be stored in place of the pointer 
+   *        and resolved with from_handle(). The handle remains valid while the object is 
+   *        allocated.
    * 
-   *        Note: this method is not thread safe.
+   *        Note: this function is thread safe, it locks the chunks as is_valid() does.
+   * 
+   * @param userdata pointer to user data previously returned by allocate() or unsafe_allocate().
+   * @return null_handle if @param userdata is not managed by this arena_allocator, or if its 
+   *         chunk is beyond handle_max_chunks.
    */
-  constexpr inline void clear() noexcept
+  [[nodiscard]] inline handle_type to_handle( const_pointer userdata ) const
   {
-    for ( auto& mc : _mem_chunks )
-    {
-      // Iterate on overall slots in order to invoke ~value_type() 
-      // for all object currently in use.
-      slot_pointer mem_curs = mc._first_slot;
-      size_type    slots_nb = 0; 
-  
-      while ( slots_nb++ < chunk_size )
-      {
-        if ( mem_curs->in_use() == true )
-          mem_curs->prt()->~value_type();
-
-        mem_curs++;
-      }
-  
-      // Release memory allocated in the in the constructor.
-      _mem_allocator.deallocate( mc._first_slot, memory_required_per_chunk );
-      
-      mc.reset();
-    }
-    _mem_chunks.clear();
-    
-    // Update max_length
-    _max_length.store(       0, std::memory_order_release );
-    _free_slots.store(       0, std::memory_order_release );
-    _capacity.store  (       0, std::memory_order_release );
-    _next_free.store ( nullptr, std::memory_order_release );  
+    core::lock_guard<mutex_type> lock(_mtx_mem_chunks);
+    return unsafe_to_handle( userdata );
   }
 
-private:
-  /***/
-  constexpr inline bool add_mem_chuck() noexcept
+  /**
+   * @brief Same as to_handle() without locking the chunks.
+   */
+  [[nodiscard]] inline handle_type unsafe_to_handle( const_pointer userdata ) const
   {
-    memory_chunk _new_mem_chunck;
-   
-    _new_mem_chunck._first_slot = static_cast<slot_pointer>(_mem_allocator.allocate( memory_required_per_chunk ));
-    if ( _new_mem_chunck._first_slot == nullptr )
-    { return false; }
+    static_assert( handle_slot_bits < 32, "chunk_size is too big for 32 bits handles" );
 
-    _new_mem_chunck._last_slot  = _new_mem_chunck._first_slot+(chunk_size-1);
+    if ( userdata == nullptr )
+      return null_handle;
 
-    // Iterate on overall slots in order to initialize the slots chain.
-    slot_pointer mem_curs = _new_mem_chunck._first_slot;
-    size_type    slots_nb = chunk_size; 
-    while ( slots_nb-- )
-    {
-      mem_curs->set_index( _ndx_instance );
-      mem_curs->set_free ((slots_nb>0)?(mem_curs+1):nullptr);
+    using addr_base_type = typename core::memory_address<memory_slot,size_type>::base_t;
 
-      mem_curs++;
-    }
+    const addr_base_type addr_slot = std::bit_cast<addr_base_type>(userdata) - memory_slot::user_data_offset;
 
-    slot_pointer pCurrNext = _next_free.load( std::memory_order_acquire );
-    do
-    {
-      _new_mem_chunck._last_slot->set_free( pCurrNext );
+    uint32_t    id         = 0;
+    const void* pFirstSlot = _chunk_map.find( std::bit_cast<const void*>(addr_slot), &id );
+    if ( ( pFirstSlot == nullptr ) || ( id >= handle_max_chunks ) )
+      return null_handle;
 
-    } while ( !_next_free.compare_exchange_weak( pCurrNext, _new_mem_chunck._first_slot, std::memory_order_release, std::memory_order_relaxed ) );
-    
-    // Protect access to _next_free
-    _mtx_mem_chunks.lock();
+    const addr_base_type offset = addr_slot - std::bit_cast<addr_base_type>(pFirstSlot);
+    if ( ( offset % memory_slot_size ) != 0 )
+      return null_handle;
 
-        /////////////////////
-        // Store chunck information in a vector.
-        _mem_chunks.push_back(_new_mem_chunck);
-        
-        // Update max_length
-        _max_length.store( chunk_size*_mem_chunks.size(), std::memory_order_release );
-        _free_slots.fetch_add(chunk_size, std::memory_order_acq_rel);
+    return static_cast<handle_type>( ( id << handle_slot_bits ) | ( offset / memory_slot_size ) );
+  }
 
-        // Update capacity
-        _capacity.store( memory_required_per_chunk*_mem_chunks.size(), std::memory_order_release );
+  /**
+   * @brief Return the pointer for @param handle previously returned by to_handle(), lookups 
+   *        are lock free and with constant cost.
+   * 
+   *        Note: this function is thread safe.
+   * 
+   * @return nullptr for null_handle or if the chunk is not in the arena anymore.
+   */
+  [[nodiscard]] inline pointer     from_handle( handle_type handle ) const noexcept
+  {
+    if ( handle == null_handle )
+      return nullptr;
 
-    // Release _next_free mutex
-    _mtx_mem_chunks.unlock();
+    const size_type offset = static_cast<size_type>( handle & ((uint64_t(1) << handle_slot_bits) - 1) );
+    slot_pointer    pFirst = _chunk_table.load( handle >> handle_slot_bits );
+    if ( ( pFirst == nullptr ) || ( offset >= chunk_size ) )
+      return nullptr;
 
-    return true;
+    return (pFirst + offset)->prt();
+  }
+
+  /**
+   * @brief Release chunks that have no slots in use while the number of free slots exceeds 
+   *        @param watermark by at least one chunk; chunks reserved with initial_size are kept.
+   *        Free lists are detached while chunks are inspected, meanwhile other threads see 
+   *        them empty and use untouched slots or grow the arena.
+   *        Released chunks are not returned to allocator_t, since a concurrent allocate() can 
+   *        still read links from their slots: physical pages are given back with 
+   *        allocator_t::discard(), when available, while the address range is cached and 
+   *        reused by the next growth. Cached chunks are deallocated by clear().
+   *        Slots cached in thread magazines are accounted as in use.
+   * 
+   *        Note: this function is thread safe.
+   * 
+   * @return number of slots released.
+   */
+  constexpr inline size_type  shrink_to( size_type watermark ) noexcept
+  {
+    core::lock_guard<mutex_type> lock(_mtx_mem_chunks);
+
+    const size_type reserved = chunk_size * ((initial_size + chunk_size - 1) / chunk_size);
+    if ( ( _free_slots.load( order_t::acquire ) < watermark + chunk_size ) || ( chunk_size*_mem_chunks.size() <= reserved ) )
+    {
+      update_trim_mark( _free_slots.load( order_t::acquire ) );
+      return 0;
+    }
+
+    // Detach all free lists, from now on slots in the chains are owned by this thread.
+    std::array<slot_pointer,numa_nodes>      chains;
+    std::unordered_map<const void*,size_type> free_per_chunk;
+    size_type                                 detached = 0;
+    for ( size_type node = 0; node < numa_nodes; ++node )
+    {
+      std::atomic<tagged_pointer>& next_free = free_list( node );
+      tagged_pointer               currHead  = next_free.load( order_t::acquire );
+      while ( !next_free.compare_exchange_weak( currHead, tagged_pointer::next_tag( nullptr, currHead ), order_t::acq_rel, order_t::acquire ) )
+      {}
+
+      chains[node] = currHead.get_address();
+      for ( slot_pointer pSlot = chains[node]; pSlot != nullptr; pSlot = pSlot->next() )
+      { 
+        ++free_per_chunk[_chunk_map.find( pSlot )]; 
+        ++detached;
+      }
+    }
+    _free_slots.fetch_sub( detached, order_t::relaxed );
+
+    const size_type cached    = _cached_chunks.size();
+    size_type       released  = 0;
+    size_type       available = _free_slots.load( order_t::acquire ) + detached;
+    for ( size_type ndx = 0; ( ndx < _mem_chunks.size() ) && ( available >= watermark + chunk_size ) && ( chunk_size*_mem_chunks.size() > reserved ); )
+    {
+      chunk_header*   pHeader    = _mem_chunks[ndx]._header;
+      size_type       high_water = pHeader->_high_water.load( order_t::acquire );
+      const size_type used_nb    = std::min( high_water, chunk_size );
+      const auto      it         = free_per_chunk.find( _mem_chunks[ndx]._first_slot );
+      const size_type free_nb    = ( it != free_per_chunk.end() )?it->second:0;
+
+      // All slots handed out are in the detached chains, untouched slots are claimed 
+      // here so that bump_chain() can't use them anymore.
+      if ( ( free_nb != used_nb ) || 
+           ( ( high_water < chunk_size ) && !pHeader->_high_water.compare_exchange_strong( high_water, chunk_size, order_t::acq_rel ) ) )
+      {
+        ++ndx;
+        continue;
+      }
+
+      _chunk_map.erase( _mem_chunks[ndx]._first_slot );
+      _chunk_table.store( pHeader->_id, nullptr );
+      _cached_chunks.push_back( pHeader );
+
+      _mem_chunks[ndx] = _mem_chunks.back();
+      _mem_chunks.pop_back();
+
+      // Untouched slots were accounted as free.
+      _free_slots.fetch_sub( chunk_size - used_nb, order_t::relaxed );
+      detached  -= free_nb;
+      available -= chunk_size;
+      released  += chunk_size;
+    }
+
+    _max_length.store( chunk_size*_mem_chunks.size(), order_t::release );
+    _capacity.store( memory_allocated_per_chunk*_mem_chunks.size(), order_t::release );
+    update_trim_mark( available );
+
+    // Slots of released chunks are no longer in _chunk_map, the others go back to their lists.
+    for ( size_type node = 0; node < numa_nodes; ++node )
+    {
+      slot_pointer pFirst = nullptr;
+      slot_pointer pLast  = nullptr;
+      size_type    count  = 0;
+      for ( slot_pointer pSlot = chains[node]; pSlot != nullptr; )
+      {
+        slot_pointer pNext = pSlot->next();
+        if ( _chunk_map.find( pSlot ) != nullptr )
+        {
+          if ( pLast == nullptr )
+            pFirst = pSlot;
+          else
+            pLast->set_free( pSlot );
+          pLast = pSlot;
+          ++count;
+        }
+        pSlot = pNext;
+      }
+
+      if ( count > 0 )
+      { push_chain( node, pFirst, pLast, count ); }
+    }
+
+    // Links in the released slots are not needed anymore.
+    if constexpr ( requires ( void* ptr ) { allocator_type::discard( ptr, memory_allocated_per_chunk ); } )
+    {
+      for ( size_type ndx = cached; ndx < _cached_chunks.size(); ++ndx )
+      { _mem_allocator.discard( first_slot( _cached_chunks[ndx] ), memory_slot_size*chunk_size ); }
+    }
+
+    return released;
+  }
+
+  /**
+   * @brief Release all chunks that have no slots in use, except those reserved with initial_size.
+   *        See shrink_to().
+   * 
+   * @return number of slots released.
+   */
+  constexpr inline size_type  trim() noexcept
+  { return shrink_to( 0 ); }
+
+  /**
+   * @brief Enable automatic trimming, when after a deallocation free slots are more than 
+   *        @param high_watermark core::refill_service invokes shrink_to( @param low_watermark ). 
+   *        @param high_watermark is raised to at least @param low_watermark plus one chunk, and 
+   *        it should be above alloc_threshold plus one chunk, otherwise the arena can oscillate 
+   *        between growth and trimming. When no chunk can be released the next request is done
+   *        only after free slots increased by one more chunk.
+   *        A @param high_watermark equal to 0 disables automatic trimming, that is the default.
+   * 
+   *        Note: this function is not thread safe, it should be invoked before sharing the arena.
+   */
+  inline void  set_trim_watermarks( size_type high_watermark, size_type low_watermark ) noexcept
+  {
+    _trim_low  = low_watermark;
+    _trim_high = ( high_watermark > 0 )?std::max( high_watermark, low_watermark + chunk_size ):0;
+
+    if ( ( _trim_high > 0 ) && ( _refill_client == nullptr ) )
+    { _refill_client = core::refill_service::instance().subscribe( this, &arena_allocator::refill ); }
+
+    update_trim_mark();
+  }
+
+  /**
+   * @brief Invoke valut_type destructor for each slot that is in use,
+   *        then release all the memory associated with the chuncks.
+   *        After the call to this methos the allocator will completely 
+   *        empty and no memroy chunck are reserved.
+   * 
+   *        Note: this method is not thread safe.
+   */
+  constexpr inline void clear() noexcept
+  {
+    for ( auto& mc : _mem_chunks )
+    {
+      // Iterate on overall slots in order to invoke ~value_type() 
+      // for all object currently in use.
+      // Slots above the high water mark have never been initialized.
+      slot_pointer    mem_curs = mc._first_slot;
+      const size_type used_nb  = std::min( mc._header->_high_water.load( std::memory_order_acquire ), chunk_size );
+      size_type       slots_nb = 0; 
+  
+      while ( slots_nb++ < used_nb )
+      {
+        if ( mem_curs->in_use() == true )
+          mem_curs->prt()->~value_type();
+
+        mem_curs++;
+      }
+  
+      // Release memory allocated in the in the constructor.
+      release_chunk( mc._header );
+      
+      mc.reset();
+    }
+    _mem_chunks.clear();
+    _chunk_map.clear();
+    _chunk_table.clear();
+    _next_chunk_id = 0;
+
+    // Chunks released by shrink_to() have no slots in use.
+    for ( chunk_header* pHeader : _cached_chunks )
+    { release_chunk( pHeader ); }
+    _cached_chunks.clear();
+    
+    // Update max_length
+    _max_length.store(       0, std::memory_order_release );
+    _free_slots.store(       0, std::memory_order_release );
+    _capacity.store  (       0, std::memory_order_release );
+    for ( auto& list : _free_lists )
+    { 
+      list._next_free.store ( tagged_pointer(), std::memory_order_release ); 
+      list._bump_chunk.store( tagged_chunk(), std::memory_order_release ); 
+    }
+
+    // Slots cached in thread magazines belong to released chunks.
+    _epoch.store( next_epoch(), std::memory_order_release );
+  }
+
+private:
+  /**
+   * @brief Body of allocate_n() and allocate_n_from(), @param construct( void* ) builds the object in a slot.
+   */
+  template< typename construct_t > 
+  constexpr inline size_type  allocate_n_imp( pointer* items, size_type count, construct_t&& construct ) noexcept
+  { 
+    size_type allocated = 0;
+
+    if constexpr ( magazine_size > 0 )
+    {
+      magazine_t& mag = local_magazine();
+      while ( ( allocated < count ) && ( mag._count > 0 ) )
+      {
+        slot_pointer pCurrSlot = mag.pop();
+        pCurrSlot->set_in_use();
+        items[allocated++] = construct( pCurrSlot->prt() );
+      }
+    }
+
+    const size_type node = local_node();
+    while ( allocated < count )
+    {
+      check_threshold( node );
+
+      slot_pointer pFirst = nullptr;
+      slot_pointer pLast  = nullptr;
+      size_type    slots  = pop_any( node, pFirst, pLast, count - allocated );
+      if ( slots == 0 ) [[unlikely]]
+        break;
+
+      slot_pointer pCurrSlot = pFirst;
+      for ( size_type i = 0; i < slots; ++i )
+      {
+        slot_pointer pNext = pCurrSlot->next();
+        pCurrSlot->set_in_use();
+        items[allocated++] = construct( pCurrSlot->prt() );
+        pCurrSlot = pNext;
+      }
+    }
+
+    if ( allocated < count ) [[unlikely]]
+    { _stats.add( core::stats_event_t::alloc_miss ); }
+
+    return allocated;
+  }
+
+  /***/
+  struct magazine_t {
+    /***/
+    constexpr inline slot_pointer pop() noexcept
+    {
+      slot_pointer pSlot = _head;
+      if ( pSlot != nullptr )
+      {
+        _head = pSlot->next();
+        --_count;
+      }
+      return pSlot;
+    }
+
+    /***/
+    constexpr inline void         push( slot_pointer pSlot ) noexcept
+    {
+      pSlot->set_free( _head );
+      _head = pSlot;
+      ++_count;
+    }
+
+    slot_pointer   _head  = nullptr;
+    size_type      _count = 0;
+    uint32_t       _epoch = 0;
+  };
+
+  /**
+   * @brief Arena published for each instance index to exiting threads: a thread pins the index before 
+   *        to load _arena, while the destructor clears _arena and then waits for pins to drop to 0. 
+   *        All operations are seq_cst, so either the thread sees nullptr or the destructor sees its pin.
+   */
+  struct exit_guard_t {
+    std::atomic<arena_allocator*>  _arena{nullptr};
+    std::atomic<uint32_t>          _pins{0};
+  };
+
+  /**
+   * @brief Magazines for all arena instances of this type owned by the calling thread.
+   *        When the thread exits, slots still cached are returned to the owning arena, 
+   *        if it is still alive; the arena can't be destroyed while they are returned.
+   */
+  struct magazines_t {
+    /***/
+    inline ~magazines_t() noexcept
+    {
+      for ( size_type ndx = 0; ndx < max_instances_per_type; ++ndx )
+      {
+        magazine_t& mag = _items[ndx];
+        if ( mag._count == 0 )
+          continue;
+
+        exit_guard_t& guard = s_exit_guards[ndx];
+        guard._pins.fetch_add( 1, std::memory_order_seq_cst );
+
+        arena_allocator* pArena = guard._arena.load( std::memory_order_seq_cst );
+        if ( ( pArena != nullptr ) && ( pArena->_epoch.load( std::memory_order_acquire ) == mag._epoch ) )
+        { pArena->flush_magazine( mag, mag._count ); }
+
+        guard._pins.fetch_sub( 1, std::memory_order_release );
+      }
+    }
+
+    std::array<magazine_t,max_instances_per_type>  _items;
+  };
+
+  static constexpr const size_type magazine_batch = (magazine_size > 1)?(magazine_size / 2):1;
+
+  /**
+   * @brief Return an identifier unique for each arena life-cycle, 0 is never returned.
+   */
+  static inline uint32_t next_epoch() noexcept
+  {
+    static std::atomic<uint32_t>  s_epoch{0};
+
+    uint32_t epoch = 0;
+    do{
+      epoch = s_epoch.fetch_add( 1, std::memory_order_relaxed ) + 1;
+    } while ( epoch == 0 );
+
+    return epoch;
+  }
+
+  /**
+   * @brief Return the magazine that the calling thread owns for this arena instance.
+   *        If the magazine was filled by a previous arena that used the same instance 
+   *        index, or before a clear(), its content is discarded since the memory has
+   *        already been released.
+   */
+  inline magazine_t&    local_magazine() noexcept
+  {
+    magazine_t&    mag   = _th_magazines._items[_ndx_instance];
+    const uint32_t epoch = _epoch.load( std::memory_order_relaxed );
+    if ( mag._epoch != epoch ) [[unlikely]]
+    {
+      mag._head  = nullptr;
+      mag._count = 0;
+      mag._epoch = epoch;
+    }
+    return mag;
+  }
+
+  /**
+   * @brief Move up to magazine_batch slots from the shared free list to @param mag.
+   */
+  constexpr inline void refill_magazine( magazine_t& mag ) noexcept
+  {
+    const size_type node = local_node();
+    check_threshold( node );
+
+    slot_pointer pFirst = nullptr;
+    slot_pointer pLast  = nullptr;
+    size_type    count  = pop_any( node, pFirst, pLast, magazine_batch );
+    if ( count == 0 )
+      return;
+
+    pLast->set_free( mag._head );
+    mag._head   = pFirst;
+    mag._count += count;
+  }
+
+  /**
+   * @brief Move @param count slots from @param mag to the shared free list.
+   */
+  constexpr inline void flush_magazine( magazine_t& mag, size_type count ) noexcept
+  {
+    slot_pointer pFirst = mag._head;
+    slot_pointer pLast  = pFirst;
+    for ( size_type ndx = 1; ndx < count; ++ndx )
+    { pLast = pLast->next(); }
+
+    mag._head   = pLast->next();
+    mag._count -= count;
+
+    if constexpr ( numa_nodes > 1 )
+      release_chain( pFirst, count );
+    else
+      push_chain( 0, pFirst, pLast, count );
+  }
+
+  /**
+   * @brief Request a refill to core::refill_service when free slots are below alloc_threshold or,
+   *        when alloc_threshold is 0, synchronously add a new chunk if there are no 
+   *        free slots.
+   *        With numa_nodes > 1 growth is requested also when the free list of @param node 
+   *        is empty, and the new chunk is bound to @param node.
+   */
+  constexpr inline void check_threshold( size_type node ) noexcept
+  {
+    if ( alloc_threshold > 0 ) [[likely]]
+    {
+      if ( ( _free_slots.load( order_t::acquire ) <= alloc_threshold ) ||
+           ( ( numa_nodes > 1 ) && ( free_list( node ).load( order_t::acquire ).get_address() == nullptr ) && ( has_bump_slots( node ) == false ) ) ) 
+      { 
+        _grow_node.store( node, order_t::relaxed );
+        _refill_client->request(); 
+      }
+    }
+    else if ( ( free_list( node ).load( order_t::acquire ).get_address() == nullptr ) && ( has_bump_slots( node ) == false ) ) [[unlikely]] // && ( alloc_threshold == 0 ) second part is implicit.
+    { add_mem_chuck( node ); } 
+  }
+
+  /**
+   * @brief Invoked by core::refill_service, add one chunk for the node that requested it 
+   *        and then keep adding chunks, up to @param depth in total, while free slots are 
+   *        not above alloc_threshold plus (depth-1) chunks. 
+   *        A pending trim request is served first, and growth is skipped if free slots
+   *        remain above alloc_threshold.
+   */
+  static inline void refill( void* owner, std::size_t depth ) noexcept
+  {
+    arena_allocator* pArena = static_cast<arena_allocator*>(owner);
+
+    if ( pArena->_trim_pending.exchange( false, std::memory_order_acq_rel ) )
+    {
+      pArena->shrink_to( pArena->_trim_low );
+      if ( pArena->_free_slots.load( std::memory_order_acquire ) > alloc_threshold )
+        return;
+    }
+
+    if ( alloc_threshold == 0 )
+      return;
+
+    const size_type  node   = pArena->_grow_node.load( std::memory_order_relaxed );
+    const size_type  target = alloc_threshold + static_cast<size_type>(depth-1)*chunk_size;
+
+    for ( std::size_t ndx = 0; ndx < depth; ++ndx )
+    {
+      if ( ( ndx > 0 ) && ( pArena->_free_slots.load( std::memory_order_acquire ) > target ) )
+        break;
+
+      if (( pArena->max_length() >= size_limit ) && (size_limit > 0))
+        break;
+
+      if ( pArena->add_mem_chuck( node ) == false )
+      {
+        // Reached physical memory limit
+        break;
+      }
+    }
+  }
+
+  /**
+   * @brief Return the NUMA node of the calling thread, always 0 when numa_nodes is 1.
+   *        The node is cached and refreshed every node_refresh_rate calls, in order to 
+   *        follow thread migrations without a system call on each allocation.
+   */
+  static inline size_type local_node() noexcept
+  {
+    if constexpr ( numa_nodes == 1 )
+    { return 0; }
+    else
+    {
+      static thread_local size_type th_node  = 0;
+      static thread_local uint32_t  th_calls = 0;
+
+      if ( ( th_calls++ % node_refresh_rate ) == 0 ) [[unlikely]]
+      { th_node = core::numa::current_node() % numa_nodes; }
+
+      return th_node;
+    }
+  }
+
+  /***/
+  constexpr inline std::atomic<tagged_pointer>& free_list( size_type node ) noexcept
+  { return _free_lists[node]._next_free; }
+
+  /**
+   * @brief Same as pop_chain(), but when the free list of @param node is empty slots are 
+   *        taken from the untouched tail of its last chunk, then the other nodes are tried
+   *        in sequence.
+   *        Recycled slots are preferred to untouched ones, so pages of a new chunk are 
+   *        faulted in only when there is nothing else to reuse.
+   */
+  constexpr inline size_type pop_any( size_type node, slot_pointer& first, slot_pointer& last, size_type max_slots ) noexcept
+  {
+    size_type count = 0;
+    for ( size_type ndx = 0; ( count == 0 ) && ( ndx < numa_nodes ); ++ndx )
+    {
+      const size_type curr = (node+ndx)%numa_nodes;
+
+      count = pop_chain( curr, first, last, max_slots );
+      if ( count == 0 )
+      { count = bump_chain( curr, first, last, max_slots ); }
+    }
+    return count;
+  }
+
+  /***/
+  constexpr inline bool has_bump_slots( size_type node ) const noexcept
+  {
+    for ( const chunk_header* pHeader = _free_lists[node]._bump_chunk.load( std::memory_order_acquire ).get_address(); pHeader != nullptr; pHeader = pHeader->_next )
+    {
+      if ( pHeader->_high_water.load( std::memory_order_relaxed ) < chunk_size )
+        return true;
+    }
+    return false;
+  }
+
+  /***/
+  static constexpr inline slot_pointer first_slot( chunk_header* pHeader ) noexcept
+  { return std::bit_cast<slot_pointer>(std::bit_cast<char*>(pHeader)+chunk_header_size); }
+
+  /**
+   * @brief Claim up to @param max_slots untouched slots from the chunks of @param node 
+   *        moving forward the high water mark of the first one, claimed slots are 
+   *        initialized and linked as a chain from @param first to @param last.
+   *        Exhausted chunks are detached, the generation tag on the head makes this ABA safe
+   *        also when a cached chunk is linked again by add_mem_chuck().
+   * 
+   * @return number of claimed slots, 0 if there are no untouched slots.
+   */
+  constexpr inline size_type bump_chain( size_type node, slot_pointer& first, slot_pointer& last, size_type max_slots ) noexcept
+  {
+    std::atomic<tagged_chunk>&  bump_chunk = _free_lists[node]._bump_chunk;
+    tagged_chunk                currHead   = bump_chunk.load( order_t::acquire );
+    chunk_header*               pHeader    = currHead.get_address();
+    size_type                   offset     = chunk_size;
+    while ( pHeader != nullptr )
+    {
+      if ( pHeader->_high_water.load( order_t::relaxed ) < chunk_size ) [[likely]]
+      {
+        // High water mark can go beyond chunk_size, exceeding slots are simply not assigned.
+        offset = pHeader->_high_water.fetch_add( max_slots, order_t::relaxed );
+        if ( offset < chunk_size )
+          break;
+      }
+
+      const tagged_chunk nextHead = tagged_chunk::next_tag( pHeader->_next, currHead );
+      if ( bump_chunk.compare_exchange_weak( currHead, nextHead, order_t::acq_rel, order_t::acquire ) )
+      { 
+        pHeader->_in_chain.store( false, order_t::release );
+        currHead = nextHead; 
+      }
+      pHeader = currHead.get_address();
+    }
+
+    if ( pHeader == nullptr )
+      return 0;
+
+    const size_type count = std::min( max_slots, chunk_size - offset );
+
+    first = first_slot( pHeader ) + offset;
+    last  = first + (count-1);
+    
+    slot_pointer mem_curs = first;
+    for ( size_type ndx = 1; ndx <= count; ++ndx )
+    {
+      mem_curs->set_index( _ndx_instance );
+      mem_curs->set_node ( node );
+      mem_curs->set_free ((ndx<count)?(mem_curs+1):nullptr);
+
+      mem_curs++;
+    }
+
+    _free_slots.fetch_sub( count, order_t::relaxed );
+
+    return count;
+  }
+
+  /**
+   * @brief Detach exhausted chunks from the head of the chain of @param node, so that 
+   *        chunks cached by shrink_to() can be linked again.
+   */
+  constexpr inline void     prune_bump_chain( size_type node ) noexcept
+  {
+    std::atomic<tagged_chunk>& bump_chunk = _free_lists[node]._bump_chunk;
+    tagged_chunk               currHead   = bump_chunk.load( std::memory_order_acquire );
+    for ( chunk_header* pHeader = currHead.get_address(); 
+          ( pHeader != nullptr ) && ( pHeader->_high_water.load( std::memory_order_relaxed ) >= chunk_size ); 
+          pHeader = currHead.get_address() )
+    {
+      const tagged_chunk nextHead = tagged_chunk::next_tag( pHeader->_next, currHead );
+      if ( bump_chunk.compare_exchange_weak( currHead, nextHead, std::memory_order_acq_rel, std::memory_order_acquire ) )
+      { 
+        pHeader->_in_chain.store( false, std::memory_order_release );
+        currHead = nextHead; 
+      }
+    }
+  }
+
+  /**
+   * @brief Link a new chunk, with all slots untouched, to the chunks of @param node.
+   */
+  constexpr inline void     push_bump_chunk( size_type node, chunk_header* pHeader ) noexcept
+  {
+    std::atomic<tagged_chunk>& bump_chunk = _free_lists[node]._bump_chunk;
+    tagged_chunk               currHead   = bump_chunk.load( std::memory_order_relaxed );
+
+    pHeader->_in_chain.store( true, std::memory_order_relaxed );
+    do{
+      pHeader->_next = currHead.get_address();
+    } while ( !bump_chunk.compare_exchange_weak( currHead, tagged_chunk::next_tag( pHeader, currHead ), std::memory_order_release, std::memory_order_relaxed ) );
+  }
+
+  /**
+   * @brief Return @param count slots linked from @param first to the free list of their home node,
+   *        consecutive slots with the same home node are attached with a single CAS.
+   */
+  constexpr inline void     release_chain( slot_pointer first, size_type count ) noexcept
+  {
+    while ( count > 0 )
+    {
+      const size_type node  = first->get_node();
+      slot_pointer    pLast = first;
+      size_type       run   = 1;
+      while ( ( run < count ) && ( pLast->next()->get_node() == node ) )
+      {
+        pLast = pLast->next();
+        ++run;
+      }
+
+      // push_chain() overwrite the link in pLast
+      slot_pointer pNext = pLast->next();
+      push_chain( node, first, pLast, run );
+
+      first  = pNext;
+      count -= run;
+    }
+  }
+
+  /**
+   * @brief Detach up to @param max_slots consecutive slots from the shared free list 
+   *        with a single CAS.
+   *        Walking the chain is safe since links between free slots can be modified only
+   *        by a successful CAS on the free list, which also updates the generation tag, so 
+   *        if the CAS succeeds the chain read is still consistent.
+   * 
+   * @param node       NUMA node of the free list.
+   * @param first      output parameter, first slot of the detached chain.
+   * @param last       output parameter, last slot of the detached chain.
+   * @param max_slots  max number of slots to detach, must be greater than 0.
+   * @return number of detached slots, 0 if the free list is empty.
+   */
+  constexpr inline size_type pop_chain( size_type node, slot_pointer& first, slot_pointer& last, size_type max_slots ) noexcept
+  {
+    if constexpr ( slot_layout == core::slot_layout_t::overlay )
+    {
+      // Links overlay user data, so a link read from a slot that has just been allocated by 
+      // another thread can be garbage; it is harmless when the CAS fails, but the chain can't 
+      // be walked beyond the head, then slots are detached one by one.
+      size_type count = 0;
+      while ( count < max_slots )
+      {
+        slot_pointer pSlot = nullptr;
+        slot_pointer pLast = nullptr;
+        if ( pop_chain_imp( node, pSlot, pLast, 1 ) == 0 )
+          break;
+
+        if ( count == 0 )
+          first = pSlot;
+        else
+          last->set_free( pSlot );
+
+        last = pSlot;
+        ++count;
+      }
+
+      if ( count > 0 )
+      { last->set_free( nullptr ); }
+
+      return count;
+    }
+    else
+    {
+      return pop_chain_imp( node, first, last, max_slots );
+    }
   }
 
   /***/
-  constexpr inline bool unsafe_add_mem_chuck() noexcept
+  constexpr inline size_type pop_chain_imp( size_type node, slot_pointer& first, slot_pointer& last, size_type max_slots ) noexcept
   {
+    std::atomic<tagged_pointer>& next_free = free_list( node );
+    size_type                    count     = 0;
+    tagged_pointer               currHead  = next_free.load( order_t::acquire );
+    for (;;)
+    {
+      first = currHead.get_address();
+      if ( first == nullptr ) [[unlikely]]
+        return 0;
+
+      slot_pointer pNext = first->next();
+
+      last  = first;
+      count = 1;
+      while ( ( count < max_slots ) && ( pNext != nullptr ) )
+      {
+        last  = pNext;
+        pNext = last->next();
+        ++count;
+      }
+
+      if ( next_free.compare_exchange_weak( currHead, tagged_pointer::next_tag( pNext, currHead ), order_t::acq_rel, order_t::acquire ) == false )
+      { _stats.add( core::stats_event_t::cas_failure ); continue; }
+      
+      break;
+    }
+
+    _free_slots.fetch_sub( count, order_t::relaxed );
+
+    return count;
+  }
+
+  /**
+   * @brief Attach a chain of @param count free slots, already linked from @param first 
+   *        to @param last, to the free list of @param node with a single CAS.
+   */
+  constexpr inline void     push_chain( size_type node, slot_pointer first, slot_pointer last, size_type count ) noexcept
+  {
+    std::atomic<tagged_pointer>& next_free = free_list( node );
+    tagged_pointer               currHead  = next_free.load( order_t::relaxed );
+
+    last->set_free( currHead.get_address() );
+    while ( !next_free.compare_exchange_weak( currHead, tagged_pointer::next_tag( first, currHead ), order_t::acq_rel, order_t::acquire ) )
+    {
+      _stats.add( core::stats_event_t::cas_failure );
+      last->set_free( currHead.get_address() );
+    }
+   
+    const size_type free_slots = _free_slots.fetch_add( count, order_t::relaxed ) + count;
+    if ( free_slots > _trim_mark.load( order_t::relaxed ) ) [[unlikely]]
+    { request_trim(); }
+  }
+
+  /**
+   * @brief Ask core::refill_service to run shrink_to(), requests are coalesced.
+   */
+  inline void               request_trim() noexcept
+  {
+    if ( _trim_pending.exchange( true, std::memory_order_acq_rel ) == false )
+    { _refill_client->request(); }
+  }
+
+  /**
+   * @brief Free slots above which trimming is requested, after a trim that left @param free_slots 
+   *        free the next request is done when they increased by one more chunk.
+   */
+  constexpr inline void     update_trim_mark( size_type free_slots = 0 ) noexcept
+  {
+    _trim_mark.store( ( _trim_high > 0 )?std::max( _trim_high, free_slots + chunk_size ):std::numeric_limits<size_type>::max(), std::memory_order_relaxed );
+  }
+
+  /**
+   * @brief Allocate memory for a new chunk bound to @param node and construct its header.
+   */
+  constexpr inline chunk_header* create_chunk( size_type node ) noexcept
+  {
+    void* pMemory = _mem_allocator.allocate( memory_allocated_per_chunk );
+    if ( pMemory == nullptr )
+    { return nullptr; }
+
+    void* pChunk = pMemory;
+    if constexpr ( chunk_alignment > 1 )
+    { pChunk = std::bit_cast<void*>( (std::bit_cast<uintptr_t>(pMemory) + (chunk_alignment-1)) & ~static_cast<uintptr_t>(chunk_alignment-1) ); }
+
+    if constexpr ( numa_nodes > 1 )
+    { core::numa::bind( pChunk, memory_required_per_chunk, static_cast<uint32_t>(node) ); }
+
+    return new(pChunk) chunk_header{ 0, nullptr, _ndx_instance, node, pMemory, 0, false };
+  }
+
+  /**
+   * @brief Assign an identifier to a new chunk and add it to the lookup tables.
+   *        Must be called with _mtx_mem_chunks locked.
+   */
+  constexpr inline void     register_chunk( const memory_chunk& mc ) noexcept
+  {
+    mc._header->_id = _next_chunk_id++;
+    _chunk_map.insert( mc._first_slot, mc._header->_id );
+    _chunk_table.store( mc._header->_id, mc._first_slot );
+  }
+
+  /**
+   * @brief Destroy the header and give memory back to allocator_t.
+   */
+  constexpr inline void     release_chunk( chunk_header* pHeader ) noexcept
+  {
+    void* pMemory = pHeader->_memory;
+    pHeader->~chunk_header();
+    _mem_allocator.deallocate( pMemory, memory_allocated_per_chunk );
+  }
+
+  /**
+   * @brief Link again a chunk of @param node released by shrink_to(), all its slots are
+   *        untouched. Chunks still linked to a bump chain are skipped, since they can't be 
+   *        linked twice. Must be called with _mtx_mem_chunks locked.
+   * 
+   * @return false if no cached chunk is available.
+   */
+  constexpr inline bool     unsafe_reuse_chunk( size_type node ) noexcept
+  {
+    if ( _cached_chunks.empty() )
+      return false;
+
+    prune_bump_chain( node );
+
+    for ( auto it = _cached_chunks.begin(); it != _cached_chunks.end(); ++it )
+    {
+      chunk_header* pHeader = *it;
+      if ( ( pHeader->_node != node ) || pHeader->_in_chain.load( std::memory_order_acquire ) )
+        continue;
+
+      *it = _cached_chunks.back();
+      _cached_chunks.pop_back();
+
+      memory_chunk _new_mem_chunck;
+      _new_mem_chunck._header     = pHeader;
+      _new_mem_chunck._first_slot = first_slot( pHeader );
+      _new_mem_chunck._last_slot  = _new_mem_chunck._first_slot+(chunk_size-1);
+
+      // Slots must be accounted before they can be claimed.
+      _free_slots.fetch_add( chunk_size, std::memory_order_acq_rel );
+      pHeader->_high_water.store( 0, std::memory_order_release );
+      push_bump_chunk( node, pHeader );
+
+      _mem_chunks.push_back(_new_mem_chunck);
+      _chunk_map.insert( _new_mem_chunck._first_slot, pHeader->_id );
+      _chunk_table.store( pHeader->_id, _new_mem_chunck._first_slot );
+
+      _max_length.store( chunk_size*_mem_chunks.size(), std::memory_order_release );
+      _capacity.store( memory_allocated_per_chunk*_mem_chunks.size(), std::memory_order_release );
+
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Add a new chunk bound to @param node, slots are not initialized here but
+   *        on demand by bump_chain(), so the cost is independent from chunk_size and
+   *        memory is faulted in only when used. Chunks cached by shrink_to() are reused
+   *        before asking new memory to allocator_t.
+   */
+  constexpr inline bool add_mem_chuck( size_type node ) noexcept
+  {
+    {
+      core::lock_guard<mutex_type> lock(_mtx_mem_chunks);
+      if ( unsafe_reuse_chunk( node ) )
+      {
+        _stats.add( core::stats_event_t::chunk_growth );
+        return true;
+      }
+    }
+
     memory_chunk _new_mem_chunck;
    
-    _new_mem_chunck._first_slot = static_cast<slot_pointer>(_mem_allocator.allocate( memory_required_per_chunk ));
-    if ( _new_mem_chunck._first_slot == nullptr )
+    _new_mem_chunck._header     = create_chunk( node );
+    if ( _new_mem_chunck._header == nullptr )
     { return false; }
 
+    _new_mem_chunck._first_slot = first_slot( _new_mem_chunck._header );
     _new_mem_chunck._last_slot  = _new_mem_chunck._first_slot+(chunk_size-1);
 
-    // Iterate on overall slots in order to initialize the slots chain.
-    slot_pointer mem_curs = _new_mem_chunck._first_slot;
-    size_type    slots_nb = chunk_size; 
-    while ( slots_nb-- )
-    {
-      mem_curs->set_index( _ndx_instance );
-      mem_curs->set_free((slots_nb>0)?(mem_curs+1):nullptr);
+    // Protect access to _mem_chunks
+    _mtx_mem_chunks.lock();
 
-      mem_curs++;
+        /////////////////////
+        // Store chunck information in a vector.
+        // The chunk is registered before its slots can be claimed, since shrink_to() 
+        // looks up in _chunk_map each free slot.
+        _mem_chunks.push_back(_new_mem_chunck);
+        register_chunk( _new_mem_chunck );
+
+        // Slots must be accounted before they can be claimed.
+        _free_slots.fetch_add(chunk_size, std::memory_order_acq_rel);
+
+        push_bump_chunk( node, _new_mem_chunck._header );
+        
+        // Update max_length
+        _max_length.store( chunk_size*_mem_chunks.size(), std::memory_order_release );
+
+        // Update capacity
+        _capacity.store( memory_allocated_per_chunk*_mem_chunks.size(), std::memory_order_release );
+
+    // Release _mem_chunks mutex
+    _mtx_mem_chunks.unlock();
+
+    _stats.add( core::stats_event_t::chunk_growth );
+
+    return true;
+  }
+
+  /***/
+  constexpr inline bool unsafe_add_mem_chuck( size_type node ) noexcept
+  {
+    if ( unsafe_reuse_chunk( node ) )
+    {
+      _stats.add( core::stats_event_t::chunk_growth );
+      return true;
     }
 
-    _new_mem_chunck._last_slot->set_free( _next_free );
+    memory_chunk _new_mem_chunck;
+   
+    _new_mem_chunck._header     = create_chunk( node );
+    if ( _new_mem_chunck._header == nullptr )
+    { return false; }
+
+    _new_mem_chunck._first_slot = first_slot( _new_mem_chunck._header );
+    _new_mem_chunck._last_slot  = _new_mem_chunck._first_slot+(chunk_size-1);
+
+    _free_slots.fetch_add(chunk_size, std::memory_order_relaxed);
 
-    _next_free  = _new_mem_chunck._first_slot; // next free item initialized with first item._
+    push_bump_chunk( node, _new_mem_chunck._header );
 
     /////////////////////
     // Store chunck information in a vector.
     _mem_chunks.push_back(_new_mem_chunck);
+    register_chunk( _new_mem_chunck );
 
     // Update max_length
     _max_length.store( chunk_size*_mem_chunks.size(), std::memory_order_relaxed );
-    _free_slots.fetch_add(chunk_size, std::memory_order_relaxed);
 
     // Update capacity
-    _capacity.store( memory_required_per_chunk*_mem_chunks.size(), std::memory_order_relaxed );
+    _capacity.store( memory_allocated_per_chunk*_mem_chunks.size(), std::memory_order_relaxed );
+
+    _stats.add( core::stats_event_t::chunk_growth );
 
     return true;
   }
@@ -655,47 +1867,95 @@ private:
   /***/
   struct memory_chunk {
     constexpr inline memory_chunk() noexcept
-      : _first_slot(nullptr), _last_slot(nullptr)
+      : _header(nullptr), _first_slot(nullptr), _last_slot(nullptr)
     {}
-    /* Set both pointer to nullptr */
+    /* Set all pointers to nullptr */
     constexpr inline void reset() noexcept
     {
+      _header     = nullptr;
       _first_slot = nullptr;
       _last_slot  = nullptr;
     }
 
+    chunk_header*    _header;
     slot_pointer     _first_slot;
     slot_pointer     _last_slot;
   };
 
+  /**
+   * @brief Head of a free list and last chunk added for the same node, 
+   *        with numa_nodes > 1 each one is on its own cache line.
+   *        With core::minimal_order CASes on both heads are acq_rel: release publishes the links 
+   *        written with set_free() and the user data of released slots, acquire makes them visible
+   *        to the thread popping the slot. Tags make a CAS fail on a reused head, so a stale link 
+   *        read before the CAS is never installed. _free_slots is updated relaxed, as well as 
+   *        _max_length and _capacity are read: they only drive thresholds and statistics, no 
+   *        memory is published through them.
+   */
+  struct alignas( (numa_nodes > 1)?core::cache_line_size:alignof(std::atomic<tagged_pointer>) ) free_list_t {
+    std::atomic<tagged_pointer> _next_free;
+    std::atomic<tagged_chunk>   _bump_chunk;
+  };
+
+  /** Number of allocations before the cached NUMA node of the calling thread is refreshed. */
+  static constexpr const uint32_t node_refresh_rate = 1024;
+
   size_type                   _ndx_instance;
+  std::atomic<uint32_t>       _epoch;
 
   allocator_type              _mem_allocator;
   std::vector<memory_chunk>   _mem_chunks;
-
-  std::atomic<slot_pointer>   _next_free;
+  core::chunk_map<memory_slot_size*chunk_size> _chunk_map;
+  core::chunk_table<slot_pointer,handle_max_chunks> _chunk_table;
+  uint32_t                    _next_chunk_id;
+
+  // free lists and _free_slots are written by each allocate() and deallocate(), they are kept
+  // apart from data members that are read-mostly or written only when chunks are added or released.
+  // _free_slots is not a striped core::counter: check_threshold() reads it on each allocate() and 
+  // push_chain() compares the value returned by fetch_add() with the trim mark, both would pay a sum
+  // over all stripes; magazines already update it once per batch.
+  alignas(core::cache_line_size) std::array<free_list_t,numa_nodes> _free_lists;
   std::atomic<size_type>      _max_length;
-  std::atomic<size_type>      _free_slots;
-  std::atomic<size_type>      _capacity;
+  alignas(core::cache_line_size) std::atomic<size_type>  _free_slots;
+  alignas(core::cache_line_size) std::atomic<size_type>  _capacity;
+  std::atomic<size_type>      _grow_node;
+
+  /* Chunks released by shrink_to(), protected by _mtx_mem_chunks. */
+  std::vector<chunk_header*>  _cached_chunks;
+  std::atomic<size_type>      _trim_mark;
+  size_type                   _trim_high;
+  size_type                   _trim_low;
+  std::atomic<bool>           _trim_pending;
 
   mutable mutex_type          _mtx_mem_chunks;
 
-  std::thread*                _th_alloc;
-  std::binary_semaphore       _sem_th_alloc; 
-  std::atomic_bool            _th_alloc_exit;
+  core::refill_service::client* _refill_client;
+
+  static inline thread_local magazines_t  _th_magazines;
+  // constant initialized and trivially destructible, so it is available to threads exiting at any time.
+  static inline std::array<exit_guard_t,max_instances_per_type> s_exit_guards;
+
+  [[no_unique_address]] stats_t _stats;
 };
 
 template< typename data_t, typename data_size_t, 
           data_size_t chunk_size, data_size_t initial_size, data_size_t size_limit,
           data_size_t alloc_threshold,
-          typename allocator_t
+          typename allocator_t,
+          data_size_t magazine_size,
+          data_size_t numa_nodes,
+          core::slot_layout_t slot_layout,
+          typename order_t,
+          typename stats_t
         >
 requires std::is_unsigned_v<data_size_t> && (std::is_same_v<data_size_t,uint32_t> || std::is_same_v<data_size_t,uint64_t>)
          && ( ((sizeof(data_t) % alignof(std::max_align_t)) == 0 ) || ((alignof(std::max_align_t) % sizeof(data_t)) == 0 ) )
          && ( chunk_size > 0 ) && ( initial_size >= chunk_size )
-         && ((sizeof(void*)==4) || (sizeof(void*)==8))         
-typename arena_allocator<data_t,data_size_t,chunk_size,initial_size,size_limit,alloc_threshold,allocator_t>::lookup_table_type          
-  arena_allocator<data_t,data_size_t,chunk_size,initial_size,size_limit,alloc_threshold,allocator_t>::instances_table;
+         && ( numa_nodes >= 1 ) && ( numa_nodes <= 8 )
+         && ( ( slot_layout == core::slot_layout_t::header ) || std::is_trivially_destructible_v<data_t> )
+         && ((sizeof(void*)==4) || (sizeof(void*)==8)) && core::memory_order_profile<order_t> && core::stats_policy<stats_t>
+typename arena_allocator<data_t,data_size_t,chunk_size,initial_size,size_limit,alloc_threshold,allocator_t,magazine_size,numa_nodes,slot_layout,order_t,stats_t>::lookup_table_type          
+  arena_allocator<data_t,data_size_t,chunk_size,initial_size,size_limit,alloc_threshold,allocator_t,magazine_size,numa_nodes,slot_layout,order_t,stats_t>::instances_table;
 
 }
 
@@ -0,0 +1,10 @@
+#ifndef LOCK_FREE_CONFIG_H
+#define LOCK_FREE_CONFIG_H
+
+#define LF_LIB_VERSION_MAJOR           
+#define LF_LIB_VERSION_MINOR           
+#define LF_LIB_VERSION_PATCH           
+
+#define LF_LIB_VERSION   v__
+
+#endif //LOCK_FREE_CONFIG_H
@@ -24,11 +24,36 @@
 #ifndef CORE_ABSTRACT_FACTORY_H
 #define CORE_ABSTRACT_FACTORY_H
 
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <new>
+
 #include "config.h"
 #include "core/types.h"
+#include "core/unique_ptr.h"
 
 namespace core {
 
+/**
+ * @brief Deleter for products created in an arena slot: the object is destroyed through 
+ *        its virtual destructor and the slot returned to @tparam arena_t.
+ */
+template<typename base_t, typename arena_t>
+  requires std::has_virtual_destructor_v<base_t>
+struct arena_product_delete
+{
+  /***/
+  static inline void destroy( base_t* ptr ) noexcept
+  {
+    // address of the most derived object, that is the address of the arena slot.
+    void* slot = dynamic_cast<void*>(ptr);
+    ptr->~base_t();
+    [[maybe_unused]] core::result_t result = arena_t::deallocate( static_cast<typename arena_t::pointer>(slot) );
+    assert( result == core::result_t::eSuccess );
+  }
+};
+
 /***
  * Original design and for this class and all credits for that rely on @Quuxplusone, get the link to 
  * the question on Code Review for that:
@@ -58,8 +83,41 @@ public:
     template<typename... args_t>
     std::unique_ptr<base_t> create( args_t&&... args )
     {  return std::make_unique<derived_t>( std::forward<args_t&&>(args)... ); }
+
+    /** Construct derived class instance in @param slot forwarding arguments. */
+    template<typename... args_t>
+    base_t* create_at( void* slot, args_t&&... args )
+    {  return ::new (slot) derived_t( std::forward<args_t&&>(args)... ); }
+  };
+
+  /* Size and alignment large enough for any of the products, default_t included. */
+  static constexpr std::size_t product_size  = std::max( { sizeof(others_t)...,  
+                                                           std::is_same_v<default_t,std::nullptr_t>?std::size_t(0):sizeof(default_t) } );
+  static constexpr std::size_t product_align = std::max( { alignof(others_t)..., 
+                                                           std::is_same_v<default_t,std::nullptr_t>?std::size_t(1):alignof(default_t) } );
+
+  /**
+   * @brief Raw storage for one product, to be used as value_type of the arena passed to create();
+   *        i.e. core::arena_allocator<abstract_factory<...>::product_storage, uint32_t, 64>.
+   */
+  struct alignas(product_align) product_storage {
+    std::byte data[ (product_size + 15) & ~std::size_t(15) ];
   };
 
+  /* Arena suitable to host any of the products. */
+  template<typename arena_t>
+  static constexpr bool is_product_arena = requires ( arena_t& arena, typename arena_t::pointer ptr ) {
+                                              { arena.allocate() }           -> std::same_as<typename arena_t::pointer>;
+                                              { arena_t::deallocate( ptr ) } -> std::same_as<core::result_t>;
+                                              requires ( sizeof(typename arena_t::value_type)  >= product_size  );
+                                              requires ( alignof(typename arena_t::value_type) >= product_align );
+                                              requires std::has_virtual_destructor_v<base_t>;
+                                           };
+
+  /* Owning pointer to a product created in an arena slot. */
+  template<typename arena_t>
+  using arena_product_ptr = core::unique_ptr<base_t,arena_product_delete<base_t,arena_t>>;
+
   /* alias */
   using concrete_factories = std::tuple<concrete_factory<others_t>...>;
 
@@ -96,6 +154,56 @@ public:
 
     return result;
   }
+
+  /**
+   * @brief Same as create(), but the new instance is constructed in a slot obtained from @param arena, 
+   *        so on hot paths no heap allocation take place; the slot is returned to the arena when the 
+   *        returned pointer goes out of scope.
+   * 
+   * @return empty pointer if @param id do not match any product and default_t is nullptr_t, or 
+   *         if the arena is not able to provide a slot.
+   */
+  template<typename arena_t, typename... args_t>
+    requires is_product_arena<arena_t>
+  inline arena_product_ptr<arena_t> create( arena_t& arena, const std::string_view& id, args_t&&... args ) 
+  {
+    void* slot = nullptr;
+    auto  acquire_slot = [&arena, &slot]() -> void* {
+                            if ( slot == nullptr )
+                              slot = arena.allocate();
+                            return slot;
+                         };
+
+    base_t* result  = nullptr;
+    bool    matched = false;
+    try
+    {
+      // if concrete_factory matches with the name, use the concrete factory to create the new instance.
+      std::apply( [&result, &matched, &id, &slot, &acquire_slot, &args...](auto&&... tuple_item ) {
+                      (( (matched == false) && (tuple_item.name == id) && (matched = true) && (acquire_slot() != nullptr) ? 
+                            result = tuple_item.create_at( slot, std::forward<args_t>(args)... ) : result ), ...);
+                  }, concrete_factories{}
+                );
+
+      // default_t only when no name matched, not when the arena couldn't provide the slot.
+      if ( matched == false )
+      {
+        if constexpr ( std::is_same_v<std::nullptr_t,default_t> == false )
+        { 
+          if ( acquire_slot() != nullptr )
+            result = ::new (slot) default_t( std::forward<args_t>(args)... ); 
+        }
+      }
+    }
+    catch(...)
+    {
+      // constructor thrown, slot must be returned to the arena before to propagate the exception.
+      [[maybe_unused]] core::result_t ret = arena_t::deallocate( static_cast<typename arena_t::pointer>(slot) );
+      throw;
+    }
+
+    return arena_product_ptr<arena_t>( result );
+  }
 };
 
 }
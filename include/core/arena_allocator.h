@@ -25,8 +25,9 @@
 #define CORE_ARENA_ALLOCATOR_H
 
 #include <vector>
+#include <unordered_map>
+#include <bit>
 #include <assert.h>
-#include <semaphore>
 
 #include "config.h"
 #include "core/mutex.h"
@@ -34,6 +35,8 @@
 #include "core/memory_address.h"
 #include "core/memory_allocators.h"
 #include "core/fixed_lookup_table.h"
+#include "core/chunk_map.h"
+#include "core/refill_service.h"
 
 namespace core {
 
@@ -82,10 +85,17 @@ public:
   using allocator_type    = allocator_t;
   using lookup_table_type = core::fixed_lookup_table<arena_allocator*,size_type,max_instances_per_type,nullptr>;
   using mutex_type        = core::mutex;
+  using handle_type       = uint32_t;
 
   static constexpr const size_type         value_type_size  = sizeof(value_type);
   static lookup_table_type                 instances_table;
 
+  /** Returned by to_handle() for pointers that can't be represented. */
+  static constexpr const handle_type       null_handle        = std::numeric_limits<handle_type>::max();
+  /** A handle keeps the slot offset in the low bits and the chunk identifier in the high bits. */
+  static constexpr const uint32_t          handle_slot_bits   = (chunk_size > 1)?static_cast<uint32_t>(std::bit_width( static_cast<uint64_t>(chunk_size-1) )):0;
+  static constexpr const uint64_t          handle_max_chunks  = (handle_slot_bits < 32)?std::min<uint64_t>( (uint64_t(1) << (32-handle_slot_bits)) - 1, 65536 ):1;
+
 private:
   /***/
   struct memory_slot {
@@ -142,13 +152,18 @@ private:
 
     /***/
     constexpr static inline memory_slot* slot_from_user_data( pointer ptr ) noexcept
-    { return std::bit_cast<memory_slot*>(std::bit_cast<char*>(ptr)-core::memory_address<memory_slot,size_type>::memory_address_size); }
+    { return std::bit_cast<memory_slot*>(std::bit_cast<char*>(ptr)-user_data_offset); }
+
+    /** Offset of user data from the beginning of the slot, value_type may require a stricter alignment than the header. */
+    static constexpr const size_type user_data_offset = std::max<size_type>( core::memory_address<memory_slot,size_type>::memory_address_size, alignof(value_type) );
 
     core::memory_address<memory_slot,size_type>  _ptr_next;
     value_type                                   _user_data;
   };
 
   using slot_pointer     = memory_slot*;
+
+  struct memory_chunk;
   
   static constexpr const size_type memory_slot_size           = sizeof(memory_slot);
   static constexpr const size_type memory_required_per_chunk  = memory_slot_size*chunk_size;
@@ -158,9 +173,12 @@ public:
   /***/
   constexpr inline arena_allocator() noexcept
     : _ndx_instance( 0 ),
-      _next_free(nullptr), _max_length(0), _free_slots(0), _capacity(0),
-      _th_alloc(nullptr), _sem_th_alloc(0), _th_alloc_exit( false )
+      _next_chunk_id(0), _next_free(nullptr), _bump_chunk(0), _max_length(0), _free_slots(0), _capacity(0),
+      _trim_mark(std::numeric_limits<size_type>::max()), _trim_high(0), _trim_low(0), _trim_pending(false),
+      _refill_client(nullptr)
   {
+    static_assert( alignof(memory_slot) <= alignof(std::max_align_t), "value_type alignment is not supported, use lock_free::arena_allocator" );
+
     capture_instance_index();
 
     while ( max_length() < initial_size )
@@ -169,26 +187,9 @@ public:
       { break; }
     }
 
+    // Growth is delegated to the refill service shared by all arenas.
     if ( alloc_threshold > 0 )
-    {
-      _th_alloc = new std::thread( []( arena_allocator* pArena ){ 
-                                                                  while ( pArena->_th_alloc_exit.load(std::memory_order_acquire) == false )
-                                                                  {
-                                                                    pArena->_sem_th_alloc.acquire();
-
-                                                                    if ( pArena->_th_alloc_exit.load(std::memory_order_acquire) == true  )
-                                                                      break;
-
-                                                                    if (( pArena->max_length() < size_limit ) || (size_limit == 0))
-                                                                    {
-                                                                      if ( pArena->add_mem_chuck( ) == false )
-                                                                      {
-                                                                        // Reached physical memory limit
-                                                                      }
-                                                                    }
-                                                                  }         
-                                                                }, this );
-    }
+    { _refill_client = core::refill_service::instance().subscribe( this, &arena_allocator::refill ); }
   }
 
   /***/
@@ -199,20 +200,12 @@ public:
   {
     release_instance_index();
 
-    if ( alloc_threshold > 0 )
-    {
-      _th_alloc_exit.store( true, std::memory_order_release );
-      _sem_th_alloc.release();
-    }
+    // Once returned no refill is running or will be started for this arena.
+    if ( _refill_client != nullptr )
+    { core::refill_service::instance().unsubscribe( _refill_client ); }
 
     // Release all chunks
     clear();
-
-    if (( alloc_threshold > 0 ) && (_th_alloc!=nullptr))
-    {
-      _th_alloc->join();
-      delete _th_alloc;
-    }
   }
 
   /***/
@@ -310,26 +303,22 @@ public:
   template< typename... Args > 
   constexpr inline pointer    allocate( Args&&... args ) noexcept
   { 
-    do{
-    } while ( !_mtx_next.try_lock() );
+    _mtx_next.lock();
 
       if ( alloc_threshold > 0 ) [[likely]]
       {
         if ( _free_slots <= alloc_threshold ) 
-        { _sem_th_alloc.release(); }
+        { _refill_client->request(); }
       }
-      else if ( _next_free == nullptr ) [[unlikely]] // && ( alloc_threshold == 0 ) second part is implicit.
+      else if ( _free_slots == 0 ) [[unlikely]] // && ( alloc_threshold == 0 ) second part is implicit.
       { unsafe_add_mem_chuck(); } 
 
-      slot_pointer pCurrSlot = _next_free;
+      slot_pointer pCurrSlot = unsafe_pop_slot();
       if ( pCurrSlot == nullptr ) [[unlikely]]
       {
         _mtx_next.unlock();
         return nullptr;
       }
-
-      _next_free = pCurrSlot->next();
-      --_free_slots;
     
     _mtx_next.unlock();
     
@@ -346,9 +335,9 @@ public:
    * 
    *        Note: only memory allocated by this arena_allocator can be deallocated.
    *              In case the user try to deallocate memory not managed from the arena_allocator
-   *              application will experience unexpected behaviour. Consistency check require O(n) 
-   *              where 'n' is the number of chunks allocated, so not implemented in order to have
-   *              deallocation with O(1).
+   *              application will experience unexpected behaviour. Consistency check is available
+   *              with is_valid(), in constant time, but it is not applied here since it requires 
+   *              a lock on the chunks.
    *  
    * @param userdata  pointer to user data previously allocated with allocate().
    */
@@ -368,18 +357,120 @@ public:
       return result_t::eDoubleFree;
     }
 
-    do{
-    } while ( !pArena->_mtx_next.try_lock() );
+    pArena->_mtx_next.lock();
 
       pSlot->set_free( pArena->_next_free );
       pArena->_next_free = pSlot;
       ++pArena->_free_slots;
 
+      if ( pArena->_free_slots > pArena->_trim_mark ) [[unlikely]]
+      { pArena->request_trim(); }
+
     pArena->_mtx_next.unlock();
 
     return result_t::eSuccess;
   }
 
+  /**
+   * @brief Allocate memory for up to @param count data_t() objects and invoke
+   *        constructor for each of them with the same parameters.
+   *        Free list is locked only once for all the slots, while constructors
+   *        are invoked after the lock has been released.
+   * 
+   *        Note: this function is thread safe, if you are in single
+   *              thread context evaluate to use unsafe_allocate() instead.
+   * 
+   * @param items   output array with room for at least @param count pointers.
+   * @param count   number of objects to be allocated.
+   * @param args    list of arguments forwarded, as const reference, to each
+   *                data_t() constructor.
+   * @return number of objects constructed and stored in @param items. 
+   *         Returned value can be less than @param count in the same 
+   *         circumstances where allocate() return nullptr.
+   */
+  template< typename... Args > 
+  constexpr inline size_type  allocate_n( pointer* items, size_type count, const Args&... args ) noexcept
+  { return allocate_n_imp( items, count, [&args...]( void* slot ) noexcept { return new(slot) value_type( args... ); } ); }
+
+  /**
+   * @brief Same as allocate_n(), but each object is constructed in place from std::move(*@param first), 
+   *        so value_type doesn't need a default constructor nor an assignment.
+   * 
+   * @param first   iterator advanced once for each object constructed; there must be at least 
+   *                @param count elements in the range.
+   * @return number of objects constructed and stored in @param items.
+   */
+  template< typename input_iterator_t > 
+  constexpr inline size_type  allocate_n_from( pointer* items, size_type count, input_iterator_t& first ) noexcept
+  { return allocate_n_imp( items, count, [&first]( void* slot ) noexcept { pointer ptr = new(slot) value_type( std::move(*first) ); ++first; return ptr; } ); }
+
+  /**
+   * @brief Deallocate memory for @param count pointers in @param items and invoke ~data_t()
+   *        for each of them. Consecutive pointers owned by the same arena are linked together
+   *        and released to the free list locking it only once.
+   * 
+   *        Note: this function is thread safe, if you are in single
+   *              thread context evaluate to use unsafe_deallocate() instead.
+   * 
+   *        Note: same restrictions of deallocate() apply.
+   *  
+   * @param items   array of pointers previously allocated with allocate() or allocate_n().
+   * @param count   number of pointers in @param items.
+   * @return result_t::eSuccess if all pointers have been released, otherwise 
+   *         result_t::eNullPointer or result_t::eDoubleFree for the last 
+   *         invalid pointer found; valid pointers are released in any case.
+   */
+  [[nodiscard]] static constexpr inline result_t deallocate_n( pointer* items, size_type count ) noexcept
+  {
+    result_t         result      = result_t::eSuccess;
+    arena_allocator* pChainArena = nullptr;
+    slot_pointer     pFirst      = nullptr;
+    slot_pointer     pLast       = nullptr;
+    size_type        slots       = 0;
+
+    for ( size_type i = 0; i < count; ++i )
+    {
+      if ( items[i] == nullptr )
+      {
+        result = result_t::eNullPointer;
+        continue;
+      }
+
+      slot_pointer     pSlot  = memory_slot::slot_from_user_data(items[i]);
+      arena_allocator* pArena = instances_table[pSlot->get_index()];
+
+      if ( pSlot->is_free() )
+      {
+        // double free detected, also when the same pointer is repeated in items
+        result = result_t::eDoubleFree;
+        continue;
+      }
+
+      items[i]->~value_type();
+
+      if ( ( pArena != pChainArena ) && ( slots > 0 ) )
+      {
+        pChainArena->release_chain( pFirst, pLast, slots );
+        slots = 0;
+      }
+
+      if ( slots == 0 )
+      {
+        pChainArena = pArena;
+        pLast       = pSlot;
+      }
+
+      pSlot->set_free( pFirst );
+      pFirst = pSlot;
+      ++slots;
+    }
+
+    if ( slots > 0 )
+    { pChainArena->release_chain( pFirst, pLast, slots ); }
+
+    return result;
+  }
+
   /**
    * @brief Allocate memory for data_t() object and invoke
    *        constructur accordingly with parameters.
@@ -409,16 +500,14 @@ public:
   template< typename... Args >
   constexpr inline pointer    unsafe_allocate( Args&&... args ) noexcept
   { 
-    if (( _next_free == nullptr ) && ( alloc_threshold == 0 ))
+    if (( _free_slots == 0 ) && ( alloc_threshold == 0 ))
     { unsafe_add_mem_chuck(); } 
 
-    slot_pointer pCurrSlot = _next_free;
+    slot_pointer pCurrSlot = unsafe_pop_slot();
     if ( pCurrSlot == nullptr )
       return nullptr;
 
-    _next_free = pCurrSlot->next();
     pCurrSlot->set_in_use();
-    --_free_slots;
 
     return new(pCurrSlot->prt()) value_type( std::forward<Args>(args)... );
   }
@@ -434,9 +523,9 @@ public:
    *  
    *        Note: only memory allocated by this arena_allocator can be deallocated.
    *              In case the user try to deallocate memory not managed from the arena_allocator
-   *              application will experience unexpected behaviour. Consistency check require O(n) 
-   *              where 'n' is the number of chunks allocated, so not implemented in order to have
-   *              deallocation with O(1).
+   *              application will experience unexpected behaviour. Consistency check is available
+   *              with is_valid(), in constant time, but it is not applied here since it requires 
+   *              a lock on the chunks.
    *   
    * @param userdata  pointer to user data previously allocated with allocate().
    */
@@ -493,18 +582,201 @@ public:
 
     using addr_base_type = typename core::memory_address<memory_slot,size_type>::base_t;
 
-    const addr_base_type addr_offset = core::memory_address<memory_slot,size_type>::memory_address_size;
+    const addr_base_type addr_offset = memory_slot::user_data_offset;
+    const addr_base_type addr_slot   = std::bit_cast<addr_base_type>(userdata) - addr_offset;
 
-    for ( auto& mc : _mem_chunks )
+    const void* pFirstSlot = _chunk_map.find( std::bit_cast<const void*>(addr_slot) );
+    if ( pFirstSlot == nullptr )
+      return false;
+
+    // userdata must be at the beginning of a slot.
+    return ( ( ( addr_slot - std::bit_cast<addr_base_type>(pFirstSlot) ) % memory_slot_size ) == 0 );
+  }
+
+  /**
+   * @brief Return a compact handle for @param userdata, to be stored in place of the pointer 
+   *        and resolved with from_handle(). The handle remains valid while the object is 
+   *        allocated.
+   * 
+   *        Note: this function is thread safe, if you are in single
+   *              thread context evaluate to use unsafe_to_handle() instead.
+   * 
+   * @param userdata pointer to user data previously returned by allocate() or unsafe_allocate().
+   * @return null_handle if @param userdata is not managed by this arena_allocator, or if its 
+   *         chunk is beyond handle_max_chunks.
+   */
+  [[nodiscard]] inline handle_type to_handle( const_pointer userdata ) const
+  {
+    core::lock_guard<mutex_type> mtx(_mtx_next);
+    return unsafe_to_handle( userdata );
+  }
+
+  /**
+   * @brief Same as to_handle() without locking the free list.
+   */
+  [[nodiscard]] inline handle_type unsafe_to_handle( const_pointer userdata ) const
+  {
+    static_assert( handle_slot_bits < 32, "chunk_size is too big for 32 bits handles" );
+
+    if ( userdata == nullptr )
+      return null_handle;
+
+    using addr_base_type = typename core::memory_address<memory_slot,size_type>::base_t;
+
+    const addr_base_type addr_slot = std::bit_cast<addr_base_type>(userdata) - memory_slot::user_data_offset;
+
+    uint32_t    id         = 0;
+    const void* pFirstSlot = _chunk_map.find( std::bit_cast<const void*>(addr_slot), &id );
+    if ( ( pFirstSlot == nullptr ) || ( id >= handle_max_chunks ) )
+      return null_handle;
+
+    const addr_base_type offset = addr_slot - std::bit_cast<addr_base_type>(pFirstSlot);
+    if ( ( offset % memory_slot_size ) != 0 )
+      return null_handle;
+
+    return static_cast<handle_type>( ( id << handle_slot_bits ) | ( offset / memory_slot_size ) );
+  }
+
+  /**
+   * @brief Return the pointer for @param handle previously returned by to_handle(), lookups 
+   *        don't lock the free list and have constant cost.
+   * 
+   *        Note: this function is thread safe.
+   * 
+   * @return nullptr for null_handle or if the chunk is not in the arena anymore.
+   */
+  [[nodiscard]] inline pointer     from_handle( handle_type handle ) const noexcept
+  {
+    if ( handle == null_handle )
+      return nullptr;
+
+    const size_type offset = static_cast<size_type>( handle & ((uint64_t(1) << handle_slot_bits) - 1) );
+    slot_pointer    pFirst = _chunk_table.load( handle >> handle_slot_bits );
+    if ( ( pFirst == nullptr ) || ( offset >= chunk_size ) )
+      return nullptr;
+
+    return (pFirst + offset)->prt();
+  }
+
+  /**
+   * @brief Release to allocator_t chunks that have no slots in use while the number of free 
+   *        slots exceeds @param watermark by at least one chunk; chunks reserved with 
+   *        initial_size are kept. The free list is scanned once, so the cost is linear 
+   *        with the number of free slots.
+   * 
+   *        Note: this function is thread safe, if you are in single
+   *              thread context evaluate to use unsafe_shrink_to() instead.
+   * 
+   * @return number of slots released.
+   */
+  constexpr inline size_type  shrink_to( size_type watermark ) noexcept
+  {
+    core::lock_guard<mutex_type> mtx(_mtx_next);
+    return unsafe_shrink_to( watermark );
+  }
+
+  /**
+   * @brief Same as shrink_to() without locking the free list.
+   */
+  constexpr inline size_type  unsafe_shrink_to( size_type watermark ) noexcept
+  {
+    const size_type reserved = chunk_size * ((initial_size + chunk_size - 1) / chunk_size);
+    if ( ( _free_slots < watermark + chunk_size ) || ( _max_length <= reserved ) )
     {
-      if (
-          ( std::bit_cast<addr_base_type>(userdata) >= std::bit_cast<addr_base_type>(mc._first_slot)+addr_offset ) && 
-          ( std::bit_cast<addr_base_type>(userdata) <= std::bit_cast<addr_base_type>(mc._last_slot )+addr_offset )
-         )
-         return true;
+      update_trim_mark( _free_slots );
+      return 0;
     }
 
-    return false;
+    std::unordered_map<const void*,size_type> free_per_chunk;
+    for ( slot_pointer pSlot = _next_free; pSlot != nullptr; pSlot = pSlot->next() )
+    { ++free_per_chunk[_chunk_map.find( pSlot )]; }
+
+    // Order of chunks is preserved, since the ones after _bump_chunk must be untouched.
+    std::vector<slot_pointer> releasing;
+    size_type                 kept     = 0;
+    size_type                 bump     = 0;
+    for ( size_type ndx = 0; ndx < _mem_chunks.size(); ++ndx )
+    {
+      memory_chunk&   mc      = _mem_chunks[ndx];
+      const auto      it      = free_per_chunk.find( mc._first_slot );
+      const size_type free_nb = ( it != free_per_chunk.end() )?it->second:0;
+
+      if ( ( free_nb == mc._high_water ) && ( _free_slots >= watermark + chunk_size ) && ( _max_length > reserved ) )
+      {
+        _chunk_map.erase( mc._first_slot );
+        _chunk_table.store( mc._id, nullptr );
+        _free_chunk_ids.push_back( mc._id );
+        releasing.push_back( mc._first_slot );
+
+        _max_length -= chunk_size;
+        _free_slots -= chunk_size;
+        continue;
+      }
+
+      if ( ndx < _bump_chunk )
+      { ++bump; }
+      _mem_chunks[kept++] = mc;
+    }
+    _mem_chunks.resize( kept );
+    _bump_chunk = bump;
+    _capacity   = memory_required_per_chunk*_mem_chunks.size();
+    update_trim_mark( _free_slots );
+
+    if ( releasing.empty() )
+      return 0;
+
+    // Unlink slots that belong to released chunks, they are no longer in _chunk_map.
+    slot_pointer pPrev = nullptr;
+    for ( slot_pointer pSlot = _next_free; pSlot != nullptr; )
+    {
+      slot_pointer pNext = pSlot->next();
+      if ( _chunk_map.find( pSlot ) == nullptr )
+      {
+        if ( pPrev == nullptr )
+          _next_free = pNext;
+        else
+          pPrev->set_free( pNext );
+      }
+      else
+      { pPrev = pSlot; }
+      pSlot = pNext;
+    }
+
+    for ( slot_pointer pFirstSlot : releasing )
+    { _mem_allocator.deallocate( pFirstSlot, memory_required_per_chunk ); }
+
+    return chunk_size*releasing.size();
+  }
+
+  /**
+   * @brief Release all chunks that have no slots in use, except those reserved with initial_size.
+   *        See shrink_to().
+   * 
+   * @return number of slots released.
+   */
+  constexpr inline size_type  trim() noexcept
+  { return shrink_to( 0 ); }
+
+  /**
+   * @brief Enable automatic trimming, when after a deallocation free slots are more than 
+   *        @param high_watermark core::refill_service invokes shrink_to( @param low_watermark ). 
+   *        @param high_watermark is raised to at least @param low_watermark plus one chunk, and 
+   *        it should be above alloc_threshold plus one chunk, otherwise the arena can oscillate 
+   *        between growth and trimming. When no chunk can be released the next request is done
+   *        only after free slots increased by one more chunk.
+   *        A @param high_watermark equal to 0 disables automatic trimming, that is the default.
+   * 
+   *        Note: this function is not thread safe, it should be invoked before sharing the arena.
+   */
+  inline void  set_trim_watermarks( size_type high_watermark, size_type low_watermark ) noexcept
+  {
+    _trim_low  = low_watermark;
+    _trim_high = ( high_watermark > 0 )?std::max( high_watermark, low_watermark + chunk_size ):0;
+
+    if ( ( _trim_high > 0 ) && ( _refill_client == nullptr ) )
+    { _refill_client = core::refill_service::instance().subscribe( this, &arena_allocator::refill ); }
+
+    update_trim_mark();
   }
 
   /**
@@ -521,10 +793,11 @@ public:
     {
       // Iterate on overall slots in order to invoke ~value_type() 
       // for all object currently in use.
+      // Slots above the high water mark have never been initialized.
       slot_pointer mem_curs = mc._first_slot;
       size_type    slots_nb = 0; 
   
-      while ( slots_nb++ < chunk_size )
+      while ( slots_nb++ < mc._high_water )
       {
         if ( mem_curs->in_use() == true )
           mem_curs->prt()->~value_type();
@@ -538,15 +811,189 @@ public:
       mc.reset();
     }
     _mem_chunks.clear();
+    _chunk_map.clear();
+    _chunk_table.clear();
+    _free_chunk_ids.clear();
+    _next_chunk_id = 0;
     
     // Update max_length
     _max_length = 0;
     _free_slots = 0;
     _capacity   = 0;      
     _next_free  = nullptr;
+    _bump_chunk = 0;
   }
 
 private:
+  /**
+   * @brief Body of allocate_n() and allocate_n_from(), @param construct( void* ) builds the object in a slot.
+   */
+  template< typename construct_t > 
+  constexpr inline size_type  allocate_n_imp( pointer* items, size_type count, construct_t&& construct ) noexcept
+  { 
+    size_type slots = 0;
+
+    _mtx_next.lock();
+
+      while ( slots < count )
+      {
+        if ( alloc_threshold > 0 ) [[likely]]
+        {
+          if ( _free_slots <= alloc_threshold ) 
+          { _refill_client->request(); }
+        }
+        else if ( _free_slots == 0 ) [[unlikely]] // && ( alloc_threshold == 0 ) second part is implicit.
+        { unsafe_add_mem_chuck(); } 
+
+        slot_pointer pCurrSlot = unsafe_pop_slot();
+        if ( pCurrSlot == nullptr ) [[unlikely]]
+          break;
+
+        // slot address is temporary stored in items, object will be constructed out of the lock.
+        items[slots++] = reinterpret_cast<pointer>(pCurrSlot);
+      }
+    
+    _mtx_next.unlock();
+    
+    for ( size_type i = 0; i < slots; ++i )
+    {
+      slot_pointer pCurrSlot = reinterpret_cast<slot_pointer>(items[i]);
+      pCurrSlot->set_in_use();
+      items[i] = construct( pCurrSlot->prt() );
+    }
+
+    return slots;
+  }
+
+  /**
+   * @brief Invoked by core::refill_service, add one chunk and then keep adding chunks, 
+   *        up to @param depth in total, while free slots are not above alloc_threshold 
+   *        plus (depth-1) chunks. 
+   *        A pending trim request is served first, and growth is skipped if free slots
+   *        remain above alloc_threshold.
+   */
+  static inline void refill( void* owner, std::size_t depth ) noexcept
+  {
+    arena_allocator* pArena = static_cast<arena_allocator*>(owner);
+
+    if ( pArena->_trim_pending.exchange( false, std::memory_order_acq_rel ) )
+    {
+      core::lock_guard<mutex_type> lock(pArena->_mtx_next);
+      pArena->unsafe_shrink_to( pArena->_trim_low );
+      if ( pArena->_free_slots > alloc_threshold )
+        return;
+    }
+
+    if ( alloc_threshold == 0 )
+      return;
+
+    const size_type  target = alloc_threshold + static_cast<size_type>(depth-1)*chunk_size;
+
+    for ( std::size_t ndx = 0; ndx < depth; ++ndx )
+    {
+      if ( ndx > 0 )
+      {
+        core::lock_guard<mutex_type> lock(pArena->_mtx_next);
+        if ( pArena->_free_slots > target )
+          break;
+      }
+
+      if (( pArena->max_length() >= size_limit ) && (size_limit > 0))
+        break;
+
+      if ( pArena->add_mem_chuck() == false )
+      {
+        // Reached physical memory limit
+        break;
+      }
+    }
+  }
+
+  /**
+   * @brief Detach one slot, recycled slots in the free list are preferred, then 
+   *        slots never used are taken moving forward the high water mark of the 
+   *        first chunk that has some. Must be called with _mtx_next locked.
+   * 
+   * @return nullptr if there are no free slots.
+   */
+  constexpr inline slot_pointer unsafe_pop_slot() noexcept
+  {
+    slot_pointer pCurrSlot = _next_free;
+    if ( pCurrSlot != nullptr ) [[likely]]
+    {
+      _next_free = pCurrSlot->next();
+    }
+    else
+    {
+      // chunks after _bump_chunk are untouched, since chunks are only appended.
+      while ( ( _bump_chunk < _mem_chunks.size() ) && ( _mem_chunks[_bump_chunk]._high_water == chunk_size ) )
+      { ++_bump_chunk; }
+
+      if ( _bump_chunk == _mem_chunks.size() )
+        return nullptr;
+
+      memory_chunk& mc = _mem_chunks[_bump_chunk];
+      pCurrSlot = mc._first_slot + mc._high_water++;
+      pCurrSlot->set_index( _ndx_instance );
+    }
+
+    --_free_slots;
+
+    return pCurrSlot;
+  }
+
+  /**
+   * @brief Ask core::refill_service to run shrink_to(), requests are coalesced.
+   */
+  inline void           request_trim() noexcept
+  {
+    if ( _trim_pending.exchange( true, std::memory_order_acq_rel ) == false )
+    { _refill_client->request(); }
+  }
+
+  /**
+   * @brief Free slots above which trimming is requested, after a trim that left @param free_slots 
+   *        free the next request is done when they increased by one more chunk.
+   */
+  constexpr inline void update_trim_mark( size_type free_slots = 0 ) noexcept
+  { _trim_mark = ( _trim_high > 0 )?std::max( _trim_high, free_slots + chunk_size ):std::numeric_limits<size_type>::max(); }
+
+  /**
+   * @brief Link the sequence of @param count slots from @param first to @param last 
+   *        in front of the free list.
+   */
+  constexpr inline void release_chain( slot_pointer first, slot_pointer last, size_type count ) noexcept
+  {
+    _mtx_next.lock();
+
+      last->set_free( _next_free );
+      _next_free   = first;
+      _free_slots += count;
+
+      if ( _free_slots > _trim_mark ) [[unlikely]]
+      { request_trim(); }
+
+    _mtx_next.unlock();
+  }
+
+  /**
+   * @brief Assign an identifier to a new chunk, identifiers of released chunks are reused,
+   *        and add it to the lookup tables. Must be called with _mtx_next locked.
+   */
+  constexpr inline void register_chunk( memory_chunk& mc ) noexcept
+  {
+    if ( _free_chunk_ids.empty() )
+    { mc._id = _next_chunk_id++; }
+    else
+    {
+      mc._id = _free_chunk_ids.back();
+      _free_chunk_ids.pop_back();
+    }
+
+    _chunk_map.insert( mc._first_slot, mc._id );
+    _chunk_table.store( mc._id, mc._first_slot );
+  }
+
   /***/
   constexpr inline bool add_mem_chuck() noexcept
   {
@@ -558,28 +1005,15 @@ private:
 
     _new_mem_chunck._last_slot  = _new_mem_chunck._first_slot+(chunk_size-1);
 
-    // Iterate on overall slots in order to initialize the slots chain.
-    slot_pointer mem_curs = _new_mem_chunck._first_slot;
-    size_type    slots_nb = chunk_size; 
-    while ( slots_nb-- )
-    {
-      mem_curs->set_index( _ndx_instance );
-      mem_curs->set_free ((slots_nb>0)?(mem_curs+1):nullptr);
-
-      mem_curs++;
-    }
+    // Slots are initialized on demand by unsafe_pop_slot().
 
     // Protect access to _next_free
-    do{
-    } while ( !_mtx_next.try_lock() );
-
-      _new_mem_chunck._last_slot->set_free( _next_free );
-
-      _next_free  = _new_mem_chunck._first_slot; // next free item initialized with first item._
+    _mtx_next.lock();
 
       /////////////////////
       // Store chunck information in a vector.
       _mem_chunks.push_back(_new_mem_chunck);
+      register_chunk( _mem_chunks.back() );
 
       // Update max_length
       _max_length  = chunk_size*_mem_chunks.size();
@@ -605,24 +1039,12 @@ private:
 
     _new_mem_chunck._last_slot  = _new_mem_chunck._first_slot+(chunk_size-1);
 
-    // Iterate on overall slots in order to initialize the slots chain.
-    slot_pointer mem_curs = _new_mem_chunck._first_slot;
-    size_type    slots_nb = chunk_size; 
-    while ( slots_nb-- )
-    {
-      mem_curs->set_index( _ndx_instance );
-      mem_curs->set_free((slots_nb>0)?(mem_curs+1):nullptr);
-
-      mem_curs++;
-    }
-
-    _new_mem_chunck._last_slot->set_free( _next_free );
-
-    _next_free  = _new_mem_chunck._first_slot; // next free item initialized with first item._
+    // Slots are initialized on demand by unsafe_pop_slot().
 
     /////////////////////
     // Store chunck information in a vector.
     _mem_chunks.push_back(_new_mem_chunck);
+    register_chunk( _mem_chunks.back() );
 
     // Update max_length
     _max_length  = chunk_size*_mem_chunks.size();
@@ -652,34 +1074,48 @@ private:
   /***/
   struct memory_chunk {
     constexpr inline memory_chunk() noexcept
-      : _first_slot(nullptr), _last_slot(nullptr)
+      : _first_slot(nullptr), _last_slot(nullptr), _high_water(0), _id(0)
     {}
     /* Set both pointer to nullptr */
     constexpr inline void reset() noexcept
     {
       _first_slot = nullptr;
       _last_slot  = nullptr;
+      _high_water = 0;
+      _id         = 0;
     }
 
     slot_pointer     _first_slot;
     slot_pointer     _last_slot;
+    /* Number of slots, from _first_slot, handed out at least once. */
+    size_type        _high_water;
+    /* Identifier used in handles. */
+    uint32_t         _id;
   };
 
   size_type                   _ndx_instance;
 
   allocator_type              _mem_allocator;
   std::vector<memory_chunk>   _mem_chunks;
-
-  slot_pointer                _next_free;
+  core::chunk_map<memory_slot_size*chunk_size> _chunk_map;
+  core::chunk_table<slot_pointer,handle_max_chunks> _chunk_table;
+  std::vector<uint32_t>       _free_chunk_ids;
+  uint32_t                    _next_chunk_id;
+
+  // written by each allocate() and deallocate(), kept apart from read-mostly data members.
+  alignas(core::cache_line_size) slot_pointer  _next_free;
+  size_type                   _bump_chunk;
   size_type                   _max_length;
   size_type                   _free_slots;
   size_type                   _capacity;
+  size_type                   _trim_mark;
+  size_type                   _trim_high;
+  size_type                   _trim_low;
+  std::atomic<bool>           _trim_pending;
 
   mutable mutex_type          _mtx_next;
 
-  std::thread*                _th_alloc;
-  std::binary_semaphore       _sem_th_alloc; 
-  std::atomic_bool            _th_alloc_exit;
+  core::refill_service::client* _refill_client;
 };
 
 template< typename data_t, typename data_size_t, data_size_t chunk_size, data_size_t initial_size, data_size_t size_limit,
@@ -0,0 +1,137 @@
+/**************************************************************************************************
+ * 
+ * Copyright 2022 https://github.com/fe-dagostino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this 
+ * software and associated documentation files (the "Software"), to deal in the Software 
+ * without restriction, including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to the following 
+ * conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies 
+ * or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *************************************************************************************************/
+
+#ifndef CORE_ARENA_PTR_H
+#define CORE_ARENA_PTR_H
+
+#include <type_traits>
+#include <utility>
+#include <cstdint>
+#include <assert.h>
+
+#include "config.h"
+#include "core/types.h"
+#include "core/unique_ptr.h"
+
+namespace core {
+
+/**
+ * @brief Deleter for core::unique_ptr, objects are returned to the owning arena with the 
+ *        static @tparam arena_t::deallocate(), that finds the arena through the index 
+ *        stored in the slot, so the deleter has no state.
+ * 
+ * @tparam arena_t  core::arena_allocator or lock_free::arena_allocator.
+ */
+template<typename arena_t>
+struct arena_delete
+{
+  /***/
+  static constexpr inline void destroy( typename arena_t::pointer ptr ) noexcept
+  { 
+    [[maybe_unused]] core::result_t result = arena_t::deallocate( ptr ); 
+    assert( result == core::result_t::eSuccess );
+  }
+};
+
+/**
+ * @brief Owning pointer to an object allocated by @tparam arena_t, it has the same size of 
+ *        a plain pointer and deallocate() is invoked when it goes out of scope.
+ * 
+ * @tparam data_t   type of the object, it must be arena_t::value_type.
+ * @tparam arena_t  core::arena_allocator or lock_free::arena_allocator.
+ */
+template<typename data_t, typename arena_t>
+  requires std::is_same_v<data_t, typename arena_t::value_type>
+using arena_ptr = unique_ptr<data_t, arena_delete<arena_t>>;
+
+/**
+ * @brief Allocate an object from @param arena forwarding @param args to its constructor.
+ * 
+ * @return an empty arena_ptr when @param arena returns nullptr.
+ */
+template<typename arena_t, typename... Args>
+constexpr inline arena_ptr<typename arena_t::value_type, arena_t>  make_arena_ptr( arena_t& arena, Args&&... args ) noexcept
+{ return arena_ptr<typename arena_t::value_type, arena_t>( arena.allocate( std::forward<Args>(args)... ) ); }
+
+/**
+ * @brief Typed, non owning, 32 bits reference to an object allocated by @tparam arena_t, 
+ *        to be stored in place of a pointer in tables and other data structures.
+ *        The handle is resolved to a pointer only with the arena that created it, lookups
+ *        are lock free and with constant cost.
+ * 
+ * @tparam arena_t  core::arena_allocator or lock_free::arena_allocator.
+ */
+template<typename arena_t>
+class arena_handle
+{
+public:
+  using arena_type      = arena_t;
+  using value_type      = typename arena_t::value_type;
+  using pointer         = typename arena_t::pointer;
+  using const_pointer   = typename arena_t::const_pointer;
+  using handle_type     = typename arena_t::handle_type;
+
+  static_assert( sizeof(handle_type) == sizeof(uint32_t) );
+
+  /***/
+  constexpr inline arena_handle() noexcept
+    : _value( arena_t::null_handle )
+  {}
+
+  /***/
+  constexpr inline explicit arena_handle( handle_type value ) noexcept
+    : _value( value )
+  {}
+
+  /**
+   * @brief Create the handle for @param ptr, it is empty if @param ptr is not owned by @param arena.
+   */
+  inline arena_handle( const arena_t& arena, const_pointer ptr )
+    : _value( arena.to_handle( ptr ) )
+  {}
+
+  /**
+   * @brief Return the object referenced by the handle, nullptr if the handle is empty.
+   */
+  inline pointer                    get( const arena_t& arena ) const noexcept
+  { return arena.from_handle( _value ); }
+
+  /***/
+  constexpr inline handle_type      value() const noexcept
+  { return _value; }
+
+  /* Return true if the handle is not empty. */
+  constexpr inline explicit operator bool() const noexcept
+  { return ( _value != arena_t::null_handle ); }
+
+  /***/
+  constexpr inline bool             operator==( const arena_handle& rhs ) const noexcept
+  { return ( _value == rhs._value ); }
+
+private:
+  handle_type  _value;
+};
+
+}
+
+#endif // CORE_ARENA_PTR_H
@@ -0,0 +1,244 @@
+/**************************************************************************************************
+ * 
+ * Copyright 2022 https://github.com/fe-dagostino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this 
+ * software and associated documentation files (the "Software"), to deal in the Software 
+ * without restriction, including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to the following 
+ * conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies 
+ * or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *************************************************************************************************/
+
+#ifndef CORE_CHUNK_MAP_H
+#define CORE_CHUNK_MAP_H
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <new>
+#include <unordered_map>
+
+#include "config.h"
+#include "core/types.h"
+
+namespace core {
+
+/**
+ * @brief Map from a memory address to the chunk that contains it, in constant time.
+ *        Chunks are ranges of @tparam chunk_bytes starting at any address and they 
+ *        can't overlap.
+ *        The address space is split in granules of bit_floor(chunk_bytes), then each
+ *        chunk spans at most 3 granules and each granule intersects at most 2 chunks; 
+ *        a lookup is a single hash access plus two range checks.
+ *        Each chunk can be tagged with a 32 bits identifier, returned by find().
+ * 
+ *        Note: this class is not thread safe.
+ * 
+ * @tparam chunk_bytes   size in bytes of each chunk.
+ */
+template< std::size_t chunk_bytes >
+  requires ( chunk_bytes > 0 )
+class chunk_map final
+{
+public:
+  /**
+   * @brief Add the chunk that starts at @param first, with identifier @param id.
+   */
+  inline void   insert( const void* first, uint32_t id = 0 )
+  {
+    const uintptr_t base = std::bit_cast<uintptr_t>(first);
+    for ( uintptr_t key = base / granule_size; key <= (base + chunk_bytes - 1) / granule_size; ++key )
+    {
+      granule_t& granule = _granules[key];
+      granule[ ( granule[0]._base == 0 ) ? 0 : 1 ] = entry_t{ base, id };
+    }
+  }
+
+  /**
+   * @brief Remove the chunk that starts at @param first.
+   */
+  inline void   erase( const void* first )
+  {
+    const uintptr_t base = std::bit_cast<uintptr_t>(first);
+    for ( uintptr_t key = base / granule_size; key <= (base + chunk_bytes - 1) / granule_size; ++key )
+    {
+      auto iter = _granules.find( key );
+      if ( iter == _granules.end() )
+        continue;
+
+      granule_t& granule = iter->second;
+      if ( granule[0]._base == base )
+      {
+        granule[0] = granule[1];
+        granule[1] = entry_t{};
+      }
+      else if ( granule[1]._base == base )
+      { granule[1] = entry_t{}; }
+
+      if ( granule[0]._base == 0 )
+      { _granules.erase( iter ); }
+    }
+  }
+
+  /**
+   * @brief Return first address of the chunk that contains @param ptr, or nullptr
+   *        if @param ptr doesn't belong to any chunk. When @param id is not null
+   *        it receives the identifier of the chunk.
+   */
+  inline const void* find( const void* ptr, uint32_t* id = nullptr ) const
+  {
+    const uintptr_t addr = std::bit_cast<uintptr_t>(ptr);
+    auto iter = _granules.find( addr / granule_size );
+    if ( iter == _granules.end() )
+      return nullptr;
+
+    for ( const entry_t& entry : iter->second )
+    {
+      if ( ( entry._base != 0 ) && ( addr >= entry._base ) && ( addr - entry._base < chunk_bytes ) )
+      {
+        if ( id != nullptr )
+          *id = entry._id;
+        return std::bit_cast<const void*>(entry._base);
+      }
+    }
+
+    return nullptr;
+  }
+
+  /**
+   * @brief Remove all chunks.
+   */
+  inline void   clear() noexcept
+  { _granules.clear(); }
+
+private:
+  static constexpr const uintptr_t granule_size = std::bit_floor( chunk_bytes );
+
+  /** First address of a chunk intersecting the granule, 0 when not used, and its identifier. */
+  struct entry_t {
+    uintptr_t  _base = 0;
+    uint32_t   _id   = 0;
+  };
+  using granule_t = std::array<entry_t,2>;
+
+  std::unordered_map<uintptr_t,granule_t>  _granules;
+};
+
+/**
+ * @brief Table from chunk identifiers to @tparam data_t, usually the first slot of each chunk, 
+ *        with lock free lookups. Segments of @tparam segment_items entries are allocated on 
+ *        demand and released only by the destructor, so a lookup never touches freed memory.
+ * 
+ *        Note: store() and clear() are not thread safe, while load() can be invoked 
+ *              concurrently with them.
+ * 
+ * @tparam data_t         pointer type stored in the table.
+ * @tparam max_items      max number of identifiers.
+ * @tparam segment_items  number of entries allocated at once.
+ */
+template< typename data_t, std::size_t max_items, std::size_t segment_items = 256 >
+  requires std::is_pointer_v<data_t> && ( max_items > 0 ) && ( segment_items > 0 )
+class chunk_table final
+{
+public:
+  /***/
+  constexpr inline chunk_table() noexcept
+    : _segments()
+  {}
+
+  /***/
+  constexpr inline chunk_table( const chunk_table& ) noexcept = delete;
+
+  /***/
+  inline ~chunk_table() noexcept
+  {
+    for ( auto& segment : _segments )
+    { delete [] segment.load( std::memory_order_relaxed ); }
+  }
+
+  /***/
+  constexpr inline chunk_table& operator=( const chunk_table& ) noexcept = delete;
+
+  /**
+   * @brief Max number of identifiers.
+   */
+  static constexpr inline std::size_t  max_size() noexcept
+  { return max_items; }
+
+  /**
+   * @brief Associate @param value to identifier @param ndx.
+   * 
+   * @return false if @param ndx is out of range or there is not enough memory.
+   */
+  inline bool    store( std::size_t ndx, data_t value ) noexcept
+  {
+    if ( ndx >= max_items )
+      return false;
+
+    std::atomic<data_t>* segment = _segments[ndx / segment_items].load( std::memory_order_relaxed );
+    if ( segment == nullptr )
+    {
+      if ( value == nullptr )
+        return true;
+
+      segment = new(std::nothrow) std::atomic<data_t>[segment_items]();
+      if ( segment == nullptr )
+        return false;
+
+      _segments[ndx / segment_items].store( segment, std::memory_order_release );
+    }
+
+    segment[ndx % segment_items].store( value, std::memory_order_release );
+    return true;
+  }
+
+  /**
+   * @brief Return value associated to identifier @param ndx, nullptr if none.
+   */
+  inline data_t  load( std::size_t ndx ) const noexcept
+  {
+    if ( ndx >= max_items )
+      return nullptr;
+
+    const std::atomic<data_t>* segment = _segments[ndx / segment_items].load( std::memory_order_acquire );
+    if ( segment == nullptr )
+      return nullptr;
+
+    return segment[ndx % segment_items].load( std::memory_order_acquire );
+  }
+
+  /**
+   * @brief Reset all entries, segments are kept.
+   */
+  inline void    clear() noexcept
+  {
+    for ( auto& segment : _segments )
+    {
+      std::atomic<data_t>* entries = segment.load( std::memory_order_relaxed );
+      if ( entries == nullptr )
+        continue;
+
+      for ( std::size_t ndx = 0; ndx < segment_items; ++ndx )
+      { entries[ndx].store( nullptr, std::memory_order_relaxed ); }
+    }
+  }
+
+private:
+  std::array<std::atomic<std::atomic<data_t>*>,(max_items + segment_items - 1) / segment_items>  _segments;
+};
+
+}
+
+#endif // CORE_CHUNK_MAP_H
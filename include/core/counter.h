@@ -0,0 +1,142 @@
+/**************************************************************************************************
+ * 
+ * Copyright 2022 https://github.com/fe-dagostino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this 
+ * software and associated documentation files (the "Software"), to deal in the Software 
+ * without restriction, including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to the following 
+ * conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies 
+ * or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *************************************************************************************************/
+
+#ifndef CORE_COUNTER_H
+#define CORE_COUNTER_H
+
+#include <array>
+#include <atomic>
+#include <bit>
+
+#include "config.h"
+#include "core/types.h"
+#include "core/thread_index.h"
+
+namespace core {
+
+/**
+ * @brief Counter used by data structures to track their size.
+ * 
+ *        With core::counter_t::exact all threads update the same atomic, so each operation 
+ *        costs one RMW on a contended cache line.
+ *        With core::counter_t::striped each thread updates the stripe selected by its 
+ *        core::thread_index, each stripe on its own cache line; size() sums all stripes and 
+ *        is approximate while updates are in progress. quiescent_size() also observes all the 
+ *        updates that happened before the call, but stripes are still loaded one by one, so 
+ *        the result is exact only when there are no concurrent updates.
+ * 
+ * @tparam data_size_t  data type used for counting.
+ * @tparam policy       core::counter_t::exact (default) or core::counter_t::striped.
+ * @tparam stripes      number of stripes used with core::counter_t::striped, it must be a power of 2.
+ */
+template<typename data_size_t, core::counter_t policy = core::counter_t::exact, std::size_t stripes = 16>
+requires std::is_unsigned_v<data_size_t> && (std::has_single_bit(stripes))
+class counter final
+{
+public:
+  using size_type       = data_size_t;
+
+  static constexpr const bool        is_striped = (policy==core::counter_t::striped);
+  static constexpr const std::size_t cells      = is_striped?stripes:1;
+
+  /***/
+  constexpr inline counter() noexcept
+    : _cells()
+  {}
+
+  counter( const counter& ) = delete;
+  counter& operator=( const counter& ) = delete;
+
+  /**
+   * @brief Account @param count new items.
+   */
+  inline void                 add( size_type count = 1 ) noexcept
+  { cell().fetch_add( count, std::memory_order_relaxed ); }
+
+  /**
+   * @brief Account @param count removed items.
+   */
+  inline void                 sub( size_type count = 1 ) noexcept
+  { cell().fetch_sub( count, std::memory_order_relaxed ); }
+
+  /**
+   * @brief Cheap size, with core::counter_t::striped the result can miss concurrent updates.
+   */
+  constexpr inline size_type  size() const noexcept
+  { return sum( std::memory_order_relaxed ); }
+
+  /**
+   * @brief Size including all the updates that happened before the call. 
+   *        With core::counter_t::striped the result is exact only if there are no concurrent 
+   *        updates, since stripes are not loaded atomically all together.
+   */
+  constexpr inline size_type  quiescent_size() const noexcept
+  { 
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    return sum( std::memory_order_acquire ); 
+  }
+
+  /**
+   * @brief Set the counter to 0, it must not be used concurrently with add() or sub().
+   */
+  constexpr inline void       reset() noexcept
+  { 
+    for ( auto& cell : _cells )
+    { cell.store( 0, std::memory_order_relaxed ); }
+    std::atomic_thread_fence( std::memory_order_release );
+  }
+
+private:
+  using difference_type = std::make_signed_t<size_type>;
+  using cell_type       = core::cache_aligned_if<std::atomic<size_type>,is_striped>;
+
+  /***/
+  inline std::atomic<size_type>&  cell() noexcept
+  {
+    if constexpr ( is_striped )
+      return _cells[core::thread_index::get() & (stripes-1)];
+    else
+      return _cells[0];
+  }
+
+  /**
+   * @brief Cells wrap around, so their sum is correct modulo 2^N; a negative result 
+   *        is due to an item removed by a thread before being counted by another one, 
+   *        since owners publish items before add(). This happens also with a single cell.
+   */
+  constexpr inline size_type  sum( std::memory_order order ) const noexcept
+  {
+    size_type total = 0;
+    for ( const auto& cell : _cells )
+    { total += cell.load( order ); }
+
+    return ( static_cast<difference_type>(total) < 0 )?0:total;
+  }
+
+private:
+  std::array<cell_type,cells>   _cells;
+};
+
+}
+
+#endif // CORE_COUNTER_H
@@ -31,6 +31,9 @@ namespace core {
 
 /**
  * @brief An event object based on condition variable.
+ *        The event keeps track of threads waiting on it, so that producers can use 
+ *        notify_if_waiting() and pay for the notification only when there is 
+ *        someone to wake up.
  */
 class event final 
 {
@@ -40,6 +43,7 @@ public:
 
   /***/
   inline event() noexcept
+    : _waiters(0)
   {}
 
   /***/
@@ -58,6 +62,7 @@ public:
   inline result_t wait( uint32_t timeout ) noexcept
   {   
     std::unique_lock<mutex_type> u_lock(_mtx);
+    waiter_guard                 waiter(_waiters);
 
     std::cv_status cv_res = _cv.wait_for(u_lock, timeout*1ms); 
     if  ( cv_res == std::cv_status::timeout )
@@ -66,6 +71,29 @@ public:
     return result_t::eSignaled;
   }
 
+  /**
+   * @brief Wait for the specified timeout or until @param pred return true.
+   *        @param pred is evaluated after the calling thread has been registered as 
+   *        waiter, so a condition satisfied by a thread calling notify_if_waiting() 
+   *        is never missed.
+   * 
+   * @param timeout             number of milliseconds to wait
+   * @param pred                condition to wait for, it is evaluated with the event mutex locked.
+   * @return result_t::eTimeout when specified time elapsed and @param pred is still false, 
+   *         result_t::eSignaled when @param pred is true.
+   */
+  template<typename predicate_t>
+  inline result_t wait( uint32_t timeout, predicate_t&& pred ) noexcept
+  {   
+    std::unique_lock<mutex_type> u_lock(_mtx);
+    waiter_guard                 waiter(_waiters);
+
+    if ( _cv.wait_for(u_lock, timeout*1ms, std::forward<predicate_t>(pred)) == false )
+      return result_t::eTimeout;
+
+    return result_t::eSignaled;
+  }
+
   /**
    * @brief Wait until a call to signal().
    *        Note: spuriously unlock can happen even without a signal() call.
@@ -73,6 +101,7 @@ public:
   inline result_t wait() noexcept
   {   
     std::unique_lock<mutex_type> u_lock(_mtx);
+    waiter_guard                 waiter(_waiters);
 
     _cv.wait(u_lock); 
 
@@ -85,9 +114,56 @@ public:
   inline void     notify() noexcept
   { _cv.notify_all(); }
 
+  /**
+   * @brief Signal the event only if there are threads waiting on it.
+   *        Changes to the condition checked by waiting threads must be completed
+   *        before calling this method.
+   * 
+   * @return true if waiting threads have been notified.
+   */
+  inline bool     notify_if_waiting() noexcept
+  { 
+    // pairs with the registration in waiter_guard: either the waiter sees the new
+    // condition or this thread sees the waiter.
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if ( _waiters.load( std::memory_order_relaxed ) == 0 ) [[likely]]
+      return false;
+
+    {
+      // a waiter registered but not yet sleeping still hold the mutex.
+      std::lock_guard<mutex_type> lock(_mtx);
+    }
+    _cv.notify_all(); 
+
+    return true;
+  }
+
+  /**
+   * @brief Number of threads currently waiting on the event.
+   */
+  inline uint32_t waiters() const noexcept
+  { return _waiters.load( std::memory_order_relaxed ); }
+
+private:
+  /**
+   * @brief Register the calling thread as waiter for its scope.
+   */
+  struct waiter_guard
+  {
+    inline explicit waiter_guard( std::atomic<uint32_t>& waiters ) noexcept
+      : _waiters( waiters )
+    { _waiters.fetch_add( 1, std::memory_order_seq_cst ); }
+
+    inline ~waiter_guard() noexcept
+    { _waiters.fetch_sub( 1, std::memory_order_relaxed ); }
+
+    std::atomic<uint32_t>&  _waiters;
+  };
+
 private:
-  mutex_type  _mtx;
-  cv_type     _cv;
+  mutex_type              _mtx;
+  cv_type                 _cv;
+  std::atomic<uint32_t>   _waiters;
 };
 
 }
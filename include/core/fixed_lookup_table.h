@@ -33,6 +33,11 @@
 namespace core {
 
 /**
+ * @brief Fixed size table where add() store a value in the first available index.
+ *        Available indexes are kept in a stack, so both add() and reset_at() 
+ *        are O(1).
+ * 
+ *        Note: this class is not thread safe.
  */
 template< typename data_t, typename data_size_t, data_size_t items, data_t null_value >
 struct fixed_lookup_table final
@@ -46,10 +51,12 @@ public:
 public:
   /***/
   constexpr inline fixed_lookup_table() noexcept
-    : _array(nullptr)
+    : _array(nullptr), _free_ndx(nullptr), _free_count(0)
   {
-    _array = new(std::nothrow) value_type[items];
+    _array    = new(std::nothrow) value_type[items];
     assert(_array!=nullptr) ;
+    _free_ndx = new(std::nothrow) size_type[items];
+    assert(_free_ndx!=nullptr) ;
     
     reset();
   }   
@@ -62,6 +69,8 @@ public:
   {
     delete [] _array;
     _array = nullptr;
+    delete [] _free_ndx;
+    _free_ndx = nullptr;
   }
 
   /***/
@@ -79,20 +88,13 @@ public:
   /***/
   constexpr inline bool add( size_type& index, const value_type& value )
   { 
-    bool ret_val = false;
+    if ( _free_count == 0 )
+      return false;
 
-    for ( size_type ndx = 0; ndx < items; ++ndx )
-    { 
-      if ( _array[ndx] == null_value )
-      {
-        _array[ndx] = value;
-        index       = ndx;
-        ret_val     = true;
-        break;
-      } 
-    }
+    index         = _free_ndx[--_free_count];
+    _array[index] = value;
 
-    return ret_val;
+    return true;
   }
 
   /**
@@ -103,7 +105,11 @@ public:
     if ( index >= items )
         return false;
 
-    _array[index] = null_value;
+    if ( _array[index] != null_value )
+    { 
+      _array[index] = null_value;
+      _free_ndx[_free_count++] = index;
+    }
 
     return true;
   }
@@ -117,9 +123,10 @@ public:
 
     for ( size_type ndx = 0; ndx < items; ++ndx )
     { 
-      if ( _array[ndx] == value )
+      if ( ( _array[ndx] == value ) && ( _array[ndx] != null_value ) )
       {
         _array[ndx] = null_value;
+        _free_ndx[_free_count++] = ndx;
         ret_val     = true;
       } 
     }
@@ -133,11 +140,18 @@ public:
   constexpr inline void reset()
   { 
     for ( size_type ndx = 0; ndx < items; ++ndx )
-    { _array[ndx] = null_value; }
+    { 
+      _array[ndx] = null_value; 
+      // lower indexes are on top of the stack
+      _free_ndx[ndx] = items - 1 - ndx;
+    }
+    _free_count = items;
   }
 
 private:
   value_type*   _array;
+  size_type*    _free_ndx;
+  size_type     _free_count;
 
 };
 
@@ -0,0 +1,255 @@
+/**************************************************************************************************
+ * 
+ * Copyright 2022 https://github.com/fe-dagostino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this 
+ * software and associated documentation files (the "Software"), to deal in the Software 
+ * without restriction, including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to the following 
+ * conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies 
+ * or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *************************************************************************************************/
+
+#ifndef CORE_MAPPED_STORAGE_H
+#define CORE_MAPPED_STORAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+# define WIN32_MEAN_AND_LEAN
+# include <Windows.h>
+#else
+# include <cerrno>
+# include <chrono>
+# include <thread>
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#include "config.h"
+
+namespace core {
+
+/**
+ * @brief Default storage for data structures that keep all their state in a single block, 
+ *        such as lock_free::ring_buffer. The block is allocated on the heap and destroyed 
+ *        with its owner.
+ */
+class heap_storage final
+{
+public:
+  /** true when the block outlives its owner and can be shared with other processes. */
+  static constexpr const bool persistent = false;
+
+  /**
+   * @brief Allocate @param size bytes aligned to @param align, @param created is always true.
+   *        It throws std::bad_alloc as new does.
+   */
+  inline void*  map( std::size_t size, std::size_t align, bool& created )
+  { 
+    created = true;
+    return ::operator new( size, std::align_val_t(align) ); 
+  }
+
+  /***/
+  inline void   unmap( void* ptr, std::size_t size, std::size_t align ) noexcept
+  { 
+    (void)size;
+    ::operator delete( ptr, std::align_val_t(align) ); 
+  }
+};
+
+/**
+ * @brief Storage over a file mapped in shared mode, so the block can be used at the same time 
+ *        by cooperating processes and its content survives the owner; with a file in /dev/shm 
+ *        messages are exchanged through memory only, with a file on disk they also survive 
+ *        a reboot once flush() is used.
+ *        The first process that maps the file creates it with the requested size, the others 
+ *        attach to the existing one and wait, up to timeout, until the creator grows it. 
+ *        The owner has to tell when initialization is complete, see lock_free::ring_buffer.
+ * 
+ *        Note: the block is mapped at different addresses in each process, so it must hold 
+ *              offsets and indices instead of pointers.
+ */
+class mapped_storage final
+{
+public:
+  /** true when the block outlives its owner and can be shared with other processes. */
+  static constexpr const bool persistent = true;
+
+  /**
+   * @param path     file to be mapped, created if it doesn't exist.
+   * @param timeout  milliseconds to wait for a file being created by another process.
+   */
+  inline explicit mapped_storage( std::string path, uint32_t timeout = 1000 ) noexcept
+    : _path( std::move(path) ), _timeout( timeout )
+  {}
+
+  /***/
+  inline const std::string& path() const noexcept
+  { return _path; }
+
+  /***/
+  inline uint32_t           timeout() const noexcept
+  { return _timeout; }
+
+  /**
+   * @brief Map @param size bytes from the file, page alignment covers @param align.
+   * 
+   * @param created  set to true when the file has been created by this call, and the 
+   *                 block must be initialized.
+   * @return nullptr if the file can't be created or mapped, or if it has a different size.
+   */
+  inline void*  map( std::size_t size, std::size_t align, bool& created ) noexcept
+  {
+    (void)align;
+    created = false;
+#ifdef _WIN32
+    HANDLE hFile = CreateFileA( _path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, 
+                                NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL );
+    if ( hFile != INVALID_HANDLE_VALUE )
+      created = true;
+    else if ( GetLastError() == ERROR_FILE_EXISTS )
+      hFile = CreateFileA( _path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, 
+                           NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    if ( hFile == INVALID_HANDLE_VALUE )
+      return nullptr;
+
+    // the mapping itself grows a new file to the requested size.
+    const uint64_t size64  = static_cast<uint64_t>(size);
+    HANDLE         hMap    = CreateFileMappingA( hFile, NULL, PAGE_READWRITE, DWORD(size64 >> 32), DWORD(size64 & 0xFFFFFFFF), NULL );
+    LARGE_INTEGER  fs;
+    void*          ptr     = nullptr;
+    if ( ( hMap != NULL ) && GetFileSizeEx( hFile, &fs ) && ( static_cast<uint64_t>(fs.QuadPart) == size64 ) )
+      ptr = MapViewOfFile( hMap, FILE_MAP_ALL_ACCESS, 0, 0, size );
+
+    if ( hMap != NULL )
+      CloseHandle( hMap );
+    CloseHandle( hFile );
+    return ptr;
+#else
+    int fd = ::open( _path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600 );
+    if ( fd >= 0 )
+    {
+      created = true;
+      if ( ftruncate( fd, static_cast<off_t>(size) ) != 0 )
+      {
+        ::close( fd );
+        ::unlink( _path.c_str() );
+        return nullptr;
+      }
+    }
+    else
+    {
+      if ( errno != EEXIST )
+        return nullptr;
+
+      fd = ::open( _path.c_str(), O_RDWR );
+      if ( fd < 0 )
+        return nullptr;
+
+      if ( wait_size( fd, size ) == false )
+      { 
+        ::close( fd );
+        return nullptr;
+      }
+    }
+
+    void* ptr = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    // the mapping keeps a reference to the file.
+    ::close( fd );
+
+    return ( ptr == MAP_FAILED )?nullptr:ptr;
+#endif
+  }
+
+  /**
+   * @brief Unmap the block, the file and its content are left in place.
+   */
+  inline void   unmap( void* ptr, std::size_t size, std::size_t align ) noexcept
+  {
+    (void)align;
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile( ptr );
+#else
+    munmap( ptr, size );
+#endif
+  }
+
+  /**
+   * @brief Write modified pages of [@param ptr, @param ptr + @param size) to the file, this is 
+   *        needed only to survive a system crash, other processes always see the same content.
+   */
+  static inline bool  flush( void* ptr, std::size_t size ) noexcept
+  {
+#ifdef _WIN32
+    return ( FlushViewOfFile( ptr, size ) != FALSE );
+#else
+    return ( msync( ptr, size, MS_SYNC ) == 0 );
+#endif
+  }
+
+  /**
+   * @brief Delete the file at @param path, processes that have it mapped are not affected.
+   */
+  static inline bool  remove( const std::string& path ) noexcept
+  {
+#ifdef _WIN32
+    return ( DeleteFileA( path.c_str() ) != FALSE );
+#else
+    return ( ::unlink( path.c_str() ) == 0 );
+#endif
+  }
+
+private:
+#ifndef _WIN32
+  /**
+   * @brief Wait for a file being created by another process to reach @param size.
+   */
+  inline bool   wait_size( int fd, std::size_t size ) const noexcept
+  {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_timeout);
+    for (;;)
+    {
+      struct stat st;
+      if ( fstat( fd, &st ) != 0 )
+        return false;
+
+      if ( static_cast<std::size_t>(st.st_size) == size )
+        return true;
+
+      // a different size means a file created with a different geometry.
+      if ( ( st.st_size != 0 ) || ( std::chrono::steady_clock::now() >= deadline ) )
+        return false;
+
+      std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+    }
+  }
+#endif
+
+private:
+  std::string   _path;
+  uint32_t      _timeout;
+};
+
+}
+
+#endif // CORE_MAPPED_STORAGE_H
@@ -69,6 +69,10 @@ public:
     DESTROY = 0x0001
   };
 
+  static constexpr const base_t addr_bits    = conditional<size_type,(sizeof(pointer)==8), 48, 32>::value;
+  static constexpr const base_t flags_bits   = conditional<size_type,(sizeof(pointer)==8),  4,  4>::value;
+  static constexpr const base_t counter_bits = conditional<size_type,(sizeof(pointer)==8), 12, 28>::value;
+
   /***/
   constexpr inline memory_address() noexcept
     : _addr( std::bit_cast<base_t>(nullptr) ), _flags(0), _counter(0)
@@ -133,6 +137,10 @@ public:
   /***/
   static constexpr inline void     unset_all( memory_address<value_type,size_type>& obj ) noexcept
   { obj._flags = 0; }
+
+  /***/
+  static constexpr inline void     set_flags( memory_address<value_type,size_type>& obj, base_t flags ) noexcept
+  { obj._flags = flags; }
   
   /***/
   static constexpr inline base_t   get_counter( const memory_address<value_type,size_type>& obj ) noexcept 
@@ -149,10 +157,32 @@ public:
   static constexpr inline void     sub_counter( memory_address<value_type,size_type>& obj, base_t value ) noexcept 
   { obj._counter -= value; }
 
+  /**
+   * @brief Create a memory_address to @param ptr carrying the generation tag of @param prev 
+   *        incremented by one. The tag is made of both _counter and _flags bits, in order to 
+   *        have the widest range before wrapping around, so a memory_address used as tagged
+   *        pointer should not use flags for other purposes.
+   *        Intended to protect CAS loops on an std::atomic<memory_address> from ABA issues, since 
+   *        the CAS will fail if the same address was removed and then restored in the meantime.
+   * 
+   * @param ptr   new address.
+   * @param prev  current value, usually the expected value for the CAS.
+   * @return memory_address with the next generation tag.
+   */
+  static constexpr inline memory_address<value_type,size_type> next_tag( pointer ptr, const memory_address<value_type,size_type>& prev ) noexcept
+  {
+    constexpr const base_t counter_mask = (base_t(1) << counter_bits) - 1;
+
+    const base_t counter = (prev._counter + 1) & counter_mask;
+    const base_t flags   = (counter == 0)?((prev._flags + 1) & ((base_t(1) << flags_bits) - 1)):prev._flags;
+
+    return memory_address<value_type,size_type>( ptr, flags, counter );
+  }
+
 private:
-  base_t   _addr    : conditional<size_type,(sizeof(pointer)==8), 48, 32>::value;
-  base_t   _flags   : conditional<size_type,(sizeof(pointer)==8),  4,  4>::value;
-  base_t   _counter : conditional<size_type,(sizeof(pointer)==8), 12, 28>::value;
+  base_t   _addr    : addr_bits;
+  base_t   _flags   : flags_bits;
+  base_t   _counter : counter_bits;
 };
 
 template< typename data_t, typename data_size_t>
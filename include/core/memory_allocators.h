@@ -26,18 +26,68 @@
 
 #include <type_traits>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 
 #ifdef _WIN32
 # define WIN32_MEAN_AND_LEAN
 # include <Windows.h>
 #else
 # include <sys/mman.h>
+# include <unistd.h>
+# if defined(__linux__)
+#  include <sys/syscall.h>
+# endif
 #endif
 
 #include "config.h"
 
 namespace core {
 
+/**
+ * @brief Helpers to give physical pages back to the system while keeping the mapping.
+ */
+class pages final
+{
+public:
+  /**
+   * @brief Return the size of a memory page.
+   */
+  static inline std::size_t  size() noexcept
+  {
+#ifdef _WIN32
+    static const std::size_t s_page_size = []{ SYSTEM_INFO si; GetSystemInfo(&si); return static_cast<std::size_t>(si.dwPageSize); }();
+#else
+    static const std::size_t s_page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    return s_page_size;
+  }
+
+  /**
+   * @brief Release physical memory for all pages, with size @param granularity, fully contained in 
+   *        [@param ptr, @param ptr + @param nb_bytes). Addresses remain valid, on linux discarded 
+   *        pages read as zero, on windows their content is undefined.
+   * 
+   * @return number of bytes discarded.
+   */
+  static inline std::size_t  discard( void* ptr, std::size_t nb_bytes, std::size_t granularity = size() ) noexcept
+  {
+    const uintptr_t first = (reinterpret_cast<uintptr_t>(ptr) + granularity - 1) & ~static_cast<uintptr_t>(granularity - 1);
+    const uintptr_t last  = (reinterpret_cast<uintptr_t>(ptr) + nb_bytes) & ~static_cast<uintptr_t>(granularity - 1);
+    if ( last <= first )
+      return 0;
+
+#ifdef _WIN32
+    if ( VirtualAlloc( reinterpret_cast<void*>(first), last - first, MEM_RESET, PAGE_READWRITE ) == NULL )
+      return 0;
+#else
+    if ( madvise( reinterpret_cast<void*>(first), last - first, MADV_DONTNEED ) != 0 )
+      return 0;
+#endif
+    return last - first;
+  }
+};
+
 /***/
 template<typename data_size_t>
 class default_allocator 
@@ -53,6 +103,16 @@ public:
   static constexpr inline void  deallocate( void* ptr, [[maybe_unused]] const size_type& nb_bytes ) noexcept
   { std::free( ptr ); }
 
+  /**
+   * @brief Release physical pages fully contained in the block, without freeing it.
+   */
+  static inline void  discard( void* ptr, const size_type& nb_bytes ) noexcept
+#ifdef _WIN32
+  { (void)ptr; (void)nb_bytes; }
+#else
+  { pages::discard( ptr, nb_bytes ); }
+#endif
+
 };
 
 /***/
@@ -67,7 +127,10 @@ public:
 #ifdef _WIN32  
   { return VirtualAlloc(NULL, nb_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE); }
 #else
-  { return mmap(NULL, nb_bytes, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0); }
+  { 
+    void* ptr = mmap(NULL, nb_bytes, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0); 
+    return (ptr == MAP_FAILED)?nullptr:ptr;
+  }
 #endif
 
   /***/
@@ -78,6 +141,176 @@ public:
   { munmap(reinterpret_cast<void *>(ptr), nb_bytes); }
 #endif
 
+  /**
+   * @brief Release physical pages with madvise(MADV_DONTNEED), the mapping is kept.
+   */
+  static inline void  discard( void* ptr, const size_type& nb_bytes ) noexcept
+  { pages::discard( ptr, nb_bytes ); }
+
+};
+
+/**
+ * @brief Allocator backed by huge pages, in order to reduce TLB misses with big arenas.
+ *        On linux explicit huge pages (MAP_HUGETLB) are tried first, when none is available
+ *        from the system pool a regular mapping is used and marked with MADV_HUGEPAGE so that
+ *        transparent huge pages can back it. On other platforms it behaves as virtual_allocator.
+ * 
+ *        Note: each allocation is rounded up to a multiple of huge_page_size, so chunks should 
+ *              be big enough to not waste memory.
+ * 
+ * @tparam data_size_t     data type to be used for sizing.
+ * @tparam huge_page_size  size of the huge page, default 2MB.
+ */
+template<typename data_size_t, std::size_t huge_page_size = 2*1024*1024>
+  requires ( (huge_page_size & (huge_page_size-1)) == 0 )
+class huge_page_allocator 
+{
+public:
+  using size_type       = data_size_t;
+
+  /***/
+  static constexpr inline std::size_t  mapping_size( const size_type& nb_bytes ) noexcept
+  { return (static_cast<std::size_t>(nb_bytes) + huge_page_size - 1) & ~(huge_page_size - 1); }
+
+  /***/
+  static constexpr inline void* allocate( const size_type& nb_bytes ) noexcept
+#if defined(_WIN32)
+  { return virtual_allocator<size_type>::allocate( nb_bytes ); }
+#else
+  { 
+    void* ptr = MAP_FAILED; 
+# ifdef MAP_HUGETLB
+    ptr = mmap(NULL, mapping_size(nb_bytes), PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+# endif
+    if ( ptr == MAP_FAILED )
+    {
+      ptr = mmap(NULL, mapping_size(nb_bytes), PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+      if ( ptr == MAP_FAILED )
+        return nullptr;
+# ifdef MADV_HUGEPAGE
+      madvise( ptr, mapping_size(nb_bytes), MADV_HUGEPAGE );
+# endif
+    }
+    return ptr;
+  }
+#endif
+
+  /***/
+  static constexpr inline void  deallocate( void* ptr, [[maybe_unused]] const size_type& nb_bytes ) noexcept
+#if defined(_WIN32)
+  { virtual_allocator<size_type>::deallocate( ptr, nb_bytes ); }
+#else
+  { munmap(reinterpret_cast<void *>(ptr), mapping_size(nb_bytes)); }
+#endif
+
+  /**
+   * @brief Release physical memory for huge pages fully contained in the range, the mapping is kept.
+   */
+  static inline void  discard( void* ptr, const size_type& nb_bytes ) noexcept
+  { pages::discard( ptr, nb_bytes, huge_page_size ); }
+
+};
+
+/**
+ * @brief NUMA helpers that do not require libnuma.
+ *        On platforms other than linux all memory is considered on node 0.
+ */
+class numa final
+{
+public:
+  /**
+   * @brief Bind memory in [@param ptr, @param ptr + @param nb_bytes) to @param node with MPOL_BIND.
+   *        @param ptr must be page aligned, pages already touched are not moved.
+   * 
+   * @return true if the policy has been applied, false otherwise; in such case the
+   *         default first-touch policy will apply.
+   */
+  static inline bool     bind( void* ptr, std::size_t nb_bytes, uint32_t node ) noexcept
+  {
+#if defined(__linux__) && defined(SYS_mbind)
+    constexpr const unsigned long mpol_bind = 2;  // MPOL_BIND from <linux/mempolicy.h>
+    constexpr const std::size_t   mask_bits = 8*sizeof(unsigned long);
+    constexpr const std::size_t   max_nodes = 1024;
+
+    if ( ( ptr == nullptr ) || ( node >= max_nodes ) )
+      return false;
+
+    unsigned long nodemask[max_nodes/mask_bits] = {};
+    nodemask[node/mask_bits] = 1UL << (node%mask_bits);
+
+    // maxnode has to be one more than the number of bits in the mask.
+    return ( syscall( SYS_mbind, ptr, static_cast<unsigned long>(nb_bytes), mpol_bind, nodemask, max_nodes + 1, 0 ) == 0 );
+#else
+    (void)ptr; (void)nb_bytes; (void)node;
+    return false;
+#endif
+  }
+
+  /**
+   * @brief Return the NUMA node of the cpu where the calling thread is running.
+   */
+  static inline uint32_t current_node() noexcept
+  {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu  = 0;
+    unsigned node = 0;
+    if ( syscall( SYS_getcpu, &cpu, &node, nullptr ) != 0 )
+      return 0;
+    return node;
+#else
+    return 0;
+#endif
+  }
+};
+
+/**
+ * @brief Allocator binding memory to the NUMA node @tparam numa_node.
+ *        On linux memory is obtained from @tparam base_allocator_t, and then bound to the node
+ *        with mbind(MPOL_BIND), if the node doesn't exist or the kernel has no NUMA support,
+ *        memory is left to the default first-touch policy. On windows VirtualAllocExNuma() 
+ *        is used and @tparam base_allocator_t is ignored.
+ * 
+ * @tparam data_size_t       data type to be used for sizing.
+ * @tparam numa_node         NUMA node where the memory should be placed.
+ * @tparam base_allocator_t  allocator returning page aligned memory, virtual_allocator (default)
+ *                           or huge_page_allocator.
+ */
+template<typename data_size_t, uint32_t numa_node, typename base_allocator_t = virtual_allocator<data_size_t>>
+class numa_allocator 
+{
+public:
+  using size_type       = data_size_t;
+
+  /***/
+  static constexpr inline void* allocate( const size_type& nb_bytes ) noexcept
+#if defined(_WIN32)
+  { return VirtualAllocExNuma(GetCurrentProcess(), NULL, nb_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE, numa_node); }
+#else
+  { 
+    void* ptr = base_allocator_t::allocate( nb_bytes );
+    numa::bind( ptr, nb_bytes, numa_node );
+    return ptr;
+  }
+#endif
+
+  /***/
+  static constexpr inline void  deallocate( void* ptr, [[maybe_unused]] const size_type& nb_bytes ) noexcept
+#if defined(_WIN32)
+  { VirtualFree(reinterpret_cast<void *>(ptr), 0, MEM_RELEASE); }
+#else
+  { base_allocator_t::deallocate( ptr, nb_bytes ); }
+#endif
+
+  /**
+   * @brief Release physical pages, the mapping and its NUMA policy are kept.
+   */
+  static inline void  discard( void* ptr, const size_type& nb_bytes ) noexcept
+#if defined(_WIN32)
+  { virtual_allocator<size_type>::discard( ptr, nb_bytes ); }
+#else
+  { base_allocator_t::discard( ptr, nb_bytes ); }
+#endif
+
 };
 
 }
@@ -25,11 +25,31 @@
 #define CORE_MUTEX_H
 
 #include <atomic>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+# include <immintrin.h>
+#endif
 
 #include "config.h"
+#include "core/stats.h"
 
 namespace core {
 
+/**
+ * @brief Hint the cpu that the calling thread is in a spin-wait loop, reducing power 
+ *        and giving resources to the sibling hyper-thread, that is often the lock holder.
+ */
+inline void cpu_relax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+  _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
 /**
  * @brief A mutex with a spin lock implementation that leverage on atomic<bool>.
  *        This is an alterantive to std::mutex which is based on native mutexes,
@@ -37,32 +57,162 @@ namespace core {
  * 
  *        Unfortunately futex are not part of the standard, so right now this
  *        seems to be a good compromise between performances and portability. 
+ * 
+ * @tparam stats_t  core::no_stats (default) or core::thread_stats to account spin 
+ *                  iterations and failed acquisitions.
  */
-class mutex final {
+template<typename stats_t = core::no_stats>
+  requires core::stats_policy<stats_t>
+class basic_mutex final {
 public:
-  constexpr inline mutex() noexcept
+  constexpr inline basic_mutex() noexcept
    : _lock(false)
   {}
 
-  /***/
+  /**
+   * @brief Test-and-test-and-set: while the lock is held, waiting threads spin on 
+   *        a load, so the cache line is not bounced between them.
+   */
   inline void lock() noexcept
   {
-    do{
-    } while(std::atomic_exchange_explicit(&_lock, true, std::memory_order_acquire));
+    while(std::atomic_exchange_explicit(&_lock, true, std::memory_order_acquire))
+    {
+      _stats.add( core::stats_event_t::retry );
+      do{
+        cpu_relax();
+        _stats.add( core::stats_event_t::spin );
+      } while(std::atomic_load_explicit(&_lock, std::memory_order_relaxed));
+    }
   }
 
   /***/
   inline bool try_lock() noexcept
-  { return !std::atomic_exchange_explicit(&_lock, true, std::memory_order_acquire); }
+  { 
+    if ( std::atomic_load_explicit(&_lock, std::memory_order_relaxed) )
+      return false;
+    return !std::atomic_exchange_explicit(&_lock, true, std::memory_order_acquire); 
+  }
 
   /***/
   inline void unlock() noexcept
   { std::atomic_store_explicit(&_lock, false, std::memory_order_release); }
 
+  /**
+   * @brief Counters collected by stats_t.
+   */
+  constexpr inline core::stats_snapshot stats() const noexcept
+  { return _stats.snapshot(); }
+
+private:
+  std::atomic<bool>               _lock;
+  [[no_unique_address]] stats_t   _stats;
+};
+
+/**
+ * @brief basic_mutex without stats.
+ */
+using mutex = basic_mutex<>;
+
+/**
+ * @brief A mutex that spins for a short time and then park the calling thread.
+ *        Waiting for the lock goes through three stages:
+ *        1) test-and-test-and-set with exponential backoff using cpu_relax(),
+ *        2) a few std::this_thread::yield() to give the lock holder a chance to run 
+ *           on oversubscribed hosts,
+ *        3) std::atomic::wait(), that on linux is a futex, until unlock() notify.
+ *        unlock() pay a system call only when there are parked threads.
+ * 
+ * @tparam spin_limit   max number of backoff rounds before start yielding.
+ * @tparam yield_limit  number of yield before parking the thread.
+ * @tparam stats_t      core::no_stats (default) or core::thread_stats to account backoff 
+ *                      rounds, yields and parked threads.
+ */
+template<uint32_t spin_limit = 16, uint32_t yield_limit = 4, typename stats_t = core::no_stats>
+  requires core::stats_policy<stats_t>
+class basic_adaptive_mutex final {
+  enum state_t : uint32_t {
+    eUnlocked = 0,
+    eLocked   = 1,
+    eParked   = 2   // locked, and there could be parked threads
+  };
+
+  /** Max number of cpu_relax() for a single backoff round. */
+  static constexpr const uint32_t max_backoff = 64;
+
+public:
+  constexpr inline basic_adaptive_mutex() noexcept
+   : _state(eUnlocked)
+  {}
+
+  /***/
+  inline void lock() noexcept
+  {
+    if ( try_lock() ) [[likely]]
+      return;
+
+    uint32_t backoff = 1;
+    for ( uint32_t spin = 0; spin < spin_limit; ++spin )
+    {
+      for ( uint32_t pause = 0; pause < backoff; ++pause )
+        cpu_relax();
+      _stats.add( core::stats_event_t::spin );
+
+      if ( try_lock() )
+        return;
+
+      backoff = (backoff < max_backoff)?(backoff << 1):max_backoff;
+    }
+
+    for ( uint32_t yield = 0; yield < yield_limit; ++yield )
+    {
+      std::this_thread::yield();
+      _stats.add( core::stats_event_t::retry );
+
+      if ( try_lock() )
+        return;
+    }
+
+    // From here the state is left to eParked, so the thread that will unlock() 
+    // is aware that it has to notify.
+    while ( _state.exchange( eParked, std::memory_order_acquire ) != eUnlocked )
+    { 
+      _stats.add( core::stats_event_t::park );
+      _state.wait( eParked, std::memory_order_relaxed ); 
+    }
+  }
+
+  /***/
+  inline bool try_lock() noexcept
+  { 
+    uint32_t expected = eUnlocked;
+    if ( _state.load( std::memory_order_relaxed ) != eUnlocked )
+      return false;
+    return _state.compare_exchange_strong( expected, eLocked, std::memory_order_acquire, std::memory_order_relaxed ); 
+  }
+
+  /***/
+  inline void unlock() noexcept
+  { 
+    if ( _state.exchange( eUnlocked, std::memory_order_release ) == eParked )
+      _state.notify_one();
+  }
+
+  /**
+   * @brief Counters collected by stats_t.
+   */
+  constexpr inline core::stats_snapshot stats() const noexcept
+  { return _stats.snapshot(); }
+
 private:
-  std::atomic<bool> _lock;
+  std::atomic<uint32_t>           _state;
+  [[no_unique_address]] stats_t   _stats;
 };
 
+/**
+ * @brief basic_adaptive_mutex with default limits.
+ */
+using adaptive_mutex = basic_adaptive_mutex<>;
+
 }
 
 #endif // CORE_MUTEX_H
@@ -0,0 +1,345 @@
+/**************************************************************************************************
+ * 
+ * Copyright 2022 https://github.com/fe-dagostino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this 
+ * software and associated documentation files (the "Software"), to deal in the Software 
+ * without restriction, including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to the following 
+ * conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies 
+ * or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *************************************************************************************************/
+
+#ifndef CORE_RECLAMATION_H
+#define CORE_RECLAMATION_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "core/types.h"
+#include "core/thread_index.h"
+
+namespace core {
+
+/**
+ * @brief Function invoked to release an object once it is safe to do it.
+ * 
+ * @param ctx  context specified with retire(), usually the owner of the object.
+ * @param ptr  object to be released.
+ */
+using reclaim_fn = void (*)( void* ctx, void* ptr );
+
+/**
+ * @brief Default reclamation policy, objects are released as soon as they are retired.
+ *        This is the behaviour of data structures backed by an arena allocator, where
+ *        memory is never returned to the system while the structure is alive.
+ */
+class no_reclaimer final
+{
+public:
+  /** true when retire() defers the release. */
+  static constexpr const bool deferred = false;
+
+  /**
+   * @brief Critical section, nothing to do.
+   */
+  class guard final {
+  public:
+    /***/
+    constexpr inline explicit guard( no_reclaimer& ) noexcept
+    {}
+  };
+
+  /***/
+  constexpr inline void retire( void* ptr, reclaim_fn reclaim, void* ctx ) noexcept
+  { reclaim( ctx, ptr ); }
+
+  /***/
+  constexpr inline void drain() noexcept
+  {}
+
+  /***/
+  constexpr inline std::size_t pending() const noexcept
+  { return 0; }
+};
+
+/**
+ * @brief Epoch based reclamation.
+ *        Each thread accessing the data structure holds a guard, that announce the global 
+ *        epoch observed when the critical section started. Retired objects are kept in one 
+ *        of three buckets of the calling thread, selected by the global epoch; the global 
+ *        epoch moves forward only when all threads in a critical section have announced the 
+ *        current one, so objects retired in epoch 'e' can be released when the global epoch 
+ *        is 'e+2', since no thread can still hold a reference to them.
+ *        Buckets are accessed only by the thread that owns them, so retire() doesn't require
+ *        any synchronization other than the epoch announcement.
+ * 
+ *        Threads beyond max_reclaim_threads share the slot of thread_index::overflow_index, their 
+ *        critical sections are serialized by a mutex. If the bucket can't grow because no memory 
+ *        is available, the object is not released anymore, but it stays owned by ctx, i.e. an 
+ *        arena node goes back to the system with the arena.
+ * 
+ *        Note: drain() and the destructor release all retired objects, so they must be called
+ *              when no thread is accessing the data structure.
+ * 
+ * @tparam collect_rate  number of retire() calls, for each thread, between two attempts to 
+ *                       move the global epoch forward and release retired objects.
+ */
+template< std::size_t collect_rate = 64 >
+  requires ( collect_rate > 0 )
+class epoch_reclaimer final
+{
+public:
+  /** true when retire() defers the release. */
+  static constexpr const bool deferred = true;
+
+  /**
+   * @brief Critical section, objects reachable from the data structure when the guard 
+   *        has been created will not be released until the guard is destroyed.
+   *        Guards can be nested.
+   */
+  class guard final {
+  public:
+    /***/
+    inline explicit guard( epoch_reclaimer& reclaimer ) noexcept
+      : _reclaimer( reclaimer )
+    { _reclaimer.enter(); }
+
+    /***/
+    inline ~guard() noexcept
+    { _reclaimer.leave(); }
+
+    guard( const guard& ) = delete;
+    guard& operator=( const guard& ) = delete;
+
+  private:
+    epoch_reclaimer&  _reclaimer;
+  };
+
+  /***/
+  inline epoch_reclaimer() noexcept
+    : _epoch( 0 ), _used( 0 ), _slots( new(std::nothrow) slot_t[max_slots] )
+  { assert( _slots != nullptr ); }
+
+  /***/
+  inline ~epoch_reclaimer() noexcept
+  { drain(); }
+
+  epoch_reclaimer( const epoch_reclaimer& ) = delete;
+  epoch_reclaimer& operator=( const epoch_reclaimer& ) = delete;
+
+  /**
+   * @brief Release @param ptr invoking @param reclaim when no thread can access it anymore.
+   *        It must be called holding a guard, after @param ptr has been unlinked from the 
+   *        data structure.
+   */
+  inline void retire( void* ptr, reclaim_fn reclaim, void* ctx ) noexcept
+  {
+    // the caller holds a guard, so the overflow slot is already locked by this thread.
+    slot_t&            slot  = _slots[thread_index::get()];
+    const uint64_t     epoch = _epoch.load( std::memory_order_acquire );
+    const std::size_t  ndx   = epoch % buckets;
+
+    // Objects in the bucket have been retired at least three epochs ago.
+    if ( slot._epochs[ndx] != epoch )
+    {
+      release( slot, ndx );
+      slot._epochs[ndx] = epoch;
+    }
+
+    std::vector<retired_t>& bucket = slot._buckets[ndx];
+    if ( ( bucket.size() == bucket.capacity() ) && ( grow( bucket ) == false ) ) [[unlikely]]
+      return;
+
+    bucket.push_back( { ptr, reclaim, ctx } );
+    slot._pending.store( slot._pending.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+
+    if ( ++slot._retired >= collect_rate ) [[unlikely]]
+    {
+      slot._retired = 0;
+      try_advance();
+      collect( slot );
+    }
+  }
+
+  /**
+   * @brief Release all retired objects, this method is not thread safe.
+   */
+  inline void drain() noexcept
+  {
+    for ( std::size_t ndx = 0; ndx < max_slots; ++ndx )
+    {
+      for ( std::size_t bucket = 0; bucket < buckets; ++bucket )
+      { release( _slots[ndx], bucket ); }
+    }
+  }
+
+  /**
+   * @brief Return number of objects retired and not yet released, the value is 
+   *        approximated when other threads are retiring objects.
+   */
+  inline std::size_t pending() const noexcept
+  {
+    std::size_t       count = 0;
+    const std::size_t used  = _used.load( std::memory_order_acquire );
+    for ( std::size_t ndx = 0; ndx < used; ++ndx )
+    { count += _slots[ndx]._pending.load( std::memory_order_relaxed ); }
+    return count;
+  }
+
+  /**
+   * @brief Return current global epoch.
+   */
+  inline uint64_t epoch() const noexcept
+  { return _epoch.load( std::memory_order_acquire ); }
+
+private:
+  static constexpr const std::size_t buckets   = 3;
+  /** One slot for each thread_index, plus the overflow one. */
+  static constexpr const std::size_t max_slots = max_reclaim_threads + 1;
+
+  /***/
+  struct retired_t {
+    void*        _ptr;
+    reclaim_fn   _reclaim;
+    void*        _ctx;
+  };
+
+  /***/
+  struct alignas(core::cache_line_size) slot_t {
+    /** (epoch << 1) | 1 while in a critical section, 0 otherwise. */
+    std::atomic<uint64_t>                        _announce{ 0 };
+    uint32_t                                     _nesting = 0;
+    uint32_t                                     _retired = 0;
+    /** Objects in all buckets, written only by the owner thread. */
+    std::atomic<std::size_t>                     _pending{ 0 };
+    std::array<uint64_t,buckets>                 _epochs{};
+    std::array<std::vector<retired_t>,buckets>   _buckets;
+  };
+
+  /***/
+  inline void enter() noexcept
+  {
+    const std::size_t index = thread_index::get();
+    if ( index == thread_index::overflow_index ) [[unlikely]]
+    { _overflow_mtx.lock(); }
+
+    slot_t&           slot  = _slots[index];
+    if ( slot._nesting++ > 0 )
+      return;
+
+    // keep track of the highest index in use, so that try_advance() doesn't scan all slots.
+    std::size_t used = _used.load( std::memory_order_relaxed );
+    while ( ( used <= index ) && !_used.compare_exchange_weak( used, index+1, std::memory_order_relaxed ) )
+    {}
+
+    slot._announce.store( ( _epoch.load( std::memory_order_relaxed ) << 1 ) | 1, std::memory_order_relaxed );
+    // announcement must be visible before any pointer is read from the data structure.
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+  }
+
+  /***/
+  inline void leave() noexcept
+  {
+    const std::size_t index = thread_index::get();
+    slot_t&           slot  = _slots[index];
+    if ( --slot._nesting == 0 )
+    { slot._announce.store( 0, std::memory_order_release ); }
+
+    if ( index == thread_index::overflow_index ) [[unlikely]]
+    { _overflow_mtx.unlock(); }
+  }
+
+  /**
+   * @brief Move the global epoch forward if all threads in a critical section
+   *        have announced the current one.
+   */
+  inline void try_advance() noexcept
+  {
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+
+    uint64_t          epoch = _epoch.load( std::memory_order_relaxed );
+    const std::size_t used  = _used.load( std::memory_order_acquire );
+    for ( std::size_t ndx = 0; ndx < used; ++ndx )
+    {
+      const uint64_t announce = _slots[ndx]._announce.load( std::memory_order_acquire );
+      if ( ( ( announce & 1 ) != 0 ) && ( ( announce >> 1 ) != epoch ) )
+        return;
+    }
+
+    _epoch.compare_exchange_strong( epoch, epoch+1, std::memory_order_acq_rel, std::memory_order_relaxed );
+  }
+
+  /**
+   * @brief Release buckets in @param slot retired at least two epochs ago.
+   */
+  inline void collect( slot_t& slot ) noexcept
+  {
+    const uint64_t epoch = _epoch.load( std::memory_order_acquire );
+    for ( std::size_t ndx = 0; ndx < buckets; ++ndx )
+    {
+      if ( slot._epochs[ndx] + 2 <= epoch )
+      { release( slot, ndx ); }
+    }
+  }
+
+  /**
+   * @brief Reserve room in @param bucket, memory is preallocated for collect_rate objects and then 
+   *        doubled, so that push_back() never throws from retire().
+   * 
+   * @return false if there is no memory available.
+   */
+  static inline bool grow( std::vector<retired_t>& bucket ) noexcept
+  {
+    try
+    { bucket.reserve( std::max<std::size_t>( bucket.capacity()*2, collect_rate ) ); }
+    catch(...)
+    { return false; }
+
+    return true;
+  }
+
+  /***/
+  static inline void release( slot_t& slot, std::size_t ndx ) noexcept
+  {
+    std::vector<retired_t>& bucket = slot._buckets[ndx];
+    if ( bucket.empty() )
+      return;
+
+    for ( const auto& item : bucket )
+    { item._reclaim( item._ctx, item._ptr ); }
+
+    slot._pending.store( slot._pending.load( std::memory_order_relaxed ) - bucket.size(), std::memory_order_relaxed );
+    bucket.clear();
+  }
+
+private:
+  std::atomic<uint64_t>        _epoch;
+  std::atomic<std::size_t>     _used;
+  std::unique_ptr<slot_t[]>    _slots;
+  /* held by threads using the overflow slot while they are in a critical section, recursive since guards can be nested. */
+  std::recursive_mutex         _overflow_mtx;
+};
+
+}
+
+#endif // CORE_RECLAMATION_H
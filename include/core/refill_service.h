@@ -0,0 +1,203 @@
+/**************************************************************************************************
+ * 
+ * Copyright 2022 https://github.com/fe-dagostino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this 
+ * software and associated documentation files (the "Software"), to deal in the Software 
+ * without restriction, including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to the following 
+ * conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies 
+ * or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *************************************************************************************************/
+
+#ifndef CORE_REFILL_SERVICE_H
+#define CORE_REFILL_SERVICE_H
+
+#include <list>
+
+#include "config.h"
+#include "core/types.h"
+
+namespace core {
+
+/**
+ * @brief A single background thread shared by all arena allocators that grow asynchronously.
+ *        Each arena subscribe() itself once and then request() a refill when its free slots
+ *        are below the threshold; requests from the same arena are coalesced until the 
+ *        service thread has served them.
+ *        The service thread is started with the first subscription and stopped at exit.
+ * 
+ *        Prefetch depth is the max number of chunks added for each request, so raising it
+ *        keeps more slots ready in advance when allocations come in bursts.
+ */
+class refill_service final 
+{
+public:
+  /**
+   * @brief Callback invoked from the service thread.
+   * 
+   * @param owner  object that has been registered with subscribe().
+   * @param depth  current prefetch depth, always greater than 0.
+   */
+  using refill_fn = void (*)( void* owner, std::size_t depth );
+
+  /**
+   * @brief Registration returned by subscribe().
+   */
+  class client final
+  {
+    friend class refill_service;
+  public:
+    /**
+     * @brief Ask the service thread to invoke the refill callback. 
+     *        This is cheap when a request is already pending.
+     */
+    inline void request() noexcept
+    {
+      if ( _pending.load( std::memory_order_relaxed ) == true ) [[likely]]
+        return;
+
+      if ( _pending.exchange( true, std::memory_order_acq_rel ) == false )
+      { _service->wake_up(); }
+    }
+
+  private:
+    void*             _owner   = nullptr;
+    refill_fn         _refill  = nullptr;
+    refill_service*   _service = nullptr;
+    std::atomic_bool  _pending{ false };
+  };
+
+  /***/
+  static inline refill_service& instance() noexcept
+  { 
+    static refill_service s_instance;
+    return s_instance; 
+  }
+
+  /***/
+  refill_service( const refill_service& ) = delete;
+  /***/
+  refill_service& operator=( const refill_service& ) = delete;
+
+  /**
+   * @brief Register @param owner, @param refill will be invoked in the service thread 
+   *        each time that client::request() is called on returned object.
+   */
+  inline client* subscribe( void* owner, refill_fn refill ) noexcept
+  {
+    std::lock_guard<std::mutex> lock( _mtx_clients );
+
+    client& cl  = _clients.emplace_back();
+    cl._owner   = owner;
+    cl._refill  = refill;
+    cl._service = this;
+
+    if ( _thread.joinable() == false )
+    { _thread = std::thread( &refill_service::run, this ); }
+
+    return &cl;
+  }
+
+  /**
+   * @brief Remove @param cl from served clients, when the function returns 
+   *        the refill callback is not running and will not be invoked anymore.
+   */
+  inline void unsubscribe( client* cl ) noexcept
+  {
+    std::lock_guard<std::mutex> lock( _mtx_clients );
+
+    _clients.remove_if( [cl]( const client& item ){ return &item == cl; } );
+  }
+
+  /**
+   * @brief Set max number of chunks added for each request, 0 is treated as 1.
+   */
+  inline void set_prefetch_depth( std::size_t depth ) noexcept
+  { _prefetch_depth.store( std::max<std::size_t>( depth, 1 ), std::memory_order_relaxed ); }
+
+  /***/
+  inline std::size_t prefetch_depth() const noexcept
+  { return _prefetch_depth.load( std::memory_order_relaxed ); }
+
+  /**
+   * @brief Return number of registered clients.
+   */
+  inline std::size_t clients() const noexcept
+  {
+    std::lock_guard<std::mutex> lock( _mtx_clients );
+    return _clients.size();
+  }
+
+private:
+  /***/
+  inline refill_service() noexcept
+    : _prefetch_depth( 1 ), _signal( 0 ), _exit( false )
+  {}
+
+  /***/
+  inline ~refill_service() noexcept
+  {
+    _exit.store( true, std::memory_order_release );
+    wake_up();
+
+    if ( _thread.joinable() )
+    { _thread.join(); }
+  }
+
+  /***/
+  inline void wake_up() noexcept
+  {
+    _signal.store( 1, std::memory_order_release );
+    _signal.notify_one();
+  }
+
+  /**
+   * @brief Service thread, clients are served under _mtx_clients so that
+   *        unsubscribe() cannot complete while a callback is running.
+   */
+  inline void run() noexcept
+  {
+    for (;;)
+    {
+      _signal.wait( 0, std::memory_order_acquire );
+
+      if ( _exit.load( std::memory_order_acquire ) == true )
+        break;
+
+      // Requests issued from now on will wake up the thread again.
+      _signal.store( 0, std::memory_order_release );
+
+      std::lock_guard<std::mutex> lock( _mtx_clients );
+
+      for ( auto& cl : _clients )
+      {
+        if ( cl._pending.exchange( false, std::memory_order_acq_rel ) == true )
+        { cl._refill( cl._owner, prefetch_depth() ); }
+      }
+    }
+  }
+
+private:
+  std::list<client>         _clients;
+  mutable std::mutex        _mtx_clients;
+  std::atomic<std::size_t>  _prefetch_depth;
+  std::atomic<uint32_t>     _signal;
+  std::atomic_bool          _exit;
+  std::thread               _thread;
+};
+
+}
+
+#endif //CORE_REFILL_SERVICE_H
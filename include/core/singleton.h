@@ -24,6 +24,10 @@
 #ifndef CORE_SINGLETON_H
 #define CORE_SINGLETON_H
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+
 #include "config.h"
 #include "types.h"
 
@@ -34,6 +38,8 @@ namespace core {
  *        the possibility to call constructors with parameters as well as to minimize
  *        all conditional check at runtime due to initialization leveraging N2660
  *        ( https://www.open-std.org/jtc1/sc22/wg21/docs/papers/2008/n2660.htm ).
+ *        Initialization is serialized with a mutex, while get_instance() is a single acquire load, 
+ *        so accessing the instance on hot paths has no synchronization cost.
  * 
  * @tparam derived_t derived class.
  */
@@ -57,6 +63,10 @@ public:
   template<typename... args_t>
   static bool   initialize( args_t&&... args ) noexcept
   {
+    if ( m_pointer.load( std::memory_order_acquire ) != nullptr )
+      return false;
+
+    std::lock_guard<std::mutex> lock( m_mutex );
     if ( m_instance )
       return false;
 
@@ -67,9 +77,32 @@ public:
 
     m_instance->on_initialize();
 
+    // published only once on_initialize() completed, still holding m_mutex; release pairs with 
+    // the acquire in get_instance(), so the initialized object is visible to all threads.
+    m_pointer.store( m_instance.get(), std::memory_order_release );
+
     return true;
   }
 
+  /**
+   * @brief Double-checked lazy initialization: return the instance if available, otherwise 
+   *        initialize() it with @param args; when more threads race only one of them creates 
+   *        the instance and all of them get it.
+   * 
+   * @return nullptr if there is no available memory to create the singleton instance.
+   */
+  template<typename... args_t>
+  static derived_t* get_or_initialize( args_t&&... args ) noexcept
+  {
+    derived_t* instance = m_pointer.load( std::memory_order_acquire );
+    if ( instance != nullptr ) [[likely]]
+      return instance;
+
+    (void)initialize( std::forward<args_t>(args)... );
+
+    return m_pointer.load( std::memory_order_acquire );
+  }
+
   /**
    * @brief singleton is considered valid in case it have been correctly initialized.
    * 
@@ -77,15 +110,15 @@ public:
    * @return false singleton have been no initialized
    */
   static constexpr bool   is_valid() noexcept
-  { return (m_instance != nullptr); }
+  { return (get_instance() != nullptr); }
 
   /**
-   * @brief Get the instance object
+   * @brief Get the instance object, with a single acquire load.
    * 
-   * @return derived_t* 
+   * @return derived_t* or nullptr if initialize() have not been completed yet, on_initialize() included.
    */
   static derived_t* get_instance() noexcept
-  { return m_instance.get(); }
+  { return m_pointer.load( std::memory_order_acquire ); }
 
   /**
    * @brief This method is intended to be called at the end of the program execution
@@ -111,6 +144,9 @@ protected:
 
 private:
   inline static std::unique_ptr<derived_t>   m_instance = nullptr;
+  // published copy of m_instance, read without locking.
+  inline static std::atomic<derived_t*>      m_pointer  = nullptr;
+  inline static std::mutex                   m_mutex;
 };
 
 }
@@ -0,0 +1,191 @@
+/**************************************************************************************************
+ * 
+ * Copyright 2022 https://github.com/fe-dagostino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this 
+ * software and associated documentation files (the "Software"), to deal in the Software 
+ * without restriction, including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to the following 
+ * conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies 
+ * or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *************************************************************************************************/
+
+#ifndef CORE_STATS_H
+#define CORE_STATS_H
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+
+#include "config.h"
+#include "core/thread_index.h"
+
+namespace core {
+
+/**
+ * @brief Events accounted by a stats policy.
+ */
+enum class stats_event_t : std::size_t {
+  cas_failure,   // a compare_exchange lost against a concurrent thread
+  retry,         // a lock-free loop restarted without a CAS, e.g. helping a pending update
+  spin,          // a backoff round spent waiting for a lock
+  park,          // a thread parked waiting for a lock
+  chunk_growth,  // a new chunk added to an arena
+  alloc_miss,    // allocate() returned nullptr, arena exhausted or still growing
+  empty,         // pop from an empty data structure
+  full,          // push failed since no node was available
+  count          // number of events, not an event
+};
+
+/**
+ * @brief Number of stats_event_t values.
+ */
+constexpr const std::size_t stats_events = static_cast<std::size_t>(stats_event_t::count);
+
+/**
+ * @brief Values of all counters collected by a stats policy at a given time.
+ */
+struct stats_snapshot
+{
+  /***/
+  constexpr inline uint64_t         operator[]( stats_event_t event ) const noexcept
+  { return counters[static_cast<std::size_t>(event)]; }
+
+  /**
+   * @brief Accumulate @param other, used to merge counters of nested objects such as arenas and mutexes.
+   */
+  constexpr inline stats_snapshot&  operator+=( const stats_snapshot& other ) noexcept
+  {
+    for ( std::size_t ndx = 0; ndx < stats_events; ++ndx )
+    { counters[ndx] += other.counters[ndx]; }
+    return *this;
+  }
+
+  std::array<uint64_t,stats_events>   counters{};
+};
+
+/**
+ * @brief Requirements for a stats policy used by data structures, arenas and mutexes.
+ */
+template<typename stats_t>
+concept stats_policy = requires( stats_t& stats, const stats_t& cstats ) {
+  { stats_t::enabled } -> std::convertible_to<bool>;
+  { stats.add( stats_event_t::retry ) };
+  { stats.add( stats_event_t::retry, uint64_t(1) ) };
+  { cstats.snapshot() } -> std::same_as<stats_snapshot>;
+  { stats.reset() };
+};
+
+/**
+ * @brief Default stats policy, nothing is accounted and used as [[no_unique_address]] 
+ *        member it takes no memory, so instrumentation has no cost.
+ */
+class no_stats final
+{
+public:
+  static constexpr const bool enabled = false;
+
+  /***/
+  constexpr inline void            add( stats_event_t, uint64_t = 1 ) noexcept
+  {}
+
+  /***/
+  constexpr inline stats_snapshot  snapshot() const noexcept
+  { return stats_snapshot{}; }
+
+  /***/
+  constexpr inline void            reset() noexcept
+  {}
+};
+
+/**
+ * @brief Stats policy with per-thread counters, each thread updates with relaxed RMW the stripe 
+ *        selected by its core::thread_index, and each stripe has its own cache line; so counting 
+ *        doesn't add contention to the instrumented data structure.
+ *        snapshot() sums all stripes and it is approximate while updates are in progress.
+ * 
+ * @tparam stripes  number of stripes, it must be a power of 2. Threads whose index exceeds the 
+ *                  number of stripes share a stripe with another thread.
+ */
+template<std::size_t stripes = 16>
+requires (std::has_single_bit(stripes))
+class basic_thread_stats final
+{
+public:
+  static constexpr const bool enabled = true;
+
+  /***/
+  constexpr inline basic_thread_stats() noexcept
+    : _stripes()
+  {}
+
+  basic_thread_stats( const basic_thread_stats& ) = delete;
+  basic_thread_stats& operator=( const basic_thread_stats& ) = delete;
+
+  /**
+   * @brief Account @param count occurrences of @param event.
+   */
+  inline void                      add( stats_event_t event, uint64_t count = 1 ) noexcept
+  { 
+    _stripes[core::thread_index::get() & (stripes-1)]
+      ._counters[static_cast<std::size_t>(event)].fetch_add( count, std::memory_order_relaxed ); 
+  }
+
+  /**
+   * @brief Sum of all stripes.
+   */
+  constexpr inline stats_snapshot  snapshot() const noexcept
+  {
+    stats_snapshot result;
+    for ( const auto& stripe : _stripes )
+    {
+      for ( std::size_t ndx = 0; ndx < stats_events; ++ndx )
+      { result.counters[ndx] += stripe._counters[ndx].load( std::memory_order_relaxed ); }
+    }
+    return result;
+  }
+
+  /**
+   * @brief Set all counters to 0, concurrent updates can be lost.
+   */
+  constexpr inline void            reset() noexcept
+  {
+    for ( auto& stripe : _stripes )
+    {
+      for ( auto& counter : stripe._counters )
+      { counter.store( 0, std::memory_order_relaxed ); }
+    }
+  }
+
+private:
+  // 64 is core::cache_line_size, core/types.h can't be included here since it depends on core/mutex.h.
+  struct alignas(64) stripe_t
+  {
+    std::array<std::atomic<uint64_t>,stats_events>  _counters{};
+  };
+
+  std::array<stripe_t,stripes>  _stripes;
+};
+
+/**
+ * @brief basic_thread_stats with default number of stripes.
+ */
+using thread_stats = basic_thread_stats<>;
+
+}
+
+#endif // CORE_STATS_H
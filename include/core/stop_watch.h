@@ -29,6 +29,8 @@
 #include "config.h"
 #include "core/types.h"
 #include "core/utils.h"
+#include "core/tsc_clock.h"
+#include "core/histogram.h"
 
 namespace core {
 
@@ -61,6 +63,48 @@ private:
   typename T::rep   m_tp;
 };
 
+/**
+ * @brief stop_watch based on core::tsc_clock, cheap enough to time a single operation on 
+ *        hot paths; lap() record the elapsed time in a core::basic_histogram and restart.
+ */
+class tsc_stop_watch final
+{
+public:  
+  /***/
+  inline tsc_stop_watch() noexcept
+    : m_tc( core::tsc_clock::ticks() )
+  {}
+  /***/
+  inline void     reset() noexcept
+  { m_tc = core::tsc_clock::ticks(); }
+  /**
+   * @brief Elapsed ticks since last reset().
+   */
+  inline uint64_t peek() const noexcept
+  { return core::tsc_clock::ticks()-m_tc; }
+  /**
+   * @brief Elapsed nanoseconds since last reset().
+   */
+  inline uint64_t peek_ns() const noexcept
+  { return core::tsc_clock::to_ns( peek() ); }
+  /**
+   * @brief Record in @param hist nanoseconds elapsed since last reset() and restart.
+   * 
+   * @return recorded value.
+   */
+  template<uint32_t precision_bits>
+  inline uint64_t lap( core::basic_histogram<precision_bits>& hist ) noexcept
+  { 
+    const uint64_t now = core::tsc_clock::ticks();
+    const uint64_t ns  = core::tsc_clock::to_ns( now-m_tc );
+    hist.record( ns );
+    m_tc = now;
+    return ns;
+  }
+private:
+  uint64_t          m_tc;
+};
+
 }
 
 #endif // CORE_STOP_WATCH_H
\ No newline at end of file
@@ -0,0 +1,99 @@
+/**************************************************************************************************
+ * 
+ * Copyright 2022 https://github.com/fe-dagostino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this 
+ * software and associated documentation files (the "Software"), to deal in the Software 
+ * without restriction, including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to the following 
+ * conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies 
+ * or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *************************************************************************************************/
+
+#ifndef CORE_THREAD_INDEX_H
+#define CORE_THREAD_INDEX_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+#include "config.h"
+
+namespace core {
+
+/**
+ * @brief Max number of threads that can access concurrently a data structure 
+ *        using core::epoch_reclaimer.
+ */
+constexpr const std::size_t max_reclaim_threads = 128;
+
+/**
+ * @brief Return an index in [0,max_reclaim_threads) unique among running threads.
+ *        Indexes are recycled when threads exit, if all of them are in use the 
+ *        calling thread gets overflow_index, that is shared with all other threads 
+ *        in the same condition and kept until the thread exits.
+ */
+class thread_index final
+{
+public:
+  /** Index shared by threads started when all the others are in use, users must serialize its access. */
+  static constexpr const std::size_t overflow_index = max_reclaim_threads;
+
+  /***/
+  static inline std::size_t get() noexcept
+  {
+    static thread_local const thread_index th_index;
+    return th_index._index;
+  }
+
+private:
+  /***/
+  inline thread_index() noexcept
+    : _index( acquire() )
+  {}
+
+  /***/
+  inline ~thread_index() noexcept
+  { 
+    if ( _index != overflow_index )
+      slots()[_index].store( false, std::memory_order_release ); 
+  }
+
+  /***/
+  static inline std::array<std::atomic_bool,max_reclaim_threads>& slots() noexcept
+  {
+    static std::array<std::atomic_bool,max_reclaim_threads> s_slots{};
+    return s_slots;
+  }
+
+  /***/
+  static inline std::size_t acquire() noexcept
+  {
+    for ( std::size_t ndx = 0; ndx < max_reclaim_threads; ++ndx )
+    {
+      bool expected = false;
+      if ( ( slots()[ndx].load( std::memory_order_relaxed ) == false ) &&
+           slots()[ndx].compare_exchange_strong( expected, true, std::memory_order_acquire, std::memory_order_relaxed ) )
+        return ndx;
+    }
+
+    return overflow_index;
+  }
+
+  const std::size_t   _index;
+};
+
+}
+
+#endif // CORE_THREAD_INDEX_H
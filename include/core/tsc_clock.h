@@ -0,0 +1,133 @@
+/**************************************************************************************************
+ * 
+ * Copyright 2022 https://github.com/fe-dagostino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this 
+ * software and associated documentation files (the "Software"), to deal in the Software 
+ * without restriction, including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to the following 
+ * conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies 
+ * or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *************************************************************************************************/
+
+#ifndef CORE_TSC_CLOCK_H
+#define CORE_TSC_CLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER) && ( defined(_M_X64) || defined(_M_IX86) )
+# include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+# include <x86intrin.h>
+#endif
+
+#include "config.h"
+
+namespace core {
+
+/**
+ * @brief Clock source reading the cpu cycle counter, rdtsc on x86 and cntvct_el0 on aarch64, 
+ *        with a cost of a few nanoseconds and without a system call; on other architectures 
+ *        it fallback to std::chrono::steady_clock and one tick is one nanosecond.
+ *        Ticks are converted to nanoseconds with a ratio measured against steady_clock the first 
+ *        time it is needed, or explicitly with calibrate().
+ * 
+ *        Note: it assumes an invariant counter, synchronized among cores, as on all recent x86 and 
+ *              arm cpus; the read is not serializing so it is meant for durations in the order of 
+ *              tens of nanoseconds or more, such as latencies of push(), pop() or allocate().
+ */
+class tsc_clock final
+{
+public:
+  /** true when ticks() reads a hardware counter. */
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86) || defined(__aarch64__)
+  static constexpr const bool is_hardware = true;
+#else
+  static constexpr const bool is_hardware = false;
+#endif
+
+  /**
+   * @brief Current value of the counter.
+   */
+  static inline uint64_t  ticks() noexcept
+  {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r"(value) :: "memory");
+    return value;
+#else
+    return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+#endif
+  }
+
+  /**
+   * @brief Measure the ratio between nanoseconds and ticks, spinning for @param duration, and 
+   *        use it for following conversions. A longer @param duration gives a better accuracy.
+   * 
+   * @return nanoseconds per tick.
+   */
+  static inline double    calibrate( std::chrono::nanoseconds duration = std::chrono::milliseconds(10) ) noexcept
+  {
+    double ratio = 1.0;
+    if constexpr ( is_hardware )
+    {
+      const auto     tp_start = std::chrono::steady_clock::now();
+      const uint64_t tc_start = ticks();
+      auto           tp_end   = tp_start;
+      do {
+        tp_end = std::chrono::steady_clock::now();
+      } while ( tp_end - tp_start < duration );
+      const uint64_t tc_end   = ticks();
+
+      if ( tc_end > tc_start )
+        ratio = double(std::chrono::duration_cast<std::chrono::nanoseconds>(tp_end - tp_start).count()) / double(tc_end - tc_start);
+    }
+
+    ns_per_tick_value().store( ratio, std::memory_order_relaxed );
+    return ratio;
+  }
+
+  /**
+   * @brief Nanoseconds per tick, calibrate() is invoked the first time if not done before.
+   */
+  static inline double    ns_per_tick() noexcept
+  {
+    double ratio = ns_per_tick_value().load( std::memory_order_relaxed );
+    if ( ratio == 0.0 ) [[unlikely]]
+      ratio = calibrate();
+    return ratio;
+  }
+
+  /**
+   * @brief Convert @param ticks, usually a difference between two ticks(), in nanoseconds.
+   */
+  static inline uint64_t  to_ns( uint64_t ticks ) noexcept
+  { return static_cast<uint64_t>( double(ticks) * ns_per_tick() ); }
+
+private:
+  /***/
+  static inline std::atomic<double>& ns_per_tick_value() noexcept
+  {
+    static std::atomic<double> s_ratio{ 0.0 };
+    return s_ratio;
+  }
+};
+
+}
+
+#endif // CORE_TSC_CLOCK_H
@@ -28,6 +28,9 @@
 #include <cstdint>
 #include <type_traits>
 #include <algorithm>
+#include <concepts>
+#include <initializer_list>
+#include <utility>
 
 #include <mutex>
 #include "config.h"
@@ -47,6 +50,8 @@ enum class result_t {
     eSuccess         =    1,
 
     eEmpty           =    2,
+    eNotFound        =    3,
+    eAlreadyExists   =    4,
     
     eNullPointer     =  100,
     eDoubleFree      =  101,
@@ -61,7 +66,112 @@ enum class ds_impl_t {
   raw,
   mutex,
   spinlock,
-  lockfree
+  adaptive,
+  lockfree,
+  mpsc      // lock-free, multiple producers and a single consumer
+};
+
+/**
+ * @brief Number of producers and consumers allowed to access a data structure concurrently.
+ */
+enum class access_t {
+  mpmc,   // multiple producers, multiple consumers
+  spsc    // single producer, single consumer
+};
+
+/**
+ * @brief Memory layout of the slots in an arena allocator.
+ */
+enum class slot_layout_t {
+  header, // each slot has a header with free-list link, flags and owner index 
+  overlay // free-list link overlays user data, owner is found from the chunk address
+};
+
+/**
+ * @brief Policy used to track the number of items held by a data structure.
+ */
+enum class counter_t {
+  exact,   // single atomic counter, size() is exact
+  striped  // one counter per stripe, updated by the calling thread, size() is approximate
+};
+
+/**
+ * @brief Size in bytes of a cache line, used to keep apart data members that are 
+ *        written by different threads and avoid false sharing.
+ */
+constexpr const std::size_t cache_line_size = 64;
+
+/**
+ * @brief Placeholder for the arena_t template parameter of queue and stack, it selects the 
+ *        default lock_free::arena_allocator configured from the other template parameters of 
+ *        the data structure, stats_t included.
+ */
+struct default_arena final {};
+
+/**
+ * @brief Memory layout of the control block of a data structure.
+ */
+enum class layout_t {
+  compact, // data members are packed, minimal memory footprint
+  padded   // atomics written by different threads are kept on separate cache lines
+};
+
+/**
+ * @brief Extends @tparam data_t, usually an std::atomic, aligning it to a cache line; so it 
+ *        doesn't share the line with any other data member and it can be used in place of data_t.
+ *        data_t must be a class type.
+ */
+template<typename data_t>
+struct alignas(cache_line_size) cache_aligned : data_t
+{
+  using data_t::data_t;
+  using data_t::operator=;
+};
+
+/**
+ * @brief @tparam data_t aligned to a cache line when @tparam padded is true, data_t otherwise.
+ */
+template<typename data_t, bool padded>
+using cache_aligned_if = std::conditional_t<padded, cache_aligned<data_t>, data_t>;
+
+/**
+ * @brief Memory orders used by lock-free data structures. Each atomic operation is written 
+ *        with the weakest order that is correct where it is used, and the profile maps it to 
+ *        the order actually applied.
+ *        core::minimal_order (default) apply them as they are, so ordering costs only what is 
+ *        needed, that matters on weakly ordered CPUs such as aarch64.
+ */
+struct minimal_order final
+{
+  static constexpr const std::memory_order relaxed = std::memory_order_relaxed;
+  static constexpr const std::memory_order acquire = std::memory_order_acquire;
+  static constexpr const std::memory_order release = std::memory_order_release;
+  static constexpr const std::memory_order acq_rel = std::memory_order_acq_rel;
+};
+
+/**
+ * @brief Profile applying std::memory_order_seq_cst to all atomic operations, in order to
+ *        rule out ordering issues while debugging or with tools that only model sequential 
+ *        consistency.
+ */
+struct seq_cst_order final
+{
+  static constexpr const std::memory_order relaxed = std::memory_order_seq_cst;
+  static constexpr const std::memory_order acquire = std::memory_order_seq_cst;
+  static constexpr const std::memory_order release = std::memory_order_seq_cst;
+  static constexpr const std::memory_order acq_rel = std::memory_order_seq_cst;
+};
+
+/**
+ * @brief Define concept for memory order profiles such as core::minimal_order.
+ */
+template <typename O>
+concept memory_order_profile = requires( ) 
+{
+  { O::relaxed } -> std::convertible_to<std::memory_order>;
+  { O::acquire } -> std::convertible_to<std::memory_order>;
+  { O::release } -> std::convertible_to<std::memory_order>;
+  { O::acq_rel } -> std::convertible_to<std::memory_order>;
 };
 
 /********************************** SPECIFIC FOR TUPLE ************************************/
@@ -278,6 +388,29 @@ struct plug_mutex<false,mutex_t,0> {
   constexpr static const bool has_mutex = false;
 };
 
+/**
+ * @brief true when data structures with @tparam imp_type implementation have to be protected by a mutex.
+ */
+template<ds_impl_t imp_type>
+constexpr const bool ds_has_mutex = (imp_type==ds_impl_t::mutex) || (imp_type==ds_impl_t::spinlock) || (imp_type==ds_impl_t::adaptive);
+
+/**
+ * @brief true when data structures with @tparam imp_type implementation link nodes with atomics.
+ */
+template<ds_impl_t imp_type>
+constexpr const bool ds_is_lockfree = (imp_type==ds_impl_t::lockfree) || (imp_type==ds_impl_t::mpsc);
+
+/**
+ * @brief Mutex used with @tparam imp_type implementation:
+ *        - mutex    : std::mutex
+ *        - spinlock : core::mutex
+ *        - adaptive : core::adaptive_mutex
+ *        spinlock and adaptive mutexes account their events with @tparam stats_t.
+ */
+template<ds_impl_t imp_type, typename stats_t = core::no_stats>
+using ds_mutex_t = std::conditional_t<(imp_type==ds_impl_t::spinlock), core::basic_mutex<stats_t>, 
+                                      std::conditional_t<(imp_type==ds_impl_t::adaptive), core::basic_adaptive_mutex<16,4,stats_t>, std::mutex>>;
+
 /**
  * @brief forward declaration for node_t, intended for generic usage in queue stack, double linked list
  *        as well as in lock-free data structures.
@@ -288,14 +421,17 @@ struct plug_mutex<false,mutex_t,0> {
  * @tparam add_next      if true, node_t will have a data members _nexr defined as a pointer to node_t
  *                       has_next return true or false accordingly with this value.
  * @tparam use_atomic    specify if _prev and _next should be atomic<node_t*> or simple node_t*.
+ * @tparam alignment     0 (default) node_t has its natural alignment, otherwise the alignment 
+ *                       specified, in example core::cache_line_size to avoid that two nodes 
+ *                       share the same cache line.
  */
-template<typename value_type,bool add_prev,bool add_next, bool use_atomic>
+template<typename value_type,bool add_prev,bool add_next, bool use_atomic, std::size_t alignment = 0>
 struct node_t;
 
 /**
  * @brief template structure that will be specialized with a data memeber by default.
  */
-template<typename value_type,bool add_prev,bool add_next, bool use_atomic>
+template<typename value_type,bool add_prev,bool add_next, bool use_atomic, std::size_t alignment>
 struct plug_prev {
   constexpr static bool has_prev = true;
 
@@ -303,7 +439,7 @@ struct plug_prev {
     : _prev(nullptr)
   {}
   
-  using pointer   = node_t<value_type,add_prev,add_next,use_atomic>*;
+  using pointer   = node_t<value_type,add_prev,add_next,use_atomic,alignment>*;
   using node_type = std::conditional_t<use_atomic, std::atomic<pointer>, pointer>;
 
   node_type   _prev;
@@ -312,15 +448,15 @@ struct plug_prev {
 /**
  * @brief specialization for add_prev == false.
  */
-template <typename value_type,bool add_next,bool use_atomic>
-struct plug_prev<value_type,false,add_next,use_atomic> {
+template <typename value_type,bool add_next,bool use_atomic, std::size_t alignment>
+struct plug_prev<value_type,false,add_next,use_atomic,alignment> {
   constexpr static bool has_prev = false;
 };
 
 /**
  * @brief template structure that will be specialized with a data memeber by default.
  */
-template<typename value_type,bool add_prev,bool add_next, bool use_atomic>
+template<typename value_type,bool add_prev,bool add_next, bool use_atomic, std::size_t alignment>
 struct plug_next {
   constexpr static bool has_next = true;
 
@@ -328,7 +464,7 @@ struct plug_next {
     : _next(nullptr)
   {}
 
-  using pointer   = node_t<value_type,add_prev,add_next,use_atomic>*;
+  using pointer   = node_t<value_type,add_prev,add_next,use_atomic,alignment>*;
   using node_type = std::conditional_t<use_atomic, std::atomic<pointer>, pointer>;
 
   node_type   _next;
@@ -337,8 +473,8 @@ struct plug_next {
 /**
  * @brief specialization for add_next == false.
  */
-template <typename value_type,bool add_prev,bool use_atomic>
-struct plug_next<value_type,add_prev,false,use_atomic> {
+template <typename value_type,bool add_prev,bool use_atomic, std::size_t alignment>
+struct plug_next<value_type,add_prev,false,use_atomic,alignment> {
   constexpr static bool has_next = false;    
 };
 
@@ -351,13 +487,15 @@ struct plug_next<value_type,add_prev,false,use_atomic> {
  *   Note: inner forward declaration for templates is not supported, so 
  *         externalize node_t is workaround.
  */
-template<typename value_type, bool add_prev,bool add_next, bool use_atomic>
-struct node_t : plug_prev<value_type, add_prev, add_next, use_atomic>, 
-                plug_next<value_type, add_prev, add_next, use_atomic> 
+template<typename value_type, bool add_prev,bool add_next, bool use_atomic, std::size_t alignment>
+struct alignas( std::max( { alignment, alignof(value_type), 
+                             ((add_prev || add_next)?alignof(std::conditional_t<use_atomic,std::atomic<void*>,void*>):alignof(value_type)) } ) ) 
+       node_t : plug_prev<value_type, add_prev, add_next, use_atomic, alignment>, 
+                plug_next<value_type, add_prev, add_next, use_atomic, alignment> 
 {
-  using node_prev_type = plug_prev<value_type,add_prev,add_next,use_atomic>;
-  using node_next_type = plug_next<value_type,add_prev,add_next,use_atomic>;
-  using pointer        = node_t<value_type,add_prev,add_next,use_atomic>*;
+  using node_prev_type = plug_prev<value_type,add_prev,add_next,use_atomic,alignment>;
+  using node_next_type = plug_next<value_type,add_prev,add_next,use_atomic,alignment>;
+  using pointer        = node_t<value_type,add_prev,add_next,use_atomic,alignment>*;
 
   /**
    * @brief Default constructor.
@@ -380,11 +518,18 @@ struct node_t : plug_prev<value_type, add_prev, add_next, use_atomic>,
   { }
 
   /**
-   * @brief Destructor.
+   * @brief Constructor building _data in place from @param args.
    */
-  constexpr inline ~node_t() noexcept
+  template<typename... Args>
+  constexpr inline explicit node_t( std::in_place_t, Args&&... args ) noexcept
+    : _data( std::forward<Args>(args)... )
   { }
 
+  /**
+   * @brief Destructor, defaulted so that node_t is trivially destructible when value_type is.
+   */
+  constexpr inline ~node_t() noexcept = default;
+
   /***/
   constexpr inline node_t& operator=( const node_t& node ) noexcept
   {
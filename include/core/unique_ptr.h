@@ -33,14 +33,30 @@
 namespace core {
 
 template<class T, class U>
-concept Derived = std::is_base_of<U, T>::value;
+concept Derived = std::is_base_of<U, T>::value || std::is_same_v<T, U>;
 
 template<class T>
 concept Data_t = (    std::is_object_v<T>
                    && !std::is_array_v<T> 
                    && !std::is_pointer_v<T> );
 
-template <Data_t data_t>
+/**
+ * @brief Default deleter for unique_ptr, objects are released with delete.
+ */
+struct default_delete
+{
+  /***/
+  template<typename data_t>
+  static constexpr inline void destroy( data_t* ptr ) noexcept
+  { delete ptr; }
+};
+
+/**
+ * @tparam data_t     type of the object owned.
+ * @tparam deleter_t  class with a static destroy() that release the object, 
+ *                    default_delete (default) or core::arena_delete.
+ */
+template <Data_t data_t, typename deleter_t = default_delete>
 class unique_ptr
 {
   using value_type      = data_t; 
@@ -53,6 +69,8 @@ class unique_ptr
   using mem_address_ref = mem_address&;
 
 public:
+  using deleter_type    = deleter_t;
+
   /***/
   constexpr inline unique_ptr( ) noexcept
     : _ptr( )
@@ -65,7 +83,7 @@ public:
   /**
    * @brief explicity disable copy constructor.
    */
-  constexpr inline unique_ptr( const unique_ptr<value_type>& ptr ) noexcept = delete;
+  constexpr inline unique_ptr( const unique_ptr& ptr ) noexcept = delete;
 
   /***/
   template<Derived<value_type> T>
@@ -75,13 +93,14 @@ public:
 
   /***/
   template<Derived<value_type> T>
+    requires std::is_same_v<deleter_t,default_delete>
   constexpr inline unique_ptr( std::unique_ptr<T>&& ptr, bool autodelete = true ) noexcept
     : _ptr( ptr.release(), (autodelete)?(uint32_t)(mem_address::address_flags::DESTROY):(uint32_t)0, 0 )
   { }
 
   /***/
   template<Derived<value_type> T>
-  constexpr inline unique_ptr( unique_ptr<T>&& ptr ) noexcept
+  constexpr inline unique_ptr( unique_ptr<T,deleter_type>&& ptr ) noexcept
     : _ptr( ptr.get(), (ptr.auto_delete())?(uint32_t)(mem_address::address_flags::DESTROY):(uint32_t)0, 0 )
   { 
     ptr.release();
@@ -92,7 +111,7 @@ public:
   {
     if ((auto_delete()) && ( _ptr != nullptr ))
     {
-      delete (pointer)_ptr;
+      deleter_type::destroy( (pointer)_ptr );
       _ptr.set_address( nullptr );
     }
   }
@@ -100,11 +119,11 @@ public:
   /**
    * @brief explicity disable assignment operator.
    */
-  constexpr inline unique_ptr<value_type>& operator=( const unique_ptr<value_type>& ptr ) noexcept = delete;
+  constexpr inline unique_ptr& operator=( const unique_ptr& ptr ) noexcept = delete;
 
   /***/
   template<Derived<value_type> T>
-  constexpr inline unique_ptr<value_type>& operator=( T* ptr ) noexcept
+  constexpr inline unique_ptr& operator=( T* ptr ) noexcept
   { 
     mem_address::set_flag( _ptr, mem_address::address_flags::DESTROY);
     _ptr.set_address( ptr );
@@ -113,7 +132,8 @@ public:
 
   /***/
   template<Derived<value_type> T>
-  constexpr inline unique_ptr<value_type>& operator=( std::unique_ptr<T>&& ptr ) noexcept
+    requires std::is_same_v<deleter_t,default_delete>
+  constexpr inline unique_ptr& operator=( std::unique_ptr<T>&& ptr ) noexcept
   { 
     mem_address::set_flag( _ptr, mem_address::address_flags::DESTROY);
     _ptr.set_address( ptr.release() );
@@ -122,7 +142,7 @@ public:
 
   /***/
   template<Derived<value_type> T>
-  constexpr inline unique_ptr<value_type>& operator=( unique_ptr<T>&& ptr ) noexcept
+  constexpr inline unique_ptr& operator=( unique_ptr<T,deleter_type>&& ptr ) noexcept
   { 
     (ptr.auto_delete())?mem_address::set_flag( _ptr, mem_address::address_flags::DESTROY):mem_address::unset_flag( _ptr, mem_address::address_flags::DESTROY);
     _ptr.set_address( ptr.release() );
@@ -168,20 +188,20 @@ private:
   mem_address  _ptr;
 };
 
-template<typename data_t>
-bool operator==( const unique_ptr<data_t>& lhs, const unique_ptr<data_t>& rhs)
+template<typename data_t, typename deleter_t>
+bool operator==( const unique_ptr<data_t,deleter_t>& lhs, const unique_ptr<data_t,deleter_t>& rhs)
 { return (lhs.get() == rhs.get()); }
 
-template<typename data_t>
-bool operator==(const unique_ptr<data_t>& lhs, std::nullptr_t ) noexcept
+template<typename data_t, typename deleter_t>
+bool operator==(const unique_ptr<data_t,deleter_t>& lhs, std::nullptr_t ) noexcept
 { return !(bool)lhs; }
 
-template<typename data_t>
-bool operator!=( const unique_ptr<data_t>& lhs, const unique_ptr<data_t>& rhs)
+template<typename data_t, typename deleter_t>
+bool operator!=( const unique_ptr<data_t,deleter_t>& lhs, const unique_ptr<data_t,deleter_t>& rhs)
 { return (lhs.get() != rhs.get()); }
 
-template<typename data_t>
-bool operator!=(const unique_ptr<data_t>& lhs, std::nullptr_t ) noexcept
+template<typename data_t, typename deleter_t>
+bool operator!=(const unique_ptr<data_t,deleter_t>& lhs, std::nullptr_t ) noexcept
 { return (bool)lhs; }
 
 }
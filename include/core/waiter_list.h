@@ -0,0 +1,262 @@
+/**************************************************************************************************
+ * 
+ * Copyright 2022 https://github.com/fe-dagostino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this 
+ * software and associated documentation files (the "Software"), to deal in the Software 
+ * without restriction, including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to the following 
+ * conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies 
+ * or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *************************************************************************************************/
+
+#ifndef CORE_WAITER_LIST_H
+#define CORE_WAITER_LIST_H
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+
+#include "config.h"
+#include "core/mutex.h"
+#include "core/types.h"
+
+namespace core {
+
+/**
+ * @brief Define concept for schedulers that can take over the resumption of a coroutine.
+ */
+template <typename S>
+concept coroutine_scheduler = requires( S& s, std::coroutine_handle<> h ) 
+{
+  { s.schedule( h ) };
+};
+
+/**
+ * @brief FIFO list of suspended coroutines waiting for a condition, the counterpart of 
+ *        core::event for coroutines.
+ *        Each waiter lives in the awaiter, so in the frame of the suspended coroutine, and no 
+ *        memory is allocated. Notifiers resume one waiter for each unit of condition they make 
+ *        available (one item written, one room released), so with N suspended coroutines a 
+ *        notification costs a single resumption instead of N; notify_all() is meant for shutdown.
+ *        Nodes are linked and unlinked under a core::mutex, held only for a few pointer 
+ *        updates and never while a coroutine is resumed.
+ *        Resumed coroutines are expected to check the condition again, exactly as threads 
+ *        woken up by a condition variable.
+ */
+class waiter_list final
+{
+public:
+  /**
+   * @brief A suspended coroutine, resumed inline by the notifying thread or handed to a scheduler.
+   */
+  class waiter final
+  {
+  public:
+    using schedule_fn = void (*)( void* scheduler, std::coroutine_handle<> handle );
+
+    /***/
+    constexpr inline waiter() noexcept
+      : _handle(), _schedule(nullptr), _scheduler(nullptr), _prev(nullptr), _next(nullptr), _ticket(0)
+    {}
+
+    /**
+     * @brief Set @param handle to be resumed inline by the notifying thread.
+     */
+    constexpr inline void set( std::coroutine_handle<> handle ) noexcept
+    { 
+      _handle    = handle; 
+      _schedule  = nullptr;
+      _scheduler = nullptr;
+    }
+
+    /**
+     * @brief Set @param handle to be resumed through @param scheduler.schedule().
+     */
+    template<coroutine_scheduler scheduler_t>
+    constexpr inline void set( std::coroutine_handle<> handle, scheduler_t& scheduler ) noexcept
+    {
+      _handle    = handle;
+      _schedule  = []( void* sched, std::coroutine_handle<> hnd ) { static_cast<scheduler_t*>(sched)->schedule( hnd ); };
+      _scheduler = &scheduler;
+    }
+
+  private:
+    friend class waiter_list;
+
+    /***/
+    inline void resume() noexcept
+    {
+      if ( _schedule == nullptr )
+        _handle.resume();
+      else
+        _schedule( _scheduler, _handle );
+    }
+
+    std::coroutine_handle<>   _handle;
+    schedule_fn               _schedule;
+    void*                     _scheduler;
+    waiter*                   _prev;
+    waiter*                   _next;
+    uint64_t                  _ticket;
+  };
+
+  /***/
+  constexpr inline waiter_list() noexcept
+    : _head(nullptr), _tail(nullptr), _tickets(0)
+  {}
+
+  waiter_list( const waiter_list& ) = delete;
+  waiter_list& operator=( const waiter_list& ) = delete;
+
+  /**
+   * @brief Query if there are suspended coroutines.
+   */
+  inline bool         empty() const noexcept
+  { return ( _head.load( std::memory_order_relaxed ) == nullptr ); }
+
+  /**
+   * @brief To be called from await_suspend(), register @param w and then evaluate @param pred; 
+   *        if the condition is already satisfied @param w is unregistered, unless a notifier 
+   *        has already taken it. Once @param w is registered the coroutine can be resumed by 
+   *        another thread, so @param pred must not access the awaiter.
+   * 
+   * @return the value to be returned by await_suspend(), false when the calling coroutine 
+   *         must not be suspended.
+   */
+  template<typename predicate_t>
+  inline bool         suspend( waiter& w, predicate_t&& pred ) noexcept
+  {
+    _mtx.lock();
+    const uint64_t ticket = _tickets++;
+    w._ticket = ticket;
+    w._prev   = _tail;
+    w._next   = nullptr;
+    if ( _tail == nullptr )
+      _head.store( &w, std::memory_order_relaxed );
+    else
+      _tail->_next = &w;
+    _tail = &w;
+    _mtx.unlock();
+
+    // pairs with the fence in notify(): either pred() sees the new condition or 
+    // the notifying thread sees w.
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if ( pred() == false )
+      return true;
+
+    // nodes are only taken from the head and only the owner unlinks its own node, so w is 
+    // still registered as long as the head is not younger than w; w is not accessed 
+    // otherwise, since it may already be resumed and destroyed.
+    _mtx.lock();
+    const waiter* head = _head.load( std::memory_order_relaxed );
+    const bool    mine = ( head != nullptr ) && ( head->_ticket <= ticket );
+    if ( mine )
+      unlink( &w );
+    _mtx.unlock();
+
+    return ( mine == false );
+  }
+
+  /**
+   * @brief Resume up to @param count suspended coroutines, in the order they have been 
+   *        suspended. Changes to the condition checked by waiters must be completed before 
+   *        calling this method.
+   * 
+   * @return true if some coroutine has been resumed or scheduled.
+   */
+  inline bool         notify( uint32_t count = 1 ) noexcept
+  {
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if ( _head.load( std::memory_order_relaxed ) == nullptr ) [[likely]]
+      return false;
+
+    bool resumed = false;
+    for ( ; count > 0; --count )
+    {
+      waiter* w = take();
+      if ( w == nullptr )
+        break;
+
+      w->resume();
+      resumed = true;
+    }
+
+    return resumed;
+  }
+
+  /**
+   * @brief Resume all suspended coroutines, as required before destroying the object that 
+   *        owns the list. Changes to the condition checked by waiters must be completed before 
+   *        calling this method.
+   * 
+   * @return true if some coroutine has been resumed or scheduled.
+   */
+  inline bool         notify_all() noexcept
+  {
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if ( _head.load( std::memory_order_relaxed ) == nullptr ) [[likely]]
+      return false;
+
+    bool resumed = false;
+    for ( waiter* w = take(); w != nullptr; w = take() )
+    {
+      w->resume();
+      resumed = true;
+    }
+
+    return resumed;
+  }
+
+private:
+  /**
+   * @brief Unlink the oldest waiter, to be resumed by the caller once the lock is released.
+   */
+  inline waiter*      take() noexcept
+  {
+    _mtx.lock();
+    waiter* w = _head.load( std::memory_order_relaxed );
+    if ( w != nullptr )
+      unlink( w );
+    _mtx.unlock();
+
+    return w;
+  }
+
+  /**
+   * @brief Unlink @param w, to be called with _mtx held.
+   */
+  inline void         unlink( waiter* w ) noexcept
+  {
+    if ( w->_prev == nullptr )
+      _head.store( w->_next, std::memory_order_relaxed );
+    else
+      w->_prev->_next = w->_next;
+
+    if ( w->_next == nullptr )
+      _tail = w->_prev;
+    else
+      w->_next->_prev = w->_prev;
+  }
+
+private:
+  core::mutex           _mtx;
+  std::atomic<waiter*>  _head;
+  waiter*               _tail;
+  uint64_t              _tickets;
+};
+
+}
+
+#endif // CORE_WAITER_LIST_H
@@ -0,0 +1,446 @@
+/**************************************************************************************************
+ * 
+ * Copyright 2022 https://github.com/fe-dagostino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this 
+ * software and associated documentation files (the "Software"), to deal in the Software 
+ * without restriction, including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to the following 
+ * conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies 
+ * or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *************************************************************************************************/
+#ifndef LOCK_FREE_HASH_MAP_H
+#define LOCK_FREE_HASH_MAP_H
+
+#include <atomic>
+#include <bit>
+#include <functional>
+#include <memory>
+#include <new>
+#include <assert.h>
+#include <cstddef>
+
+#include "config.h"
+#include "arena_allocator.h"
+#include "core/arena_allocator.h"
+#include "core/memory_address.h"
+#include "core/types.h"
+#include "core/reclamation.h"
+#include "core/counter.h"
+
+namespace lock_free {
+
+/**
+ * @brief Node used by lock_free::hash_map, it is externalized in order to be used as 
+ *        data_t for the arena_allocator specified as default template parameter.
+ *        Alignment guarantee the size constraints required by arena allocators.
+ */
+template<typename key_t, typename value_t, typename data_size_t>
+struct alignas(std::max_align_t) hash_node_t
+{
+  using pointer        = hash_node_t<key_t,value_t,data_size_t>*;
+  using tagged_pointer = core::memory_address<hash_node_t<key_t,value_t,data_size_t>,data_size_t>;
+
+  /***/
+  template<typename... Args>
+  constexpr inline hash_node_t( std::size_t hash, const key_t& key, Args&&... args ) noexcept
+    : _next(), _hash(hash), _key(key), _value( std::forward<Args>(args)... )
+  {}
+
+  std::atomic<tagged_pointer>  _next;
+  const std::size_t            _hash;
+  const key_t                  _key;
+  const value_t                _value;
+};
+
+/***
+ * @brief A lock-free hash map with a fixed number of buckets.
+ *        Each bucket is a lock-free linked list, ordered by hash value, where a node is first 
+ *        logically removed marking its link to the next node and then unlinked from the list,
+ *        by the same thread or by any other thread traversing the list for insert() or erase().
+ *        Links carry a generation tag incremented by each CAS, that protect them from ABA issues.
+ *        Lookups with find() and contains() don't write shared memory, so the read path scales
+ *        with the number of readers.
+ *        Nodes are taken from arena_t, then capacity is bounded only by size_limit while the 
+ *        number of buckets is fixed, so lookups cost remain predictable as long as the number of 
+ *        items is in the order of bucket_count.
+ *        Values are immutable once inserted, to update a value it should be erased and inserted 
+ *        again, or value_t should be an atomic or a pointer.
+ * 
+ * @tparam key_t         key type, it must be copy constructible.
+ * @tparam value_t       data type associated to each key. 
+ * @tparam data_size_t   data type to be used internally for counting and sizing. 
+ *                       This is required to be 32 bits or 64 bits in order to keep performances.
+ * @tparam bucket_count  number of buckets, it must be a power of 2.
+ * @tparam chunk_size    number of nodes to pre-alloc each time that is needed.
+ * @tparam reserve_size  nodes reserved when the object is created.
+ * @tparam size_limit    default value is 0 that means the map can grow until there is available memory.
+ *                       A value greater than 0 limit the max number of items in the map.
+ * @tparam hash_t        hash function, std::hash<key_t> (default).
+ * @tparam key_equal_t   function used to compare keys, std::equal_to<key_t> (default).
+ * @tparam arena_t       lock_free::arena_allocator (default), core::arena_allocator or user defined arena allocator.
+ * @tparam reclaimer_t   core::epoch_reclaimer (default) defers the release of erased nodes until no thread 
+ *                       can reference them. core::no_reclaimer return erased nodes to the arena immediately, 
+ *                       that is safe only when erase() is never concurrent with other operations. 
+ * @tparam counter_policy core::counter_t::exact (default) a single counter is updated by each insert() and erase(),
+ *                       core::counter_t::striped each thread updates its own stripe and size() is approximate.
+*/
+template<typename key_t, typename value_t, typename data_size_t, data_size_t bucket_count = 1024,
+         data_size_t chunk_size = 1024, data_size_t reserve_size = chunk_size, data_size_t size_limit = 0,
+         typename hash_t      = std::hash<key_t>,
+         typename key_equal_t = std::equal_to<key_t>,
+         typename arena_t     = lock_free::arena_allocator<hash_node_t<key_t,value_t,data_size_t>, data_size_t, chunk_size, reserve_size, size_limit, (chunk_size / 3), core::default_allocator<data_size_t>>,
+         typename reclaimer_t = core::epoch_reclaimer<>,
+         core::counter_t counter_policy = core::counter_t::exact >
+requires std::is_unsigned_v<data_size_t> && (std::is_same_v<data_size_t,uint32_t> || std::is_same_v<data_size_t,uint64_t>)
+         && std::is_copy_constructible_v<key_t>
+         && (std::has_single_bit(bucket_count)) && (chunk_size >= 1)
+class hash_map
+{
+public:
+  using key_type        = key_t;
+  using value_type      = value_t;
+  using size_type       = data_size_t;
+  using hasher          = hash_t;
+  using key_equal       = key_equal_t;
+  using node_type       = hash_node_t<key_type,value_type,size_type>;
+  using tagged_pointer  = typename node_type::tagged_pointer;
+  using link_type       = std::atomic<tagged_pointer>;
+  using arena_type      = arena_t;
+  using reclaimer_type  = reclaimer_t;
+  using counter_type    = core::counter<size_type,counter_policy>;
+
+public:
+
+  /***/
+  inline hash_map() noexcept
+    : _buckets( new(std::nothrow) link_type[bucket_count] ), _size()
+  {
+    static_assert(link_type::is_always_lock_free);
+    assert( _buckets != nullptr );
+
+    for ( size_type ndx = 0; ndx < bucket_count; ++ndx )
+      _buckets[ndx].store( tagged_pointer(), std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+  }
+
+  /***/
+  inline ~hash_map() noexcept
+  {
+    clear();
+  }
+
+  hash_map( const hash_map& ) = delete;
+  hash_map& operator=( const hash_map& ) = delete;
+
+  /**
+   * @brief Number of buckets, fixed at compile time.
+   */
+  static constexpr inline size_type bucket_size() noexcept
+  { return bucket_count; }
+
+  /**
+   * @brief Query how many items are present in the map, approximate with core::counter_t::striped.
+   */
+  constexpr inline size_type       size()  const noexcept
+  { return _size.size(); }
+
+  /**
+   * @brief Query how many items are present in the map, including all insert() and erase() 
+   *        completed before the call; exact with core::counter_t::striped only when no insert() 
+   *        or erase() is in progress.
+   */
+  constexpr inline size_type       quiescent_size()  const noexcept
+  { return _size.quiescent_size(); }
+
+  /**
+   * @brief Query if there are items in the map.
+   * 
+   * @return true    if there are no items, false otherwise.
+   */
+  constexpr inline bool            empty() const noexcept
+  { return (size()==0); }
+
+  /**
+   * @brief Insert @param key if not already present, with a value constructed from @param args.
+   * 
+   * @return core::result_t::eSuccess        if the item has been inserted.
+   *         core::result_t::eAlreadyExists  if @param key is already present in the map.
+   *         core::result_t::eFailure        if it was not possible to allocate a new node.
+   */
+  template<typename... Args>
+  constexpr inline core::result_t  insert( const key_type& key, Args&&... args ) noexcept
+  {
+    typename reclaimer_type::guard guard( _reclaimer );
+
+    const std::size_t hash     = hasher{}( key );
+    link_type*        prev     = nullptr;
+    tagged_pointer    curr;
+    node_type*        new_node = nullptr;
+
+    for (;;)
+    {
+      if ( search( hash, key, prev, curr ) == true )
+      {
+        // new_node has never been published so it can be released immediately.
+        if ( new_node != nullptr )
+          (void)destroy_node( new_node );
+        return core::result_t::eAlreadyExists;
+      }
+
+      if ( new_node == nullptr )
+      {
+        new_node = create_node( hash, key, std::forward<Args>(args)... );
+        if ( new_node == nullptr )
+          return core::result_t::eFailure;
+      }
+
+      new_node->_next.store( tagged_pointer( curr.get_address() ), std::memory_order_relaxed );
+
+      if ( prev->compare_exchange_strong( curr, next_link( new_node, curr, false ), std::memory_order_acq_rel, std::memory_order_relaxed ) == true )
+        break;
+    }
+
+    _size.add();
+
+    return core::result_t::eSuccess;
+  }
+
+  /**
+   * @brief Remove @param key from the map.
+   * 
+   * @return core::result_t::eSuccess   if the item has been removed.
+   *         core::result_t::eNotFound  if @param key is not present in the map.
+   */
+  constexpr inline core::result_t  erase( const key_type& key ) noexcept
+  {
+    typename reclaimer_type::guard guard( _reclaimer );
+
+    const std::size_t hash = hasher{}( key );
+    link_type*        prev = nullptr;
+    tagged_pointer    curr;
+
+    for (;;)
+    {
+      if ( search( hash, key, prev, curr ) == false )
+        return core::result_t::eNotFound;
+
+      // logical removal, only one thread can mark the link.
+      tagged_pointer next = curr->_next.load( std::memory_order_acquire );
+      if ( is_marked( next ) )
+        continue;
+
+      if ( curr->_next.compare_exchange_strong( next, next_link( next.get_address(), next, true ), std::memory_order_acq_rel, std::memory_order_relaxed ) == false )
+        continue;
+
+      _size.sub();
+
+      // physical removal, on failure search() will unlink the node on our behalf.
+      if ( prev->compare_exchange_strong( curr, next_link( next.get_address(), curr, false ), std::memory_order_acq_rel, std::memory_order_relaxed ) == true )
+        retire_node( curr.get_address() );
+      else
+        search( hash, key, prev, curr );
+
+      return core::result_t::eSuccess;
+    }
+  }
+
+  /**
+   * @brief Lookup for @param key and copy the associated value in @param value.
+   * 
+   * @param value                      output parameter updated only in case of success.
+   * @return core::result_t::eSuccess   if @param key has been found. 
+   *         core::result_t::eNotFound  otherwise.
+   */
+  constexpr inline core::result_t  find( const key_type& key, value_type& value ) const noexcept
+  {
+    typename reclaimer_type::guard guard( _reclaimer );
+
+    const node_type* node = lookup( hasher{}( key ), key );
+    if ( node == nullptr )
+      return core::result_t::eNotFound;
+
+    value = node->_value;
+
+    return core::result_t::eSuccess;
+  }
+
+  /**
+   * @brief Query if @param key is present in the map.
+   */
+  constexpr inline bool            contains( const key_type& key ) const noexcept
+  {
+    typename reclaimer_type::guard guard( _reclaimer );
+
+    return ( lookup( hasher{}( key ), key ) != nullptr );
+  }
+
+  /**
+   * @brief Remove all items from the map releasing the memory.
+   *        Note: this method is not thread safe.
+   */
+  constexpr inline void            clear() noexcept
+  {
+    for ( size_type ndx = 0; ndx < bucket_count; ++ndx )
+      _buckets[ndx].store( tagged_pointer(), std::memory_order_relaxed );
+
+    _size.reset();
+
+    // nodes waiting for reclamation belong to the arena.
+    _reclaimer.drain();
+    _arena.clear();
+  }
+
+private:
+  /***/
+  static constexpr inline bool            is_marked( const tagged_pointer& link ) noexcept
+  { return tagged_pointer::test_flag( link, tagged_pointer::address_flags::DESTROY ); }
+
+  /***/
+  static constexpr inline bool            same_link( const tagged_pointer& lhs, const tagged_pointer& rhs ) noexcept
+  {
+    return ( lhs.get_address() == rhs.get_address() ) && 
+           ( tagged_pointer::flags( lhs ) == tagged_pointer::flags( rhs ) ) && 
+           ( tagged_pointer::get_counter( lhs ) == tagged_pointer::get_counter( rhs ) );
+  }
+
+  /**
+   * @brief Build the value to store in a link currently holding @param prev, pointing to @param ptr 
+   *        and with the generation tag of @param prev incremented by one.
+   *        tagged_pointer::next_tag() is not used since it changes also flags on wrap around.
+   */
+  static constexpr inline tagged_pointer  next_link( node_type* ptr, const tagged_pointer& prev, bool marked ) noexcept
+  {
+    constexpr const typename tagged_pointer::base_t counter_mask = (typename tagged_pointer::base_t(1) << tagged_pointer::counter_bits) - 1;
+
+    return tagged_pointer( ptr, marked?static_cast<typename tagged_pointer::base_t>(tagged_pointer::address_flags::DESTROY):0, 
+                                (tagged_pointer::get_counter( prev ) + 1) & counter_mask );
+  }
+
+  /***/
+  constexpr inline link_type&             bucket( std::size_t hash ) const noexcept
+  { return _buckets[ hash & (bucket_count - 1) ]; }
+
+  /**
+   * @brief Find the position for @param key in its bucket, unlinking marked nodes along the way.
+   *        Keys with the same hash are kept in insertion order, so new keys are always linked 
+   *        after the last node with the same hash.
+   *        Note: it must be called holding a guard.
+   * 
+   * @param prev  updated with the link pointing to @param curr.
+   * @param curr  updated with the node holding @param key, or the node that should follow it.
+   * @return true if @param key has been found, false otherwise.
+   */
+  constexpr inline bool                   search( std::size_t hash, const key_type& key, link_type*& prev, tagged_pointer& curr ) noexcept
+  {
+    for (;;)
+    {
+      prev = &bucket( hash );
+      curr = prev->load( std::memory_order_acquire );
+
+      for (;;)
+      {
+        node_type* node = curr.get_address();
+        if ( node == nullptr )
+          return false;
+
+        tagged_pointer next = node->_next.load( std::memory_order_acquire );
+
+        // prev has been marked or updated by a different thread, restart from the bucket.
+        if ( same_link( prev->load( std::memory_order_acquire ), curr ) == false )
+          break;
+
+        if ( is_marked( next ) == false )
+        {
+          if ( node->_hash > hash )
+            return false;
+
+          if ( ( node->_hash == hash ) && key_equal{}( node->_key, key ) )
+            return true;
+
+          prev = &node->_next;
+          curr = next;
+        }
+        else
+        {
+          const tagged_pointer succ = next_link( next.get_address(), curr, false );
+          if ( prev->compare_exchange_strong( curr, succ, std::memory_order_acq_rel, std::memory_order_relaxed ) == false )
+            break;
+
+          retire_node( node );
+
+          curr = succ;
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Find the node holding @param key skipping marked nodes, without writing shared memory.
+   *        Note: it must be called holding a guard.
+   */
+  constexpr inline const node_type*       lookup( std::size_t hash, const key_type& key ) const noexcept
+  {
+    const node_type* node = bucket( hash ).load( std::memory_order_acquire ).get_address();
+
+    while ( node != nullptr )
+    {
+      if ( node->_hash > hash )
+        return nullptr;
+
+      const tagged_pointer next = node->_next.load( std::memory_order_acquire );
+
+      if ( ( node->_hash == hash ) && ( is_marked( next ) == false ) && key_equal{}( node->_key, key ) )
+        return node;
+
+      node = next.get_address();
+    }
+
+    return nullptr;
+  }
+
+  /***/
+  template<typename... Args>
+  constexpr inline node_type*             create_node( std::size_t hash, const key_type& key, Args&&... args ) noexcept
+  { return _arena.allocate( hash, key, std::forward<Args>(args)... ); }
+
+  /***/
+  constexpr inline core::result_t         destroy_node( node_type* node ) noexcept
+  { return _arena.deallocate(node); }
+
+  /**
+   * @brief Release a node unlinked from a bucket, through reclaimer_t.
+   */
+  constexpr inline void                   retire_node( node_type* node ) noexcept
+  {
+    if constexpr ( reclaimer_type::deferred == false )
+    { (void)destroy_node( node ); }
+    else
+    { _reclaimer.retire( node, &hash_map::reclaim_node, this ); }
+  }
+
+  /***/
+  static inline void                      reclaim_node( void* ctx, void* node ) noexcept
+  { (void)static_cast<hash_map*>(ctx)->destroy_node( static_cast<node_type*>(node) ); }
+
+private:
+  arena_type                    _arena;
+  mutable reclaimer_type        _reclaimer;
+  std::unique_ptr<link_type[]>  _buckets;
+  counter_type                  _size;
+};
+
+}
+
+#endif // LOCK_FREE_HASH_MAP_H
@@ -24,9 +24,12 @@
 #ifndef CORE_MAILBOX_H
 #define CORE_MAILBOX_H
 
+#include <coroutine>
+
 #include "config.h"
 #include "queue.h"
 #include "core/event.h"
+#include "core/waiter_list.h"
 
 namespace lock_free {
 
@@ -37,14 +40,131 @@ namespace lock_free {
  *        leverage lock_free::queue and core::event to create a mailbox where producer relies 
  *        on queue implementation (lockfree, mutex ..) instead the consumer/s rely on condition 
  *        variable and wake up periodically or when a signal occurs.
+ *        With core::ds_impl_t::mpsc writers never contend on a CAS, and only one thread 
+ *        can read from the mailbox.
+ *        Coroutines can co_await async_read() and async_write() instead, in such case they 
+ *        are suspended in a core::waiter_list and resumed by writers and readers respectively, 
+ *        either inline or through a core::coroutine_scheduler. Each item written resumes one 
+ *        reader and each item read resumes one writer. Suspended coroutines must be resumed, 
+ *        see resume_all(), before the mailbox is destroyed.
  */
 template<typename data_t, core::ds_impl_t imp_type, uint32_t size_limit = 0,
-         typename arena_t = lock_free::arena_allocator<core::node_t<data_t,false,true,(imp_type==core::ds_impl_t::lockfree)>, uint32_t, 1024/*chunk_size*/, 1024/*reserve_size*/, size_limit, (1024/*chunk_size*/ / 3), core::default_allocator<uint32_t>> >
+         typename arena_t = lock_free::arena_allocator<core::node_t<data_t,false,true,core::ds_is_lockfree<imp_type>>, uint32_t, 1024/*chunk_size*/, 1024/*reserve_size*/, size_limit, (1024/*chunk_size*/ / 3), core::default_allocator<uint32_t>> >
 class mailbox : protected lock_free::queue< data_t, uint32_t, imp_type, 1024/*chunk_size*/, 1024 /*reserve_size*/, size_limit, arena_t >
 {
 public:
   using queue_type = lock_free::queue< data_t, uint32_t, imp_type, 1024, 1024, size_limit, arena_t >;
   using value_type = data_t;
+
+  /**
+   * @brief Awaitable returned by async_read(), with @tparam scheduler_t void the coroutine 
+   *        is resumed inline by the writer.
+   */
+  template<typename scheduler_t>
+  class read_awaiter final
+  {
+  public:
+    /***/
+    constexpr inline read_awaiter( mailbox& mbx, value_type& data, scheduler_t* scheduler ) noexcept
+      : _mbx(mbx), _data(data), _scheduler(scheduler), _result(core::result_t::eEmpty), _waiter()
+    {}
+
+    /**
+     * @brief The coroutine is not suspended if an item can be read immediately.
+     */
+    inline bool           await_ready() noexcept
+    {
+      _result = _mbx.pop_item( _data );
+      return ( _result != core::result_t::eEmpty );
+    }
+
+    /***/
+    inline bool           await_suspend( std::coroutine_handle<> handle ) noexcept
+    {
+      if constexpr ( std::is_void_v<scheduler_t> )
+        _waiter.set( handle );
+      else
+        _waiter.set( handle, *_scheduler );
+
+      mailbox* mbx = &_mbx;
+      return mbx->_readers.suspend( _waiter, [mbx]() noexcept { return !mbx->empty(); } );
+    }
+
+    /**
+     * @return core::result_t::eSuccess  if @param data have been populated.
+     *         core::result_t::eEmpty    if the item that resumed the coroutine was taken by a different reader.
+     */
+    inline core::result_t await_resume() noexcept
+    {
+      if ( _result == core::result_t::eEmpty )
+        _result = _mbx.pop_item( _data );
+
+      return _result;
+    }
+
+  private:
+    mailbox&                    _mbx;
+    value_type&                 _data;
+    scheduler_t*                _scheduler;
+    core::result_t              _result;
+    core::waiter_list::waiter   _waiter;
+  };
+
+  /**
+   * @brief Awaitable returned by async_write(), with @tparam scheduler_t void the coroutine 
+   *        is resumed inline by the reader.
+   */
+  template<typename scheduler_t>
+  class write_awaiter final
+  {
+  public:
+    /***/
+    constexpr inline write_awaiter( mailbox& mbx, value_type& data, scheduler_t* scheduler ) noexcept
+      : _mbx(mbx), _data(data), _scheduler(scheduler), _result(core::result_t::eFailure), _waiter()
+    {}
+
+    /**
+     * @brief The coroutine is not suspended if the item can be written immediately.
+     */
+    inline bool           await_ready() noexcept
+    {
+      _result = _mbx.push_item( std::move(_data) );
+      return ( _result != core::result_t::eFailure );
+    }
+
+    /***/
+    inline bool           await_suspend( std::coroutine_handle<> handle ) noexcept
+    {
+      if constexpr ( std::is_void_v<scheduler_t> )
+        _waiter.set( handle );
+      else
+        _waiter.set( handle, *_scheduler );
+
+      // without size_limit a failure is due to memory, so there is nothing to wait for.
+      mailbox* mbx = &_mbx;
+      return mbx->_writers.suspend( _waiter, [mbx]() noexcept { return ( size_limit == 0 ) || ( mbx->size() < size_limit ); } );
+    }
+
+    /**
+     * @return core::result_t::eSuccess  if the item have been written.
+     *         core::result_t::eFailure  if the room that resumed the coroutine was taken by a different 
+     *                                   writer, or if memory is not available; the item is left untouched.
+     */
+    inline core::result_t await_resume() noexcept
+    {
+      if ( _result == core::result_t::eFailure )
+        _result = _mbx.push_item( std::move(_data) );
+
+      return _result;
+    }
+
+  private:
+    mailbox&                    _mbx;
+    value_type&                 _data;
+    scheduler_t*                _scheduler;
+    core::result_t              _result;
+    core::waiter_list::waiter   _waiter;
+  };
   
   /***/
   constexpr inline mailbox( const std::string& name ) noexcept
@@ -60,32 +180,156 @@ public:
   constexpr inline const std::string&  name() const
   { return _name; }
 
-  /***/
+  /**
+   * @brief Read one item, waiting up to @param timeout milliseconds if the mailbox is empty.
+   * 
+   * @param data     output parameter updated only in case of success.
+   * @param timeout  max number of milliseconds to wait.
+   * @return core::result_t::eSuccess  if @param data have been populated.
+   *         core::result_t::eTimeout  if nothing has been written within @param timeout.
+   *         core::result_t::eEmpty    if the item that woke up the reader was taken by a different reader.
+   */
   constexpr inline core::result_t      read( value_type& data, uint32_t timeout )
   {
-    if ( empty() == true )
-    {
-      if ( _event.wait( timeout ) == core::result_t::eTimeout )
-        return core::result_t::eTimeout;
-    }
+    core::result_t result = pop_item( data );
+    if ( result != core::result_t::eEmpty )
+      return result;
 
-    return queue_type::pop( data );
+    if ( _event.wait( timeout, [this]() { return !empty(); } ) == core::result_t::eTimeout )
+      return core::result_t::eTimeout;
+
+    return pop_item( data );
   }
 
-  /***/
+  /**
+   * @brief Read one item, suspending the calling coroutine while the mailbox is empty.
+   *        The coroutine is resumed inline by the thread writing the next item.
+   * 
+   *        co_await returns the same values of read(), but core::result_t::eTimeout.
+   */
+  inline read_awaiter<void>            async_read( value_type& data ) noexcept
+  { return read_awaiter<void>( *this, data, nullptr ); }
+
+  /**
+   * @brief Same as async_read( @param data ), but the coroutine is resumed through @param scheduler.
+   */
+  template<core::coroutine_scheduler scheduler_t>
+  inline read_awaiter<scheduler_t>     async_read( value_type& data, scheduler_t& scheduler ) noexcept
+  { return read_awaiter<scheduler_t>( *this, data, &scheduler ); }
+
+  /**
+   * @brief Read up to @param max items, waiting up to @param timeout milliseconds if the mailbox is empty.
+   *        All available items, within @param max, are extracted with a single wakeup.
+   * 
+   *        Note: arena_t must provide allocate_n() and deallocate_n().
+   * 
+   * @param out      output iterator where items will be moved.
+   * @param max      max number of items to read.
+   * @param timeout  max number of milliseconds to wait.
+   * @return number of items read, 0 if nothing has been written within @param timeout.
+   */
+  template<typename output_iterator_t>
+  constexpr inline uint32_t            read_bulk( output_iterator_t out, uint32_t max, uint32_t timeout )
+  {
+    uint32_t count = pop_items( out, max );
+    if ( ( count > 0 ) || ( max == 0 ) )
+      return count;
+
+    if ( _event.wait( timeout, [this]() { return !empty(); } ) == core::result_t::eTimeout )
+      return 0;
+
+    return pop_items( out, max );
+  }
+
+  /**
+   * @brief Write @param data in the mailbox, readers are notified only if some of them is waiting.
+   */
   template<typename value_type>
   constexpr inline core::result_t      write( value_type&& data ) noexcept
+  { return push_item( std::move(data) ); }
+
+  /**
+   * @brief Write @param data in the mailbox, suspending the calling coroutine while the mailbox 
+   *        holds size_limit items. The coroutine is resumed inline by the thread reading the next item.
+   *        @param data must stay valid until co_await returns, and it is left untouched on failure.
+   * 
+   *        co_await returns the same values of write().
+   */
+  inline write_awaiter<void>           async_write( value_type&& data ) noexcept
+  { return write_awaiter<void>( *this, data, nullptr ); }
+
+  /**
+   * @brief Same as async_write( @param data ), but the coroutine is resumed through @param scheduler.
+   */
+  template<core::coroutine_scheduler scheduler_t>
+  inline write_awaiter<scheduler_t>    async_write( value_type&& data, scheduler_t& scheduler ) noexcept
+  { return write_awaiter<scheduler_t>( *this, data, &scheduler ); }
+
+  /**
+   * @brief Resume all suspended coroutines, to be called on shutdown before the mailbox is destroyed.
+   *        Resumed readers get core::result_t::eEmpty and resumed writers core::result_t::eFailure 
+   *        unless an item, or room for it, is available.
+   */
+  inline void                          resume_all() noexcept
+  {
+    _readers.notify_all();
+    _writers.notify_all();
+  }
+
+private:
+  /**
+   * @brief Push @param data, notify waiting threads and resume one suspended reader.
+   */
+  template<typename value_type>
+  constexpr inline core::result_t      push_item( value_type&& data ) noexcept
   {
     core::result_t result = queue_type::push( std::move(data) );
     if ( result == core::result_t::eSuccess )
-    { _event.notify(); }
+    { 
+      _event.notify_if_waiting(); 
+      _readers.notify();
+    }
 
     return result;
   }
 
+  /**
+   * @brief Pop one item; with size_limit > 0 one coroutine waiting for room is resumed.
+   */
+  constexpr inline core::result_t      pop_item( value_type& data ) noexcept
+  {
+    core::result_t result = queue_type::pop( data );
+    if constexpr ( size_limit > 0 )
+    {
+      if ( result == core::result_t::eSuccess )
+      { _writers.notify(); }
+    }
+
+    return result;
+  }
+
+  /**
+   * @brief Pop up to @param max items; with size_limit > 0 one coroutine waiting for room is 
+   *        resumed for each item.
+   */
+  template<typename output_iterator_t>
+  constexpr inline uint32_t            pop_items( output_iterator_t& out, uint32_t max ) noexcept
+  {
+    uint32_t count = queue_type::pop_bulk( out, max );
+    if constexpr ( size_limit > 0 )
+    {
+      if ( count > 0 )
+      { _writers.notify( count ); }
+    }
+
+    return count;
+  }
+
 private:
   const std::string   _name;
   core::event         _event;
+  core::waiter_list   _readers;
+  core::waiter_list   _writers;
 };
 
 }
@@ -32,7 +32,6 @@
 #include "config.h"
 #include "queue.h"
 #include "core/arena_allocator.h"
-#include "core/thread_map.h"
 
 namespace lock_free {
 
@@ -56,6 +55,11 @@ namespace lock_free {
  * max_size      default value is 0 that means the queue can grow until there is available memory.
  *               A value different greater than 0 will have the effect to limit max number of items on 
  *               the single queue.
+ * 
+ * Each producer thread is bound to a queue (shard) once, the first time it push without specifying 
+ * the queue-id, and the binding is cached in a thread_local variable. Consumers that pop without 
+ * specifying the queue-id steal from the other queues when the selected one is empty, so FIFO order
+ * is preserved only within each queue.
 */
 template<typename data_t, typename data_size_t, data_size_t queues, 
          data_size_t chunk_size = 1024, data_size_t reserve_size = chunk_size, data_size_t max_size = 0,
@@ -80,7 +84,6 @@ public:
    * @brief Default Constructor.
    */
   constexpr inline multi_queue()
-    : m_ndx_pop{0}
   { }
 
   /**
@@ -133,10 +136,12 @@ public:
     return m_array[id].push( std::forward<value_type>(data) );
   }
 
-  /**/
+  /**
+   * @brief Return the queue-id bound to the calling thread.
+   */
   constexpr inline queue_id get_id() const noexcept(true)
   {
-    return m_th_map.add()%queues;
+    return thread_shard();
   }
 
   /**
@@ -150,7 +155,7 @@ public:
   template<typename value_type>
   constexpr inline core::result_t  push( value_type&& data ) noexcept(true)
   {
-    const queue_id id = m_th_map.add()%queues;
+    const queue_id id = thread_shard();
     assert( (id >=0) && (id < queues) );
     return m_array[id].push( std::forward<value_type>(data) );
   }
@@ -171,24 +176,98 @@ public:
 
   /**
    * @brief Pop item from one of the queues.
+   *        Each consumer thread starts from its own cursor, rotating over the queues without 
+   *        any shared state; when the selected queue is empty next ones are tried in sequence.
    * 
-   * @param data   output parameter updated only in case return value is true. 
-   * @return true  in this case @param data is updated with extracted value from the selected queue queue.
-   * @return false selected queue is empty, but this doesn't means that all queues are empty.
+   * @param data   output parameter updated only in case return value is core::result_t::eSuccess. 
+   * @return core::result_t::eSuccess  in this case @param data is updated with extracted value.
+   * @return core::result_t::eEmpty    all queues have been found empty.
    */
   constexpr inline core::result_t  pop( value_type& data ) noexcept(true)
   { 
-    size_type qid = m_ndx_pop.load( std::memory_order_acquire );
-    m_ndx_pop.compare_exchange_strong( qid, ((qid+1)<queues)?(qid+1):0 );
-    return m_array[qid].pop( data );
+    size_type&     th_cursor = thread_cursor();
+    core::result_t ret_value = core::result_t::eEmpty;
+    for ( size_type attempt = 0; attempt < queues; ++attempt )
+    {
+      const queue_id qid = th_cursor;
+      th_cursor = ((th_cursor+1)<queues)?(th_cursor+1):0;
+
+      ret_value = m_array[qid].pop( data );
+      if ( ret_value != core::result_t::eEmpty )
+        break;
+    }
+
+    return ret_value;
+  }
+
+  /**
+   * @brief Push data constructed in place from @param args. Destination queue depends on thread::id.
+   * 
+   * @return core::result_t::eSuccess  if operation will be successfully completed.
+   * @return core::result_t::eFailure  if queue failed to allocate memory or the queue reaches the max_size   
+   */
+  template<typename... Args>
+  constexpr inline core::result_t  emplace( Args&&... args ) noexcept(true)
+  {
+    const queue_id id = thread_shard();
+    assert( (id >=0) && (id < queues) );
+    return m_array[id].emplace( std::forward<Args>(args)... );
+  }
+
+  /**
+   * @brief Invoke @param fn, in place, on an item extracted from one of the queues, 
+   *        queues are selected as for pop( value_type& ).
+   * 
+   * @param fn     invoked as fn( value_type& ). 
+   * @return core::result_t::eSuccess  in this case @param fn has been invoked.
+   * @return core::result_t::eEmpty    all queues have been found empty.
+   */
+  template<typename fn_t>
+  constexpr inline core::result_t  consume( fn_t&& fn ) noexcept(true)
+  { 
+    size_type&     th_cursor = thread_cursor();
+    core::result_t ret_value = core::result_t::eEmpty;
+    for ( size_type attempt = 0; attempt < queues; ++attempt )
+    {
+      const queue_id qid = th_cursor;
+      th_cursor = ((th_cursor+1)<queues)?(th_cursor+1):0;
+
+      ret_value = m_array[qid].consume( fn );
+      if ( ret_value != core::result_t::eEmpty )
+        break;
+    }
+
+    return ret_value;
   }
 
 protected:
 
 private:
-  mutable core::thread_map<size_type,0>  m_th_map; 
+  /**
+   * @brief Queue-id for the calling thread, assigned once from a process wide counter.
+   */
+  static inline queue_id           thread_shard() noexcept(true)
+  {
+    static std::atomic<size_type>       s_next_shard{0};
+    static thread_local const size_type th_shard = s_next_shard.fetch_add( 1, std::memory_order_relaxed ) % queues;
+
+    return th_shard;
+  }
+
+  /**
+   * @brief Next queue-id to be used from the calling thread for pop( value_type& ), seeded from
+   *        its own counter so consumers do not take shards from the one used by producers.
+   */
+  static inline size_type&         thread_cursor() noexcept(true)
+  {
+    static std::atomic<size_type>  s_next_cursor{0};
+    static thread_local size_type  th_cursor = s_next_cursor.fetch_add( 1, std::memory_order_relaxed ) % queues;
+
+    return th_cursor;
+  }
+
+private:
   std::array<queue_type, queues>         m_array;
-  std::atomic<size_type>                 m_ndx_pop;
 };
 
 }
@@ -24,16 +24,22 @@
 #ifndef LOCK_FREE_QUEUE_H
 #define LOCK_FREE_QUEUE_H
 
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <thread>
 #include <assert.h>
+#include <chrono>
 #include <cstddef>
+#include <iterator>
 
 #include "config.h"
 #include "arena_allocator.h"
 #include "core/arena_allocator.h"
 #include "core/types.h"
+#include "core/event.h"
+#include "core/stats.h"
+#include "core/reclamation.h"
 
 namespace lock_free {
 
@@ -51,23 +57,49 @@ namespace lock_free {
  *                       - mutex    : the queue will used the standard std::mutex to synchronise r/e access 
  *                       - spinlock : the queue will used a spinlock mutex, exactly core::mutex 
  *                                    to synchronise r/e access 
+ *                       - adaptive : the queue will used core::adaptive_mutex that spin for a short
+ *                                    time and then park waiting threads
  *                       - lockfree : read write operation will be done using atomics and classic CAS loop.
+ *                       - mpsc     : lock-free with any number of producers and a single consumer; push() is a single 
+ *                                    exchange on _tail and the consumer walks the list without any CAS. The queue always 
+ *                                    holds a stub node, so the node of the last extracted item is released by the next pop.
  * @tparam chunk_size    number of data_t items to pre-alloc each time that is needed.
  * @tparam reserve_size  reserved size for the queue, this size will be reserved when the object is created.
  *                       When application level know the amount of memory items to be used this parameter allow
  *                       to improve significantly performances as well as to avoid fragmentation.
  * @tparam size_limit    default value is 0 that means the queue can grow until there is available memory.
  *                       A value different greater than 0 will have the effect to limit max number of items on 
- *                       the queue.
- * @tparam arena_t       lock_free::arena_allocator (default), core::arena_allocator or user defined arena allocator.
+ *                       the queue, in such case producers can wait for room with push_wait() and each pop 
+ *                       notify them, paying a fence when nobody is waiting.
+ * @tparam arena_t       core::default_arena (default) selects a lock_free::arena_allocator that shares stats_t, so 
+ *                       its alloc_miss and chunk_growth are reported by stats(); otherwise lock_free::arena_allocator, 
+ *                       core::arena_allocator or user defined arena allocator, instrumented on its own.
+ *                       Its value_type is used as node, so nodes can be aligned to a cache line with an arena of
+ *                       core::node_t<data_t,false,true,core::ds_is_lockfree<imp_type>,core::cache_line_size>.
+ * @tparam reclaimer_t   used only with lockfree implementation, core::no_reclaimer (default) return popped nodes
+ *                       to the arena immediately, that is safe as long as arena memory is never released while
+ *                       the queue is alive, but a node can be reused by a push() while a concurrent thread still
+ *                       holds it (ABA). core::epoch_reclaimer defers it until no thread can reference them, and it
+ *                       should be preferred when producers and consumers run concurrently.
+ * @tparam layout        used only with lockfree and mpsc implementations, core::layout_t::padded (default) keeps _head and _tail on
+ *                       separate cache lines, core::layout_t::compact packs them with other data members.
+ * @tparam order_t       used only with lockfree and mpsc implementations, memory orders applied to atomic operations; 
+ *                       core::minimal_order (default) or core::seq_cst_order for debugging. With lockfree, _head and 
+ *                       _tail are always accessed with std::memory_order_seq_cst and order_t applies to node links.
+ * @tparam stats_t       core::no_stats (default) or core::thread_stats to account CAS failures, retries, full
+ *                       and empty outcomes, as well as spinlock and adaptive mutex events; see stats().
 */
 template<typename data_t, typename data_size_t, core::ds_impl_t imp_type, 
          data_size_t chunk_size = 1024, data_size_t reserve_size = chunk_size, data_size_t size_limit = 0,
-         typename arena_t = lock_free::arena_allocator<core::node_t<data_t,false,true,(imp_type==core::ds_impl_t::lockfree)>, data_size_t, chunk_size, reserve_size, size_limit, (chunk_size / 3), core::default_allocator<data_size_t>> >
+         typename arena_t = core::default_arena,
+         typename reclaimer_t = core::no_reclaimer,
+         core::layout_t layout = core::layout_t::padded,
+         typename order_t = core::minimal_order,
+         typename stats_t = core::no_stats >
 requires std::is_unsigned_v<data_size_t> && (std::is_same_v<data_size_t,uint32_t> || std::is_same_v<data_size_t,uint64_t>)
          && ( ((sizeof(data_t) % alignof(std::max_align_t)) == 0 ) || ((sizeof(std::max_align_t) % alignof(data_t)) == 0 ) )
-         && (chunk_size >= 1)
-class queue : core::plug_mutex<(imp_type==core::ds_impl_t::mutex)||(imp_type==core::ds_impl_t::spinlock), std::conditional_t<(imp_type==core::ds_impl_t::spinlock),core::mutex,std::mutex>>
+         && (chunk_size >= 1) && core::memory_order_profile<order_t> && core::stats_policy<stats_t>
+class queue : core::plug_mutex<core::ds_has_mutex<imp_type>, core::ds_mutex_t<imp_type,stats_t>>
 {
 public:
   using value_type      = data_t; 
@@ -76,10 +108,29 @@ public:
   using const_reference = const data_t&;
   using pointer         = data_t*;
   using const_pointer   = const data_t*;
-  using node_type       = core::node_t<data_t,false,true,(imp_type==core::ds_impl_t::lockfree)>;
-  using plug_mutex_type = core::plug_mutex<(imp_type==core::ds_impl_t::mutex)||(imp_type==core::ds_impl_t::spinlock), std::conditional_t<(imp_type==core::ds_impl_t::spinlock),core::mutex,std::mutex> >;
-  using node_pointer    = std::conditional_t<(imp_type==core::ds_impl_t::lockfree),std::atomic<node_type*>,node_type*>;
-  using arena_type      = arena_t;
+  using arena_type      = std::conditional_t<std::is_same_v<arena_t,core::default_arena>,
+                                             lock_free::arena_allocator<core::node_t<data_t,false,true,core::ds_is_lockfree<imp_type>>, data_size_t, chunk_size, reserve_size, size_limit, (chunk_size / 3), 
+                                                                        core::default_allocator<data_size_t>, 0, 1, core::slot_layout_t::header, core::minimal_order, stats_t>,
+                                             arena_t>;
+  using node_type       = typename arena_type::value_type;
+  using plug_mutex_type = core::plug_mutex<core::ds_has_mutex<imp_type>, core::ds_mutex_t<imp_type,stats_t>>;
+  using node_pointer    = std::conditional_t<core::ds_is_lockfree<imp_type>,std::atomic<node_type*>,node_type*>;
+  using node_field      = core::cache_aligned_if<node_pointer,core::ds_is_lockfree<imp_type> && (layout==core::layout_t::padded)>;
+  using reclaimer_type  = reclaimer_t;
+  using order_type      = order_t;
+  using stats_type      = stats_t;
+
+private:
+  /**
+   * Order of all operations on _head and _tail of the lockfree implementation, with any order_t. 
+   * Producers and consumers hand the last node over through two different variables, a protocol 
+   * verified only under sequential consistency; order_t still applies to _next links and to 
+   * the mpsc implementation.
+   */
+  static constexpr const std::memory_order handoff_order = std::memory_order_seq_cst;
+
+  /** Number of nodes allocated or released with a single request to the arena, from bulk operations. */
+  static constexpr const size_type bulk_size = 64;
 
 public:
   
@@ -92,6 +143,12 @@ public:
       _head.store( nullptr, std::memory_order_release );
       _tail.store( nullptr, std::memory_order_release );
     }
+
+    if constexpr (imp_type==core::ds_impl_t::mpsc)
+    {
+      _head.store( &_stub, std::memory_order_relaxed );
+      _tail.store( &_stub, std::memory_order_release );
+    }
   }
 
   /***/
@@ -116,19 +173,81 @@ public:
   constexpr inline bool            empty() const noexcept
   { return (size()==0); }
 
+  /**
+   * @brief Counters collected by stats_t, merged with the ones of the arena and of the mutex 
+   *        when they provide stats(). With core::no_stats all counters are 0.
+   */
+  constexpr inline core::stats_snapshot  stats() const noexcept
+  { 
+    core::stats_snapshot result = _stats.snapshot();
+
+    if constexpr ( requires ( const arena_type& arena ) { { arena.stats() } -> std::same_as<core::stats_snapshot>; } )
+    { result += _arena.stats(); }
+
+    if constexpr ( plug_mutex_type::has_mutex )
+    {
+      if constexpr ( requires ( const typename plug_mutex_type::mutex_type& mtx ) { mtx.stats(); } )
+      { result += this->_mtx[0].stats(); }
+    }
+
+    return result;
+  }
+
   /***/
   template<typename value_type>
   constexpr inline core::result_t  push( value_type&& data ) noexcept
-  {
-    if constexpr (imp_type==core::ds_impl_t::lockfree)
-      return _push_imp_lockfree( std::move(data) );
-    
-    if constexpr (imp_type!=core::ds_impl_t::lockfree)
-      return _push_imp_default( std::move(data) );
+  { return push_node( create_node( std::move(data) ) ); }
 
-    return core::result_t::eNotImplemented;
+  /**
+   * @brief Push @param data waiting up to @param timeout milliseconds, when the queue is full, 
+   *        that a consumer release a node. Producers are parked on a core::event, so they don't 
+   *        spin against a full queue. Available only with size_limit > 0.
+   * 
+   *        Note: with a deferred reclaimer_t released nodes are returned to the arena later, 
+   *              so the room can be seen by waiting producers only at a following pop.
+   * 
+   * @return core::result_t::eSuccess  if the element has been pushed.
+   *         core::result_t::eTimeout  if the queue is still full after @param timeout, @param data 
+   *                                   is left untouched.
+   */
+  template<typename value_type>
+  constexpr inline core::result_t  push_wait( value_type&& data, uint32_t timeout ) noexcept
+    requires (size_limit > 0)
+  { 
+    core::result_t result = push( std::move(data) );
+    if ( result != core::result_t::eFailure )
+      return result;
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    for (;;)
+    {
+      const auto now = std::chrono::steady_clock::now();
+      if ( now >= deadline )
+        return core::result_t::eTimeout;
+
+      const uint32_t remaining = static_cast<uint32_t>( std::chrono::ceil<std::chrono::milliseconds>( deadline - now ).count() );
+      if ( _room.wait( remaining, [this]() noexcept { return has_room(); } ) == core::result_t::eTimeout )
+        return core::result_t::eTimeout;
+
+      result = push( std::move(data) );
+      if ( result != core::result_t::eFailure )
+        return result;
+
+      // room taken by a different producer, or arena_allocator still growing.
+      std::this_thread::yield();
+    }
   }
 
+  /**
+   * @brief Push a new element constructed in place, directly in the arena slot, from @param args.
+   * 
+   * @return core::result_t::eSuccess  if the element has been pushed.
+   *         core::result_t::eFailure  if it was not possible to allocate a new node.
+   */
+  template<typename... Args>
+  constexpr inline core::result_t  emplace( Args&&... args ) noexcept
+  { return push_node( _arena.allocate( std::in_place, std::forward<Args>(args)... ) ); }
+
   /**
    * @brief Extract first element from the queue.
    * 
@@ -139,14 +258,112 @@ public:
    *         core::result_t::eDoubleDelete  an internal double free have been detected.
    */
   constexpr inline core::result_t  pop( value_type& data ) noexcept
+  { return consume( [&data]( value_type& item ) noexcept { data = std::move(item); } ); }
+
+  /**
+   * @brief Extract first element from the queue and invoke @param fn on it, in place, 
+   *        before releasing its node; so the element is never copied or moved.
+   *        With mutex, spinlock and adaptive implementations the lock is not held by @param fn.
+   *        With mpsc implementation only one thread can call consume() at a time, and the element
+   *        is destroyed with its node by the following pop.
+   * 
+   * @param fn                              invoked as fn( value_type& ). 
+   * @return core::result_t::eEmpty         if there are no item in the queue.
+   *         core::result_t::eSuccess       if @param fn have been invoked with the element
+   *                                        extracted from queue.
+   *         core::result_t::eDoubleDelete  an internal double free have been detected.
+   */
+  template<typename fn_t>
+  constexpr inline core::result_t  consume( fn_t&& fn ) noexcept
   {
+    core::result_t result = core::result_t::eNotImplemented;
+
     if constexpr (imp_type==core::ds_impl_t::lockfree)
-      return _pop_imp_lockfree(data);
+      result = _pop_imp_lockfree( fn );
     
-    if constexpr (imp_type!=core::ds_impl_t::lockfree)
-      return _pop_imp_default(data);
+    if constexpr (imp_type==core::ds_impl_t::mpsc)
+      result = _pop_imp_mpsc( fn );
     
-    return core::result_t::eNotImplemented;
+    if constexpr (!core::ds_is_lockfree<imp_type>)
+      result = _pop_imp_default( fn );
+    
+    if ( result != core::result_t::eEmpty )
+      notify_room();
+    else
+      _stats.add( core::stats_event_t::empty );
+
+    return result;
+  }
+
+  /**
+   * @brief Push elements in the range [@param first, @param last) moving them in the queue.
+   *        All nodes are allocated and linked each other before being published, so the 
+   *        whole sequence is appended to the queue as a single segment and items pushed by 
+   *        other threads are never interleaved with it.
+   * 
+   *        Note: arena_t must provide allocate_n_from() when the iterators are forward iterators.
+   * 
+   * @param first   iterator to the first element to be pushed.
+   * @param last    iterator past the last element to be pushed.
+   * @return number of elements pushed; it can be less than std::distance(first,last) only when 
+   *         there are no more nodes available, in such case elements not pushed are left untouched.
+   */
+  template<typename input_iterator_t>
+  constexpr inline size_type       push_bulk( input_iterator_t first, input_iterator_t last ) noexcept
+  {
+    node_type* seg_first = nullptr;
+    node_type* seg_last  = nullptr;
+    size_type  pushed    = create_segment( first, last, seg_first, seg_last );
+    if ( first != last )
+      _stats.add( core::stats_event_t::full );
+
+    if ( pushed == 0 )
+      return 0;
+
+    if constexpr (imp_type==core::ds_impl_t::lockfree)
+      _push_segment_lockfree( seg_first, seg_last );
+    
+    if constexpr (imp_type==core::ds_impl_t::mpsc)
+      _push_segment_mpsc( seg_first, seg_last );
+    
+    if constexpr (!core::ds_is_lockfree<imp_type>)
+      _push_segment_default( seg_first, seg_last );
+
+    return pushed;
+  }
+
+  /**
+   * @brief Extract up to @param max elements from the queue with a single operation on the head.
+   * 
+   *        Note: arena_t must provide allocate_n() and deallocate_n().
+   * 
+   * @param out     output iterator where extracted elements will be moved.
+   * @param max     max number of elements to be extracted.
+   * @return number of elements extracted, 0 if the queue is empty.
+   */
+  template<typename output_iterator_t>
+  constexpr inline size_type       pop_bulk( output_iterator_t out, size_type max ) noexcept
+  {
+    if ( max == 0 )
+      return 0;
+
+    size_type count = 0;
+
+    if constexpr (imp_type==core::ds_impl_t::lockfree)
+      count = _pop_bulk_imp_lockfree( out, max );
+    
+    if constexpr (imp_type==core::ds_impl_t::mpsc)
+      count = _pop_bulk_imp_mpsc( out, max );
+    
+    if constexpr (!core::ds_is_lockfree<imp_type>)
+      count = _pop_bulk_imp_default( out, max );
+
+    if ( count > 0 )
+      notify_room();
+    else
+      _stats.add( core::stats_event_t::empty );
+
+    return count;
   }
 
   /**
@@ -159,13 +376,22 @@ public:
       _tail.store( nullptr, std::memory_order_release );
       _head.store( nullptr, std::memory_order_release );
     }
+
+    if constexpr (imp_type==core::ds_impl_t::mpsc)
+    {
+      _stub._next.store( nullptr, std::memory_order_relaxed );
+      _head.store( &_stub, std::memory_order_relaxed );
+      _tail.store( &_stub, std::memory_order_release );
+    }
     
-    if constexpr (imp_type!=core::ds_impl_t::lockfree)
+    if constexpr (!core::ds_is_lockfree<imp_type>)
     {
       _tail = nullptr;
       _head = nullptr;
     }
 
+    // nodes waiting for reclamation belong to the arena.
+    _reclaimer.drain();
     _arena.clear();
   }
 
@@ -179,8 +405,7 @@ public:
   {
     if constexpr (plug_mutex_type::has_mutex==true)
     { 
-      do{
-      } while ( !plug_mutex_type::template try_lock<0>() );
+      plug_mutex_type::template lock<0>();
       
       return core::result_t::eSuccess;
     }
@@ -216,6 +441,46 @@ private:
   constexpr inline node_type*         create_node ( value_type&& data ) noexcept
   { return _arena.allocate( std::move(data) ); }
 
+  /**
+   * @brief Link @param new_node at the end of the queue.
+   * 
+   * @return core::result_t::eFailure if @param new_node is nullptr, core::result_t::eSuccess otherwise.
+   */
+  constexpr inline core::result_t     push_node( node_type* new_node ) noexcept
+  {
+    if ( new_node == nullptr )
+    {
+      _stats.add( core::stats_event_t::full );
+      return core::result_t::eFailure;
+    }
+
+    if constexpr (imp_type==core::ds_impl_t::lockfree)
+      return _push_imp_lockfree( new_node );
+    
+    if constexpr (imp_type==core::ds_impl_t::mpsc)
+      return _push_imp_mpsc( new_node );
+    
+    if constexpr (!core::ds_is_lockfree<imp_type>)
+      return _push_imp_default( new_node );
+
+    return core::result_t::eNotImplemented;
+  }
+
+  /**
+   * @brief True when a push can succeed, because a node is free or the arena can still grow.
+   */
+  constexpr inline bool               has_room() const noexcept
+  { return ( _arena.length() < _arena.max_length() ) || ( _arena.max_length() < size_limit ); }
+
+  /**
+   * @brief With size_limit > 0 wake up producers waiting in push_wait(), only if there are.
+   */
+  constexpr inline void               notify_room() noexcept
+  {
+    if constexpr ( size_limit > 0 )
+    { _room.notify_if_waiting(); }
+  }
+
   /**
    * @brief Make specified node available for future use.
    * 
@@ -224,6 +489,86 @@ private:
   constexpr inline core::result_t     destroy_node( node_type* node ) noexcept
   { return _arena.deallocate(node); }
 
+  /**
+   * @brief Release a node unlinked from the lock-free queue, through reclaimer_t.
+   *        When the release is deferred a double free can't be reported.
+   */
+  constexpr inline core::result_t     retire_node( node_type* node ) noexcept
+  {
+    if constexpr ( reclaimer_type::deferred == false )
+    { return destroy_node( node ); }
+    else
+    {
+      _reclaimer.retire( node, &queue::reclaim_node, this );
+      return core::result_t::eSuccess;
+    }
+  }
+
+  /***/
+  static inline void                  reclaim_node( void* ctx, void* node ) noexcept
+  { (void)static_cast<queue*>(ctx)->destroy_node( static_cast<node_type*>(node) ); }
+
+  /**
+   * @brief Create and link each other nodes for elements in [@param first, @param last), each node 
+   *        is constructed in place from std::move(*first). With forward iterators nodes are allocated 
+   *        in groups of up to bulk_size using allocate_n_from(), never more than the elements left, 
+   *        so with size_limit other producers don't see the queue full because of spare nodes; 
+   *        single pass iterators allocate one node at a time.
+   * 
+   * @param seg_first  output parameter, first node of the segment.
+   * @param seg_last   output parameter, last node of the segment.
+   * @return number of nodes in the segment.
+   */
+  template<typename input_iterator_t>
+  constexpr inline size_type          create_segment( input_iterator_t& first, input_iterator_t last, node_type*& seg_first, node_type*& seg_last ) noexcept
+  {
+    size_type count = 0;
+    auto      link  = [&seg_first, &seg_last, &count]( node_type* node ) noexcept {
+                        if ( seg_last == nullptr )
+                          seg_first = node;
+                        else
+                          seg_last->_next = node;
+
+                        seg_last = node;
+                        ++count;
+                      };
+
+    if constexpr ( std::forward_iterator<input_iterator_t> )
+    {
+      std::array<node_type*,bulk_size> nodes;
+      auto remaining = std::distance( first, last );
+
+      while ( remaining > 0 )
+      {
+        const size_type requested = static_cast<size_type>( std::min<decltype(remaining)>( remaining, bulk_size ) );
+        const size_type allocated = _arena.allocate_n_from( nodes.data(), requested, first );
+
+        for ( size_type ndx = 0; ndx < allocated; ++ndx )
+        { link( nodes[ndx] ); }
+
+        // not enough memory to complete the segment.
+        if ( allocated < requested )
+          break;
+
+        remaining -= allocated;
+      }
+    }
+    else
+    {
+      while ( first != last )
+      {
+        node_type* node = _arena.allocate( std::move(*first) );
+        if ( node == nullptr )
+          break;
+
+        link( node );
+        ++first;
+      }
+    }
+
+    return count;
+  }
+
   /***/
   constexpr inline size_type          _size_imp()  const noexcept
   { 
@@ -231,7 +576,16 @@ private:
 
     lock();
 
+    // nodes waiting for reclamation are still allocated from the arena.
     ret_value = _arena.length();
+    ret_value = ret_value - std::min<size_type>( ret_value, static_cast<size_type>(_reclaimer.pending()) );
+
+    // with mpsc the stub node, once it is not _stub, holds an element already extracted.
+    if constexpr (imp_type==core::ds_impl_t::mpsc)
+    {
+      if ( _head.load( std::memory_order_relaxed ) != &_stub )
+        ret_value = ret_value - std::min<size_type>( ret_value, 1 );
+    }
 
     unlock();
 
@@ -239,73 +593,57 @@ private:
   }
 
   /***/
-  constexpr inline core::result_t     _push_imp_default( value_type&& data ) noexcept
+  constexpr inline core::result_t     _push_imp_default( node_type* new_node ) noexcept
   {
-    core::result_t ret_value = core::result_t::eFailure;
-
     lock();
 
-    node_type* new_node = create_node( std::move(data) );
-    if ( new_node != nullptr )
-    {
-      if ( _head == nullptr ) {
-        _head = new_node;
-        _tail = new_node;
-      }
-      else {
-        _tail->_next = new_node;
-         _tail = new_node;
-      }
-
-      ret_value = core::result_t::eSuccess;
+    if ( _head == nullptr ) {
+      _head = new_node;
+      _tail = new_node;
+    }
+    else {
+      _tail->_next = new_node;
+       _tail = new_node;
     }
 
     unlock();
 
-    return ret_value;    
+    return core::result_t::eSuccess;
   }
 
   /***/
-  constexpr inline core::result_t     _push_imp_lockfree( value_type&& data ) noexcept
+  constexpr inline core::result_t     _push_imp_lockfree( node_type* new_node ) noexcept
   {
-    node_type* new_node = create_node( std::move(data) );
-    if ( new_node == nullptr )
-      return core::result_t::eFailure;
+    typename reclaimer_type::guard guard( _reclaimer );
 
     node_type* old_tail      = nullptr;
     node_type* old_tail_next = nullptr;
-    node_type* old_head      = nullptr;
     for (;;)
     {
-      old_tail = _tail.load( std::memory_order_acquire );
-      old_head = _head.load( std::memory_order_acquire );
-
-      if ( ( old_head == nullptr ) && ( old_tail != nullptr ) )
-      {
-        _tail.compare_exchange_weak( old_tail, nullptr, std::memory_order_seq_cst,  std::memory_order_relaxed );
-        continue;
-      }
+      old_tail = _tail.load( handoff_order );
 
       if ( old_tail == nullptr ) // means that queue is empty?
       {
-        if ( _tail.compare_exchange_weak( old_tail, new_node, std::memory_order_seq_cst,  std::memory_order_relaxed ) == false )
-          continue; // when this fails means that _tail have been modified by a different thread, so let's come back to the loop reading the new tail.
+        if ( _tail.compare_exchange_weak( old_tail, new_node, handoff_order,  handoff_order ) == false )
+          { _stats.add( core::stats_event_t::cas_failure ); continue; } // when this fails means that _tail have been modified by a different thread, so let's come back to the loop reading the new tail.
 
-        if ( old_head == nullptr )
-        { _head.compare_exchange_strong( old_head, new_node, std::memory_order_seq_cst, std::memory_order_relaxed ); }
+        // _head is nullptr or still the last node being released by _pop_last_lockfree(), that will not 
+        // overwrite it, while only the thread that set _tail can be here.
+        _head.store( new_node, handoff_order );
       }
       else
       {
-        old_tail_next = old_tail->_next.load( std::memory_order_acquire );
+        old_tail_next = old_tail->_next.load( order_t::acquire );
         if ( old_tail_next != nullptr )
-          continue;   // tail._next must be nullptr or it means that another thread already updated it even old_tail hasn't been updated yet.
+          { _stats.add( core::stats_event_t::retry ); std::this_thread::yield(); continue; }   // tail._next must be nullptr or it means that another thread already updated it even old_tail hasn't been updated yet,
+                                                                                             // or that old_tail is the last node and a consumer is releasing it.
 
-        if ( old_tail->_next.compare_exchange_weak( old_tail_next, new_node, std::memory_order_seq_cst,  std::memory_order_relaxed ) == false )
-          continue;
+        if ( old_tail->_next.compare_exchange_weak( old_tail_next, new_node, order_t::acq_rel,  order_t::relaxed ) == false )
+          { _stats.add( core::stats_event_t::cas_failure ); continue; }
 
         // _tail at this stage can be modified only from the thread that was able to step up to here, so we do not need to check if someone else
         // is tring to update it.
-        _tail.exchange( new_node, std::memory_order_release );
+        _tail.exchange( new_node, handoff_order );
       }
       
       break;
@@ -315,63 +653,348 @@ private:
   }
 
   /***/
-  constexpr inline core::result_t     _pop_imp_default( value_type& data ) noexcept
+  template<typename fn_t>
+  constexpr inline core::result_t     _pop_imp_default( fn_t& fn ) noexcept
   {
-    core::result_t ret_value = core::result_t::eEmpty;
+    node_type* first_node = nullptr;
 
     lock();
 
     if ( _head != nullptr )  
     {
-      node_type* first_node = _head;
+      first_node = _head;
       
       _head = _head->_next;
 
-      data = std::move(first_node->_data);
-      ret_value = destroy_node(first_node);
-
       if ( _head == nullptr )
         _tail = nullptr;
     }
 
     unlock();
 
-    return ret_value;    
+    if ( first_node == nullptr )
+      return core::result_t::eEmpty;
+
+    fn( first_node->_data );
+
+    return destroy_node(first_node);    
   }
 
   /***/
-  constexpr inline core::result_t     _pop_imp_lockfree( value_type& data ) noexcept
+  template<typename fn_t>
+  constexpr inline core::result_t     _pop_imp_lockfree( fn_t& fn ) noexcept
   {
+    typename reclaimer_type::guard guard( _reclaimer );
+
     node_type* old_head      = nullptr; 
     node_type* old_head_next = nullptr;
     for (;;)
     {
-      old_head = _head.load( std::memory_order_acquire );;
+      old_head = _head.load( handoff_order );;
       if ( old_head == nullptr )
         return core::result_t::eEmpty;
 
-      old_head_next = old_head->_next.load( std::memory_order_acquire );
+      old_head_next = old_head->_next.load( order_t::acquire );
+      if ( old_head_next == old_head )
+        { _stats.add( core::stats_event_t::retry ); std::this_thread::yield(); continue; }
 
-      if ( _head.compare_exchange_weak( old_head, old_head_next, std::memory_order_acq_rel, std::memory_order_acquire ) == false )
-        continue;
+      if ( old_head_next == nullptr )
+      {
+        if ( _pop_last_lockfree( old_head ) == false )
+          { _stats.add( core::stats_event_t::cas_failure ); continue; }
+
+        break;
+      }
+
+      if ( _head.compare_exchange_weak( old_head, old_head_next, handoff_order, handoff_order ) == false )
+        { _stats.add( core::stats_event_t::cas_failure ); continue; }
 
       break;
     }
     
-    data = std::move(old_head->_data);
-    old_head->_next = nullptr;
+    // _next is not reset, a producer still reading old_head as _tail must not be able to link to it.
+    fn( old_head->_data );
 
     // if old_head have been already released, this may result in 
     // a logic issue at application level. 
     // core::result_t::eDoubleFree will be returned in this case.   
-    return destroy_node(old_head);
+    return retire_node(old_head);
+  }
+
+  /**
+   * @brief Unlink @param last_node that is both _head and the last node of the queue. Its _next is set 
+   *        to itself first, so producers can't link to it anymore and other consumers retry; then _tail 
+   *        and _head are cleared. _tail may still point to the previous node, in such case the producer 
+   *        that linked @param last_node is going to update it.
+   * 
+   * @return false if a producer linked a new node in the meantime, so @param last_node it is not the last one.
+   */
+  constexpr inline bool               _pop_last_lockfree( node_type* last_node ) noexcept
+  {
+    node_type* last_next = nullptr;
+    if ( last_node->_next.compare_exchange_strong( last_next, last_node, order_t::acq_rel, order_t::relaxed ) == false )
+      return false;
+
+    node_type* expected = last_node;
+    while ( _tail.compare_exchange_weak( expected, nullptr, handoff_order, handoff_order ) == false )
+    {
+      expected = last_node;
+      _stats.add( core::stats_event_t::retry );
+      std::this_thread::yield();
+    }
+
+    // fails if a producer already found the queue empty and set a new _head.
+    expected = last_node;
+    _head.compare_exchange_strong( expected, nullptr, handoff_order, handoff_order );
+
+    return true;
+  }
+
+  /***/
+  constexpr inline void               _push_segment_default( node_type* seg_first, node_type* seg_last ) noexcept
+  {
+    lock();
+
+    if ( _head == nullptr ) {
+      _head = seg_first;
+      _tail = seg_last;
+    }
+    else {
+      _tail->_next = seg_first;
+      _tail = seg_last;
+    }
+
+    unlock();
+  }
+
+  /***/
+  constexpr inline void               _push_segment_lockfree( node_type* seg_first, node_type* seg_last ) noexcept
+  {
+    typename reclaimer_type::guard guard( _reclaimer );
+
+    node_type* old_tail      = nullptr;
+    node_type* old_tail_next = nullptr;
+    for (;;)
+    {
+      old_tail = _tail.load( handoff_order );
+
+      if ( old_tail == nullptr ) // means that queue is empty?
+      {
+        if ( _tail.compare_exchange_weak( old_tail, seg_last, handoff_order,  handoff_order ) == false )
+          { _stats.add( core::stats_event_t::cas_failure ); continue; }
+
+        _head.store( seg_first, handoff_order );
+      }
+      else
+      {
+        old_tail_next = old_tail->_next.load( order_t::acquire );
+        if ( old_tail_next != nullptr )
+          { _stats.add( core::stats_event_t::retry ); std::this_thread::yield(); continue; }
+
+        // segment is linked to the queue with the same CAS used for a single node.
+        if ( old_tail->_next.compare_exchange_weak( old_tail_next, seg_first, order_t::acq_rel,  order_t::relaxed ) == false )
+          { _stats.add( core::stats_event_t::cas_failure ); continue; }
+
+        _tail.exchange( seg_last, handoff_order );
+      }
+      
+      break;
+    }
+  }
+
+  /***/
+  template<typename output_iterator_t>
+  constexpr inline size_type          _pop_bulk_imp_default( output_iterator_t& out, size_type max ) noexcept
+  {
+    std::array<node_type*,bulk_size> nodes;
+    size_type                        count = 0;
+    size_type                        ndx   = 0;
+
+    lock();
+
+    while ( ( _head != nullptr ) && ( count < max ) )
+    {
+      node_type* first_node = _head;
+      
+      _head = _head->_next;
+
+      *out = std::move(first_node->_data);
+      ++out;
+      ++count;
+
+      nodes[ndx++] = first_node;
+      if ( ndx == bulk_size )
+      {
+        (void)_arena.deallocate_n( nodes.data(), ndx );
+        ndx = 0;
+      }
+    }
+
+    if ( _head == nullptr )
+      _tail = nullptr;
+
+    if ( ndx > 0 )
+    { (void)_arena.deallocate_n( nodes.data(), ndx ); }
+
+    unlock();
+
+    return count;
+  }
+
+  /***/
+  template<typename output_iterator_t>
+  constexpr inline size_type          _pop_bulk_imp_lockfree( output_iterator_t& out, size_type max ) noexcept
+  {
+    typename reclaimer_type::guard guard( _reclaimer );
+
+    node_type* old_head      = nullptr; 
+    node_type* seg_last      = nullptr;
+    node_type* seg_last_next = nullptr;
+    size_type  count         = 0;
+    for (;;)
+    {
+      old_head = _head.load( handoff_order );
+      if ( old_head == nullptr )
+        return 0;
+
+      seg_last      = old_head;
+      seg_last_next = seg_last->_next.load( order_t::acquire );
+      count         = 1;
+      if ( seg_last_next == old_head )
+        { _stats.add( core::stats_event_t::retry ); std::this_thread::yield(); continue; }
+
+      if ( seg_last_next == nullptr )
+      {
+        // only one node, released as pop() does.
+        if ( _pop_last_lockfree( old_head ) == false )
+          { _stats.add( core::stats_event_t::cas_failure ); continue; }
+
+        break;
+      }
+
+      // walk up to max nodes, the whole segment is then detached with a single CAS on _head; the walk 
+      // stops one node before the last one, so _head never moves to nullptr while a producer is linking.
+      while ( count < max )
+      {
+        node_type* next_next = seg_last_next->_next.load( order_t::acquire );
+        if ( ( next_next == nullptr ) || ( next_next == seg_last_next ) )
+          break;
+
+        seg_last      = seg_last_next;
+        seg_last_next = next_next;
+        ++count;
+      }
+
+      if ( _head.compare_exchange_weak( old_head, seg_last_next, handoff_order, handoff_order ) == false )
+        { _stats.add( core::stats_event_t::cas_failure ); continue; }
+
+      break;
+    }
+
+    std::array<node_type*,bulk_size> nodes;
+    size_type                        ndx       = 0;
+    node_type*                       curr_node = old_head;
+    for ( size_type i = 0; i < count; ++i )
+    {
+      node_type* next_node = curr_node->_next.load( order_t::acquire );
+
+      *out = std::move(curr_node->_data);
+      ++out;
+
+      if constexpr ( reclaimer_type::deferred == true )
+      { (void)retire_node( curr_node ); }
+      else
+      {
+        nodes[ndx++] = curr_node;
+        if ( ndx == bulk_size )
+        {
+          (void)_arena.deallocate_n( nodes.data(), ndx );
+          ndx = 0;
+        }
+      }
+
+      curr_node = next_node;
+    }
+
+    if ( ndx > 0 )
+    { (void)_arena.deallocate_n( nodes.data(), ndx ); }
+
+    return count;
+  }
+
+  /**
+   * @brief Producers are serialized by a single exchange on _tail, then the previous tail is linked 
+   *        to the new node. Until the link is stored the consumer sees the queue ending at the 
+   *        previous tail, so even the following items are not visible.
+   */
+  constexpr inline core::result_t     _push_imp_mpsc( node_type* new_node ) noexcept
+  {
+    _push_segment_mpsc( new_node, new_node );
+
+    return core::result_t::eSuccess;
+  }
+
+  /***/
+  constexpr inline void               _push_segment_mpsc( node_type* seg_first, node_type* seg_last ) noexcept
+  {
+    // acquire, so that the link is not overwritten by the initialization of the node linked before.
+    node_type* prev = _tail.exchange( seg_last, order_t::acq_rel );
+
+    prev->_next.store( seg_first, order_t::release );
+  }
+
+  /**
+   * @brief _head is the stub node: the first element is in the node that follows it, and such node 
+   *        becomes the new stub once @param fn returns. The previous stub can be released without 
+   *        a reclaimer, since producers only access the last node, that can't be the stub that is 
+   *        left behind.
+   */
+  template<typename fn_t>
+  constexpr inline core::result_t     _pop_imp_mpsc( fn_t& fn ) noexcept
+  {
+    node_type* old_head = _head.load( order_t::relaxed );
+    node_type* new_head = old_head->_next.load( order_t::acquire );
+    if ( new_head == nullptr )
+      return core::result_t::eEmpty;
+
+    fn( new_head->_data );
+
+    _head.store( new_head, order_t::relaxed );
+
+    if ( old_head == &_stub )
+      return core::result_t::eSuccess;
+
+    return destroy_node( old_head );
+  }
+
+  /***/
+  template<typename output_iterator_t>
+  constexpr inline size_type          _pop_bulk_imp_mpsc( output_iterator_t& out, size_type max ) noexcept
+  {
+    auto move_out = [&out]( value_type& item ) noexcept { *out = std::move(item); ++out; };
+
+    size_type count = 0;
+    while ( ( count < max ) && ( _pop_imp_mpsc( move_out ) != core::result_t::eEmpty ) )
+    { ++count; }
+
+    return count;
   }
 
 private:
-  arena_type     _arena;
-  node_pointer   _head;
-  node_pointer   _tail;
-  
+  // placeholder for data members not used by a given instance.
+  struct none {};
+  // used only when imp_type is mpsc.
+  using stub_type  = std::conditional_t<(imp_type==core::ds_impl_t::mpsc),node_type,none>;
+  // used only when size_limit > 0.
+  using event_type = std::conditional_t<(size_limit > 0),core::event,none>;
+
+  arena_type                        _arena;
+  reclaimer_type                    _reclaimer;
+  node_field                        _head;
+  node_field                        _tail;
+  [[no_unique_address]] stub_type   _stub;
+  [[no_unique_address]] event_type  _room;
+  [[no_unique_address]] stats_t     _stats;
 };
 
 }
@@ -24,15 +24,60 @@
 #ifndef LOCK_FREE_RING_BUFFER_H
 #define LOCK_FREE_RING_BUFFER_H
 
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <bit>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <new>
+#include <thread>
 
 #include "config.h"
+#include "core/types.h"
+#include "core/counter.h"
+#include "core/mapped_storage.h"
 
 namespace lock_free {
 
-template<typename data_t, typename data_size_t, data_size_t items>
+/***
+ * @brief Bounded multi-producer multi-consumer ring buffer.
+ *        Each slot holds a sequence number that tells producers and consumers whether 
+ *        the slot is ready for them at the current lap, so push() and pop() complete 
+ *        with a single CAS on the shared index and fail only when the buffer is full 
+ *        or empty. Memory is allocated once in the constructor.
+ *        Indices, counter and slots are kept in a single block, without pointers, so with 
+ *        core::mapped_storage the same ring buffer can be mapped by cooperating processes.
+ * 
+ * @tparam data_t        data type held by the ring buffer.
+ * @tparam data_size_t   data type to be used internally for counting and sizing. 
+ *                       This is required to be 32 bits or 64 bits in order to keep performances.
+ * @tparam items         min number of items that the ring buffer can hold; actual capacity()
+ *                       is rounded up to the next power of two so that indices can be masked.
+ * @tparam access        core::access_t::mpmc (default) any number of threads can push() and pop(),
+ *                       core::access_t::spsc only one thread can push() and only one thread can pop();
+ *                       in this case slots have no sequence and each side keeps a cached copy of the 
+ *                       opposite index, reading the shared one only when the buffer looks full or empty.
+ * @tparam counter_policy core::counter_t::exact (default) a single counter is updated by each push() and pop(),
+ *                       core::counter_t::striped each thread updates its own stripe and size() is approximate.
+ *                       Not used with core::access_t::spsc where size() is computed from the indices.
+ * @tparam order_t       memory orders applied to indices and sequences, core::minimal_order (default) or 
+ *                       core::seq_cst_order for debugging.
+ * @tparam storage_t     core::heap_storage (default) the block is allocated on the heap and destroyed with 
+ *                       the ring buffer. core::mapped_storage maps the block from a file in shared mode: the 
+ *                       first ring buffer initializes it, the following ones, also from other processes, attach 
+ *                       to it and find pending items, that survive the processes. In this case data_t must be 
+ *                       trivially copyable and it should not hold pointers; is_valid() tells if the mapping 
+ *                       succeeded. Items of a producer that crashed between claiming a slot and publishing it 
+ *                       can't be recovered, and with core::access_t::mpmc consumers stop at that slot.
+ */
+template<typename data_t, typename data_size_t, data_size_t items, core::access_t access = core::access_t::mpmc,
+         core::counter_t counter_policy = core::counter_t::exact, typename order_t = core::minimal_order, 
+         typename storage_t = core::heap_storage>
 requires std::is_unsigned_v<data_size_t> && (std::is_same_v<data_size_t,uint32_t> || std::is_same_v<data_size_t,uint64_t>)
+         && (items >= 1) && (items <= (std::numeric_limits<data_size_t>::max()/2)+1) && core::memory_order_profile<order_t>
+         && ( !storage_t::persistent || ( std::is_trivially_copyable_v<data_t> && std::atomic<data_size_t>::is_always_lock_free ) )
 class ring_buffer
 {
 public:
@@ -44,116 +89,355 @@ public:
   using const_pointer   = const data_t*;
 
   static constexpr const size_type data_type_size = sizeof(value_type);
+  static constexpr const size_type ring_size      = std::bit_ceil(items);
+  static constexpr const size_type index_mask     = ring_size - 1;
 
 private:
-  enum class slot_status_t : size_type {
-    eEmpty = 0,
-    eBusyForRead,
-    eBusyForWrite,
-    eFull
-  };
+  using difference_type = std::make_signed_t<size_type>;
 
+  /**
+   * @brief A slot is ready for push() at position 'pos' when sequence is equal to 'pos',
+   *        and it is ready for pop() when sequence is equal to 'pos+1'. Each pop() move 
+   *        the sequence one lap ahead.
+   *        Slots are not padded to a cache line in order to keep memory footprint at 
+   *        ring_size*sizeof(slot_t).
+   */
   struct slot_t
   {
-    slot_t()
-     : status(slot_status_t::eEmpty)
-    {}
+    std::atomic<size_type>        sequence;
+    value_type                    data;
+  };
 
-    std::atomic<slot_status_t>    status;
+  /**
+   * @brief Slot used with core::access_t::spsc, where indices are enough to know if data is ready.
+   */
+  struct spsc_slot_t
+  {
     value_type                    data;
   };
 
+  static constexpr const bool is_spsc = (access==core::access_t::spsc);
+
+  using slot_type       = std::conditional_t<is_spsc, spsc_slot_t, slot_t>;
+
+  /** Written to block_t::magic once the block is initialized. */
+  static constexpr const uint64_t block_magic  = 0x4C46524247424C4BULL;
+  /** Geometry of the block, checked when attaching to an existing one. */
+  static constexpr const uint64_t block_layout = (uint64_t(sizeof(slot_type)) << 32) ^ (uint64_t(ring_size) << 1) ^ (is_spsc?1:0);
+
+  /**
+   * @brief All the state of the ring buffer, kept together so that it can be mapped.
+   */
+  struct block_t
+  {
+    std::atomic<uint64_t>                                   magic;
+    uint64_t                                                layout;
+    // producer side, cachedRead is used only with core::access_t::spsc
+    alignas(core::cache_line_size) std::atomic<size_type>   ndxWrite;
+    size_type                                               cachedRead;
+    // consumer side, cachedWrite is used only with core::access_t::spsc
+    alignas(core::cache_line_size) std::atomic<size_type>   ndxRead;
+    size_type                                               cachedWrite;
+    // not updated with core::access_t::spsc
+    alignas(core::cache_line_size) core::counter<size_type,counter_policy> counter;
+    std::array<slot_type, ring_size>                        slots;
+  };
+
 public:
-  /***/
-  constexpr inline ring_buffer()
-    : m_array(std::make_unique<std::array<slot_t, items>>()),
-      m_ndxWrite( 0 ),m_ndxRead(0),m_counter(0)
-  { }
+  using storage_type    = storage_t;
 
   /***/
+  inline ring_buffer() requires std::is_default_constructible_v<storage_t>
+    : ring_buffer( storage_t() )
+  {}
+
+  /**
+   * @brief Map the block through @param storage, it is initialized only if it has been just created.
+   */
+  inline explicit ring_buffer( storage_t storage )
+    : m_storage( std::move(storage) ), m_block( nullptr )
+  { 
+    bool  created = false;
+    void* ptr     = m_storage.map( sizeof(block_t), alignof(block_t), created );
+    if ( ptr == nullptr )
+      return;
+
+    if ( created )
+    {
+      m_block = new(ptr) block_t();
+      m_block->layout = block_layout;
+
+      if constexpr (!is_spsc)
+      {
+        for ( size_type ndx = 0; ndx < ring_size; ++ndx )
+        { m_block->slots[ndx].sequence.store( ndx, std::memory_order_relaxed ); }
+      }
+
+      m_block->magic.store( block_magic, std::memory_order_release );
+      return;
+    }
+
+    // block initialized by another process, possibly still in progress.
+    block_t* block = std::launder( reinterpret_cast<block_t*>(ptr) );
+    if constexpr ( storage_t::persistent )
+    {
+      const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_storage.timeout());
+      while ( ( block->magic.load( std::memory_order_acquire ) != block_magic ) && ( std::chrono::steady_clock::now() < deadline ) )
+      { std::this_thread::sleep_for( std::chrono::milliseconds(1) ); }
+    }
+
+    if ( ( block->magic.load( std::memory_order_acquire ) != block_magic ) || ( block->layout != block_layout ) )
+    {
+      m_storage.unmap( ptr, sizeof(block_t), alignof(block_t) );
+      return;
+    }
+
+    m_block = block;
+  }
+
+  ring_buffer( const ring_buffer& ) = delete;
+  ring_buffer& operator=( const ring_buffer& ) = delete;
+
+  /**
+   * @brief With a persistent storage_t the block and the items in it are left in place.
+   */
+  inline ~ring_buffer() noexcept
+  {
+    if ( m_block == nullptr )
+      return;
+
+    if constexpr ( !storage_t::persistent )
+    { std::destroy_at( m_block ); }
+
+    m_storage.unmap( m_block, sizeof(block_t), alignof(block_t) );
+  }
+
+  /**
+   * @brief False when storage_t couldn't provide the block, ring buffer must not be used.
+   */
+  constexpr inline bool is_valid() const noexcept
+  { return ( m_block != nullptr ); }
+
+  /**
+   * @brief Write the block to its file, available only with core::mapped_storage.
+   */
+  inline bool flush() noexcept
+    requires storage_t::persistent
+  { return is_valid() && storage_t::flush( m_block, sizeof(block_t) ); }
+
+  /**
+   * @brief Max number of items that can be held at the same time.
+   */
+  static constexpr inline size_type capacity() noexcept
+  { return ring_size; }
+
+  /**
+   * @brief Number of items, approximate with core::counter_t::striped.
+   */
   constexpr inline size_type size() const noexcept
-  { return m_counter.load(std::memory_order_relaxed); }
+  { 
+    if constexpr (is_spsc)
+    {
+      // ndxRead first: ndxWrite loaded later can only be ahead of it, so the difference never wraps; 
+      // clamped since between the two loads pop() and push() can move ndxWrite more than ring_size ahead.
+      const size_type ndx_read  = m_block->ndxRead.load(std::memory_order_acquire);
+      const size_type ndx_write = m_block->ndxWrite.load(std::memory_order_acquire);
+      return std::min<size_type>( ndx_write - ndx_read, ring_size );
+    }
+
+    return m_block->counter.size(); 
+  }
+
+  /**
+   * @brief Number of items including all the push() and pop() completed before the call, 
+   *        exact with core::counter_t::striped only when no push() or pop() is in progress.
+   */
+  constexpr inline size_type quiescent_size() const noexcept
+  { 
+    if constexpr (is_spsc)
+      return size();
+
+    return m_block->counter.quiescent_size(); 
+  }
  
   /**
    * @brief This method will be specialized for both rvalue or lvalue.
    * 
    * @tparam value_type 
-   * @param data 
-   * @return true 
-   * @return false 
+   * @param data    item to be stored in the ring buffer.
+   * @return true   if @param data have been stored.
+   * @return false  if the ring buffer is full.
    */
   template<typename value_type>
   constexpr inline bool      push( value_type&& data ) noexcept
-  {
-    return _push( std::forward<value_type>(data) );
+  { return write( [&data]( slot_value_type& slot_data ) noexcept { slot_data = std::forward<value_type>(data); } ); }
+
+  /**
+   * @brief Store a new item constructed in place, directly in the slot, from @param args.
+   * 
+   * @return true   if the item have been stored.
+   * @return false  if the ring buffer is full.
+   */
+  template<typename... Args>
+  constexpr inline bool      emplace( Args&&... args ) noexcept
+  { 
+    return write( [&]( slot_value_type& slot_data ) noexcept { 
+      std::destroy_at( &slot_data ); 
+      std::construct_at( &slot_data, std::forward<Args>(args)... ); 
+    }); 
   }
  
-  /***/
+  /**
+   * @brief Extract the oldest item from the ring buffer.
+   * 
+   * @param data    output parameter updated only in case of success.
+   * @return true   if @param data have been populated.
+   * @return false  if the ring buffer is empty.
+   */
   constexpr inline bool      pop( value_type& data ) noexcept
+  { return consume( [&data]( value_type& item ) noexcept { data = std::move(item); } ); }
+
+  /**
+   * @brief Invoke @param fn on the oldest item, in place, and then release its slot; 
+   *        so the item is never copied or moved. The slot can't be reused by producers 
+   *        until @param fn returns.
+   * 
+   * @param fn      invoked as fn( value_type& ). 
+   * @return true   if @param fn have been invoked.
+   * @return false  if the ring buffer is empty.
+   */
+  template<typename fn_t>
+  constexpr inline bool      consume( fn_t&& fn ) noexcept
+  {
+    if constexpr (is_spsc)
+      return _pop_spsc( fn );
+    else
+      return _pop( fn );
+  }
+
+protected:
+
+private:
+  // push() template parameter hides value_type.
+  using slot_value_type = value_type;
+
+  /**
+   * @brief Invoke @param fn on a free slot, that is published once @param fn returns.
+   */
+  template<typename fn_t>
+  constexpr inline bool write( fn_t&& fn ) noexcept
   {
-    size_type     ndx      = m_ndxRead.fetch_add( 1, std::memory_order_seq_cst );
-    if ( ndx > items)
-      return false;
+    if constexpr (is_spsc)
+      return _push_spsc( fn );
+    else
+      return _push( fn );
+  }
 
-    if ( ndx == items )
+  /***/
+  template<typename fn_t>
+  constexpr inline bool _pop( fn_t& fn ) noexcept
+  {
+    size_type pos = m_block->ndxRead.load( order_t::relaxed );
+    slot_type* slot = nullptr;
+    for (;;)
     {
-      ndx = 0;
-      m_ndxRead.store( 1, std::memory_order_release );
+      slot = &m_block->slots[pos & index_mask];
+
+      const size_type       seq  = slot->sequence.load( order_t::acquire );
+      const difference_type diff = static_cast<difference_type>( seq - (pos + 1) );
+      if ( diff == 0 )
+      {
+        if ( m_block->ndxRead.compare_exchange_weak( pos, pos + 1, order_t::relaxed, order_t::relaxed ) )
+          break;
+      }
+      else if ( diff < 0 )
+      { return false; } // slot not yet written at this lap, ring buffer is empty.
+      else
+      { pos = m_block->ndxRead.load( order_t::relaxed ); }
     }
 
-    slot_status_t expected = slot_status_t::eFull;
+    fn( slot->data );
+
+    slot->sequence.store( pos + ring_size, order_t::release );
+    m_block->counter.sub();
+
+    return true;
+  }
 
-    if ( (*m_array)[ndx].status.compare_exchange_weak( expected, slot_status_t::eBusyForRead, std::memory_order_release, std::memory_order_acquire ) )
+  /***/
+  template<typename fn_t>
+  constexpr inline bool _push( fn_t& fn ) noexcept
+  {
+    size_type pos = m_block->ndxWrite.load( order_t::relaxed );
+    slot_type* slot = nullptr;
+    for (;;)
     {
-      data = (*m_array)[ndx].data;
+      slot = &m_block->slots[pos & index_mask];
 
-      (*m_array)[ndx].status.store( slot_status_t::eEmpty, std::memory_order_release );
-      --m_counter;
+      const size_type       seq  = slot->sequence.load( order_t::acquire );
+      const difference_type diff = static_cast<difference_type>( seq - pos );
+      if ( diff == 0 )
+      {
+        if ( m_block->ndxWrite.compare_exchange_weak( pos, pos + 1, order_t::relaxed, order_t::relaxed ) )
+          break;
+      }
+      else if ( diff < 0 )
+      { return false; } // slot not yet read at previous lap, ring buffer is full.
+      else
+      { pos = m_block->ndxWrite.load( order_t::relaxed ); }
+    }
 
-      return true;
-    } 
+    fn( slot->data );
 
-    return false;
-  }
+    slot->sequence.store( pos + 1, order_t::release );
+    m_block->counter.add();
 
-protected:
+    return true;
+  }
 
-private:
   /***/
-  template<typename value_type>
-  constexpr inline bool _push( value_type&& data ) noexcept
+  template<typename fn_t>
+  constexpr inline bool _push_spsc( fn_t& fn ) noexcept
   {
-    size_type     ndx      = m_ndxWrite.fetch_add( 1, std::memory_order_seq_cst );
-    if ( ndx > items)
-      return false;
-
-    if ( ndx == items )
+    const size_type pos = m_block->ndxWrite.load( order_t::relaxed );
+    if ( pos - m_block->cachedRead == ring_size )
     {
-      ndx = 0;
-      m_ndxWrite.store( 1, std::memory_order_release );
+      // looks full, refresh the consumer index.
+      m_block->cachedRead = m_block->ndxRead.load( order_t::acquire );
+      if ( pos - m_block->cachedRead == ring_size )
+        return false;
     }
 
-    slot_status_t expected = slot_status_t::eEmpty;
+    fn( m_block->slots[pos & index_mask].data );
 
-    if ( (*m_array)[ndx].status.compare_exchange_weak( expected, slot_status_t::eBusyForWrite, std::memory_order_release, std::memory_order_acquire ) )
-    {
-      (*m_array)[ndx].data = data;
+    m_block->ndxWrite.store( pos + 1, order_t::release );
 
-      (*m_array)[ndx].status.store( slot_status_t::eFull, std::memory_order_release );
-      ++m_counter;
+    return true;
+  }
 
-      return true;
+  /***/
+  template<typename fn_t>
+  constexpr inline bool _pop_spsc( fn_t& fn ) noexcept
+  {
+    const size_type pos = m_block->ndxRead.load( order_t::relaxed );
+    if ( pos == m_block->cachedWrite )
+    {
+      // looks empty, refresh the producer index.
+      m_block->cachedWrite = m_block->ndxWrite.load( order_t::acquire );
+      if ( pos == m_block->cachedWrite )
+        return false;
     }
 
-    return false;
+    fn( m_block->slots[pos & index_mask].data );
+
+    m_block->ndxRead.store( pos + 1, order_t::release );
+
+    return true;
   }
 
 private:
-  std::unique_ptr<std::array<slot_t, items>>  m_array;
-  
-  std::atomic<size_type>                      m_ndxWrite;
-  std::atomic<size_type>                      m_ndxRead;
-  std::atomic<size_type>                      m_counter;
+  [[no_unique_address]] storage_t m_storage;
+  block_t*                        m_block;
 };
 
 }
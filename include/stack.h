@@ -34,7 +34,10 @@
 #include "config.h"
 #include "arena_allocator.h"
 #include "core/arena_allocator.h"
+#include "core/memory_address.h"
 #include "core/types.h"
+#include "core/reclamation.h"
+#include "core/stats.h"
 
 namespace lock_free {
 
@@ -52,6 +55,8 @@ namespace lock_free {
  *                       - mutex    : the stack will used the standard std::mutex to synchronise r/e access 
  *                       - spinlock : the stack will used a spinlock mutex, exactly core::mutex 
  *                                    to synchronise r/e access 
+ *                       - adaptive : the stack will used core::adaptive_mutex that spin for a short
+ *                                    time and then park waiting threads
  *                       - lockfree : read write operation will be done using atomics and classic CAS loop.
  * @tparam chunk_size    number of data_t items to pre-alloc each time that is needed.
  * @tparam reserve_size  reserved size for the stack, this size will be reserved when the object is created.
@@ -60,15 +65,32 @@ namespace lock_free {
  * @tparam size_limit    default value is 0 that means the stack can grow until there is available memory.
  *                       A value different greater than 0 will have the effect to limit max number of items on 
  *                       the stack.
- * @tparam arena_t       lock_free::arena_allocator (default), core::arena_allocator or user defined arena allocator.
+ * @tparam arena_t       core::default_arena (default) selects a lock_free::arena_allocator that shares stats_t, so 
+ *                       its alloc_miss and chunk_growth are reported by stats(); otherwise lock_free::arena_allocator, 
+ *                       core::arena_allocator or user defined arena allocator, instrumented on its own.
+ *                       Its value_type is used as node, so nodes can be aligned to a cache line with an arena of
+ *                       core::node_t<data_t,false,true,(imp_type==core::ds_impl_t::lockfree),core::cache_line_size>.
+ * @tparam reclaimer_t   used only with lockfree implementation, core::no_reclaimer (default) return popped nodes
+ *                       to the arena immediately, that is safe as long as arena memory is never released while
+ *                       the stack is alive. core::epoch_reclaimer defers it until no thread can reference them.
+ * @tparam layout        used only with lockfree implementation, core::layout_t::padded (default) keeps _head on
+ *                       its own cache line, core::layout_t::compact packs it with other data members.
+ * @tparam order_t       used only with lockfree implementation, memory orders applied to atomic operations; 
+ *                       core::minimal_order (default) or core::seq_cst_order for debugging.
+ * @tparam stats_t       core::no_stats (default) or core::thread_stats to account CAS failures, full and empty
+ *                       outcomes, as well as spinlock and adaptive mutex events; see stats().
 */
 template<typename data_t, typename data_size_t, core::ds_impl_t imp_type, 
          data_size_t chunk_size = 1024, data_size_t reserve_size = chunk_size, data_size_t size_limit = 0,
-         typename arena_t = lock_free::arena_allocator<core::node_t<data_t,false,true,(imp_type==core::ds_impl_t::lockfree)>, data_size_t, chunk_size, reserve_size, size_limit, (chunk_size / 3), core::default_allocator<data_size_t>> >
+         typename arena_t = core::default_arena,
+         typename reclaimer_t = core::no_reclaimer,
+         core::layout_t layout = core::layout_t::padded,
+         typename order_t = core::minimal_order,
+         typename stats_t = core::no_stats >
 requires std::is_unsigned_v<data_size_t> && (std::is_same_v<data_size_t,uint32_t> || std::is_same_v<data_size_t,uint64_t>)
          && ( ((sizeof(data_t) % alignof(std::max_align_t)) == 0 ) || ((sizeof(std::max_align_t) % alignof(data_t)) == 0 ) )
-         && (chunk_size >= 1)
-class stack : core::plug_mutex<(imp_type==core::ds_impl_t::mutex)||(imp_type==core::ds_impl_t::spinlock), std::conditional_t<(imp_type==core::ds_impl_t::spinlock),core::mutex,std::mutex>>
+         && (chunk_size >= 1) && (imp_type!=core::ds_impl_t::mpsc) && core::memory_order_profile<order_t> && core::stats_policy<stats_t>
+class stack : core::plug_mutex<core::ds_has_mutex<imp_type>, core::ds_mutex_t<imp_type,stats_t>>
 {
 public:
   using value_type      = data_t; 
@@ -77,21 +99,30 @@ public:
   using const_reference = const data_t&;
   using pointer         = data_t*;
   using const_pointer   = const data_t*;
-  using node_type       = core::node_t<value_type,false,true,(imp_type==core::ds_impl_t::lockfree)>;
-  using plug_mutex_type = core::plug_mutex<(imp_type==core::ds_impl_t::mutex)||(imp_type==core::ds_impl_t::spinlock), std::conditional_t<(imp_type==core::ds_impl_t::spinlock),core::mutex,std::mutex>>;
+  using arena_type      = std::conditional_t<std::is_same_v<arena_t,core::default_arena>,
+                                             lock_free::arena_allocator<core::node_t<data_t,false,true,(imp_type==core::ds_impl_t::lockfree)>, data_size_t, chunk_size, reserve_size, size_limit, (chunk_size / 3), 
+                                                                        core::default_allocator<data_size_t>, 0, 1, core::slot_layout_t::header, core::minimal_order, stats_t>,
+                                             arena_t>;
+  using node_type       = typename arena_type::value_type;
+  using plug_mutex_type = core::plug_mutex<core::ds_has_mutex<imp_type>, core::ds_mutex_t<imp_type,stats_t>>;
   using node_addr_type  = node_type*;
-  using node_pointer    = std::conditional_t<(imp_type==core::ds_impl_t::lockfree),std::atomic<node_addr_type>,node_type*>;
-  using arena_type      = arena_t;
+  using tagged_pointer  = core::memory_address<node_type,size_type>;
+  using node_pointer    = std::conditional_t<(imp_type==core::ds_impl_t::lockfree),std::atomic<tagged_pointer>,node_type*>;
+  using node_field      = core::cache_aligned_if<node_pointer,(imp_type==core::ds_impl_t::lockfree) && (layout==core::layout_t::padded)>;
+  using reclaimer_type  = reclaimer_t;
+  using order_type      = order_t;
+  using stats_type      = stats_t;
 
 public:
   
   /***/
   constexpr inline stack()
-    : _head { nullptr }
+    : _head { }
   {
     if constexpr (imp_type==core::ds_impl_t::lockfree)
     {
-      _head.store( nullptr, std::memory_order_release );
+      static_assert(node_pointer::is_always_lock_free);
+      _head.store( tagged_pointer(), std::memory_order_release );
     }
   }
 
@@ -117,18 +148,40 @@ public:
   constexpr inline bool            empty() const noexcept
   { return (size()==0); }
 
+  /**
+   * @brief Counters collected by stats_t, merged with the ones of the arena and of the mutex 
+   *        when they provide stats(). With core::no_stats all counters are 0.
+   */
+  constexpr inline core::stats_snapshot  stats() const noexcept
+  { 
+    core::stats_snapshot result = _stats.snapshot();
+
+    if constexpr ( requires ( const arena_type& arena ) { { arena.stats() } -> std::same_as<core::stats_snapshot>; } )
+    { result += _arena.stats(); }
+
+    if constexpr ( plug_mutex_type::has_mutex )
+    {
+      if constexpr ( requires ( const typename plug_mutex_type::mutex_type& mtx ) { mtx.stats(); } )
+      { result += this->_mtx[0].stats(); }
+    }
+
+    return result;
+  }
+
   /***/
   template<typename value_type>
   constexpr inline core::result_t  push( value_type&& data ) noexcept
-  {
-    if constexpr (imp_type==core::ds_impl_t::lockfree)
-      return _push_imp_lockfree( std::move(data) );
-    
-    if constexpr (imp_type!=core::ds_impl_t::lockfree)
-      return _push_imp_default( std::move(data) );
-    
-    return core::result_t::eNotImplemented;
-  }
+  { return push_node( create_node( std::move(data) ) ); }
+
+  /**
+   * @brief Push a new element constructed in place, directly in the arena slot, from @param args.
+   * 
+   * @return core::result_t::eSuccess  if the element has been pushed.
+   *         core::result_t::eFailure  if it was not possible to allocate a new node.
+   */
+  template<typename... Args>
+  constexpr inline core::result_t  emplace( Args&&... args ) noexcept
+  { return push_node( _arena.allocate( std::in_place, std::forward<Args>(args)... ) ); }
 
   /**
    * @brief Extract first element from the stack.
@@ -140,14 +193,34 @@ public:
    *         core::result_t::eDoubleDelete  an internal double free have been detected.
    */
   constexpr inline core::result_t  pop( value_type& data ) noexcept
+  { return consume( [&data]( value_type& item ) noexcept { data = std::move(item); } ); }
+
+  /**
+   * @brief Extract first element from the stack and invoke @param fn on it, in place, 
+   *        before releasing its node; so the element is never copied or moved.
+   *        With mutex, spinlock and adaptive implementations the lock is not held by @param fn.
+   * 
+   * @param fn                              invoked as fn( value_type& ). 
+   * @return core::result_t::eEmpty         if there are no item in the stack.
+   *         core::result_t::eSuccess       if @param fn have been invoked with the element
+   *                                        extracted from stack.
+   *         core::result_t::eDoubleDelete  an internal double free have been detected.
+   */
+  template<typename fn_t>
+  constexpr inline core::result_t  consume( fn_t&& fn ) noexcept
   {
+    core::result_t result = core::result_t::eNotImplemented;
+
     if constexpr (imp_type==core::ds_impl_t::lockfree)
-      return _pop_imp_lockfree(data);
+      result = _pop_imp_lockfree( fn );
     
     if constexpr (imp_type!=core::ds_impl_t::lockfree)
-      return _pop_imp_default(data);
+      result = _pop_imp_default( fn );
     
-    return core::result_t::eNotImplemented;
+    if ( result == core::result_t::eEmpty )
+      _stats.add( core::stats_event_t::empty );
+
+    return result;
   }
 
   /**
@@ -157,7 +230,7 @@ public:
   {
     if constexpr (imp_type==core::ds_impl_t::lockfree)
     {
-      _head.store( nullptr, std::memory_order_release );
+      _head.store( tagged_pointer(), std::memory_order_release );
     }
     
     if constexpr (imp_type!=core::ds_impl_t::lockfree)
@@ -165,6 +238,8 @@ public:
       _head = nullptr;
     }
 
+    // nodes waiting for reclamation belong to the arena.
+    _reclaimer.drain();
     _arena.clear();
   }
 
@@ -178,8 +253,7 @@ public:
   {
     if constexpr (plug_mutex_type::has_mutex==true)
     { 
-      do{
-      } while ( !plug_mutex_type::template try_lock<0>() );
+      plug_mutex_type::template lock<0>();
       
       return core::result_t::eSuccess;
     }
@@ -215,6 +289,28 @@ private:
   constexpr inline node_type*         create_node ( value_type&& data ) noexcept
   { return _arena.allocate( std::move(data) ); }
 
+  /**
+   * @brief Link @param new_node on top of the stack.
+   * 
+   * @return core::result_t::eFailure if @param new_node is nullptr, core::result_t::eSuccess otherwise.
+   */
+  constexpr inline core::result_t     push_node( node_type* new_node ) noexcept
+  {
+    if ( new_node == nullptr )
+    {
+      _stats.add( core::stats_event_t::full );
+      return core::result_t::eFailure;
+    }
+
+    if constexpr (imp_type==core::ds_impl_t::lockfree)
+      return _push_imp_lockfree( new_node );
+    
+    if constexpr (imp_type!=core::ds_impl_t::lockfree)
+      return _push_imp_default( new_node );
+
+    return core::result_t::eNotImplemented;
+  }
+
   /**
    * @brief Make specified node available for future use.
    * 
@@ -223,6 +319,25 @@ private:
   constexpr inline core::result_t     destroy_node( node_type* node ) noexcept
   { return _arena.deallocate(node); }
 
+  /**
+   * @brief Release a node unlinked from the lock-free stack, through reclaimer_t.
+   *        When the release is deferred a double free can't be reported.
+   */
+  constexpr inline core::result_t     retire_node( node_type* node ) noexcept
+  {
+    if constexpr ( reclaimer_type::deferred == false )
+    { return destroy_node( node ); }
+    else
+    {
+      _reclaimer.retire( node, &stack::reclaim_node, this );
+      return core::result_t::eSuccess;
+    }
+  }
+
+  /***/
+  static inline void                  reclaim_node( void* ctx, void* node ) noexcept
+  { (void)static_cast<stack*>(ctx)->destroy_node( static_cast<node_type*>(node) ); }
+
   /***/
   constexpr inline size_type          _size_imp()  const noexcept
   { 
@@ -230,7 +345,9 @@ private:
 
     lock();
 
+    // nodes waiting for reclamation are still allocated from the arena.
     ret_value = _arena.length();
+    ret_value = ret_value - std::min<size_type>( ret_value, static_cast<size_type>(_reclaimer.pending()) );
 
     unlock();
 
@@ -238,109 +355,107 @@ private:
   }
 
   /***/
-  constexpr inline core::result_t     _push_imp_default( value_type&& data ) noexcept
+  constexpr inline core::result_t     _push_imp_default( node_type* new_node ) noexcept
   {
-    core::result_t ret_value = core::result_t::eFailure;
-
     lock();
 
-    node_type* new_node = create_node( std::move(data) );
-    if ( new_node != nullptr )
-    {
-      new_node->_next = _head;
-      _head = new_node;
-
-      ret_value = core::result_t::eSuccess;
-    }
+    new_node->_next = _head;
+    _head = new_node;
 
     unlock();
 
-    return ret_value;    
+    return core::result_t::eSuccess;    
   }
 
   /***/
-  constexpr inline core::result_t     _push_imp_lockfree( value_type&& data ) noexcept
+  constexpr inline core::result_t     _push_imp_lockfree( node_type* new_node ) noexcept
   {
-    node_type* new_node = create_node( std::move(data) );
-    if ( new_node == nullptr )
-      return core::result_t::eFailure;
-
+    // relaxed: old_head is only a guess validated by the CAS, nothing is read through it.
+    tagged_pointer old_head = _head.load( order_t::relaxed );
     for (;;)
     {
-      std::atomic_thread_fence( std::memory_order_acquire );
-      node_addr_type old_head = _head.load( std::memory_order_relaxed );
-      if ( old_head != nullptr )
-        new_node->_next.store( old_head, std::memory_order_release );
+      // relaxed: published by the release CAS below.
+      new_node->_next.store( old_head.get_address(), order_t::relaxed );
 
-      node_addr_type new_head( new_node );
+      tagged_pointer new_head = tagged_pointer::next_tag( new_node, old_head );
 
-      if ( _head.compare_exchange_weak( old_head, new_head ) == false )
-        continue; // when this fails means that _head have been modified by a different thread, so let's come back to the loop reading the new head.
+      // release publish both new_node->_next and the item to the thread that will pop it.
+      if ( _head.compare_exchange_weak( old_head, new_head, order_t::release, order_t::relaxed ) == false )
+      { _stats.add( core::stats_event_t::cas_failure ); continue; } // when this fails means that _head have been modified by a different thread, so let's come back to the loop with the new head.
 
       break;
     }
 
-    std::atomic_thread_fence( std::memory_order_release );
-
     return core::result_t::eSuccess;
   }
 
   /***/
-  constexpr inline core::result_t     _pop_imp_default( value_type& data ) noexcept
+  template<typename fn_t>
+  constexpr inline core::result_t     _pop_imp_default( fn_t& fn ) noexcept
   {
-    core::result_t ret_value = core::result_t::eEmpty;
+    node_type* first_node = nullptr;
 
     lock();
 
     if ( _head != nullptr )  
     {
-      node_type* first_node = _head;
+      first_node = _head;
       
       _head = _head->_next;
-
-      data = std::move(first_node->_data);
-      ret_value = destroy_node(first_node);
     }
 
     unlock();
 
-    return ret_value;    
+    if ( first_node == nullptr )
+      return core::result_t::eEmpty;
+
+    fn( first_node->_data );
+
+    return destroy_node(first_node);    
   }
 
   /***/
-  constexpr inline core::result_t     _pop_imp_lockfree( value_type& data ) noexcept
+  template<typename fn_t>
+  constexpr inline core::result_t     _pop_imp_lockfree( fn_t& fn ) noexcept
   {
-    node_addr_type old_head = nullptr;
+    typename reclaimer_type::guard guard( _reclaimer );
+
+    tagged_pointer old_head;
     node_addr_type new_head = nullptr;
+    // acquire pairs with the release CAS in push(), directly or through the release sequence of the 
+    // following RMWs on _head, so old_head->_next and old_head->_data are visible.
+    old_head = _head.load( order_t::acquire );
     for (;;)
     {
-      std::atomic_thread_fence( std::memory_order_acquire );
-      old_head = _head.load( std::memory_order_relaxed );
-      if ( old_head == nullptr )
+      if ( old_head.get_address() == nullptr )
         return core::result_t::eEmpty;
 
-      std::atomic_thread_fence( std::memory_order_acquire );
-      new_head = old_head->_next.load(std::memory_order_relaxed);
+      // relaxed: already ordered by the acquire that returned old_head; if old_head was popped and 
+      // reused the value is stale, but the CAS then fails.
+      new_head = old_head->_next.load( order_t::relaxed );
 
-      if ( _head.compare_exchange_weak( old_head, new_head ) == false )
-        continue;
+      // The generation tag makes the CAS fail if old_head was popped and pushed again in the meantime.
+      // acquire also on failure, since the next iteration reads _next from the returned head. No 
+      // release is needed: the node is returned to the arena, whose free list CAS publishes it.
+      if ( _head.compare_exchange_weak( old_head, tagged_pointer::next_tag( new_head, old_head ), order_t::acquire, order_t::acquire ) == false )
+      { _stats.add( core::stats_event_t::cas_failure ); continue; }
 
       break;
     };
 
-    std::atomic_thread_fence( std::memory_order_release );
-
-    data = std::move(old_head->_data);
+    fn( old_head->_data );
 
     // if old_head have been already released, this may result in 
     // a logic issue at application level. 
     // core::result_t::eDoubleFree will be returned in this case.   
-    return destroy_node(old_head);    
+    return retire_node(old_head.get_address());    
   }
 
 private:
-  arena_type     _arena;
-  node_pointer   _head;
+  arena_type                    _arena;
+  reclaimer_type                _reclaimer;
+  node_field                    _head;
+  [[no_unique_address]] stats_t _stats;
 };
 
 }
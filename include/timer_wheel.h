@@ -0,0 +1,431 @@
+/**************************************************************************************************
+ * 
+ * Copyright 2022 https://github.com/fe-dagostino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this 
+ * software and associated documentation files (the "Software"), to deal in the Software 
+ * without restriction, including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to the following 
+ * conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies 
+ * or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *************************************************************************************************/
+#ifndef LOCK_FREE_TIMER_WHEEL_H
+#define LOCK_FREE_TIMER_WHEEL_H
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <assert.h>
+#include <cstddef>
+#include <cstdint>
+
+#include "config.h"
+#include "arena_allocator.h"
+#include "core/arena_allocator.h"
+#include "core/types.h"
+
+namespace lock_free {
+
+/**
+ * @brief Node used by lock_free::timer_wheel, it is externalized in order to be used as 
+ *        data_t for the arena_allocator specified as default template parameter.
+ *        Alignment guarantee the size constraints required by arena allocators.
+ *        _state holds the timer id in the upper bits and the status in the lower 2 bits, so 
+ *        a stale handle can't cancel a different timer using the same node.
+ */
+template<typename data_t>
+struct alignas(std::max_align_t) timer_node_t
+{
+  /***/
+  template<typename... Args>
+  constexpr inline timer_node_t( uint64_t deadline, uint64_t state, Args&&... args ) noexcept
+    : _next(nullptr), _deadline(deadline), _state(state), _data( std::forward<Args>(args)... )
+  {}
+
+  timer_node_t*          _next;
+  const uint64_t         _deadline;
+  std::atomic<uint64_t>  _state;
+  data_t                 _data;
+};
+
+/***
+ * @brief A hierarchical timing wheel, ordering items by deadline.
+ *        Time is measured in ticks, whose resolution is up to the application, in example
+ *        core::utils::now<std::chrono::milliseconds>().
+ *        Any thread can schedule() and cancel() timers:
+ *        - schedule() push the timer in a list of incoming timers, with a single CAS;
+ *        - cancel() mark the timer as cancelled with a single CAS on its state, the node is 
+ *          released when the wheel reaches it.
+ *        Only one thread at time should call expire(), that place incoming timers in the wheel, 
+ *        move forward the current tick, cascading timers from the upper levels, and invoke the 
+ *        callback for each expired timer; so the wheel itself doesn't require synchronization.
+ *        Insert, cancel and expiration are O(1), each timer is cascaded at most levels-1 times.
+ * 
+ * @tparam data_t        data type held by each timer.
+ * @tparam data_size_t   data type to be used internally for counting and sizing. 
+ *                       This is required to be 32 bits or 64 bits in order to keep performances.
+ * @tparam wheel_bits    each level has 2^wheel_bits slots, 8 (default) means 256 slots.
+ * @tparam levels        number of levels, timers with a deadline farther than 2^(wheel_bits*levels) 
+ *                       ticks are cascaded again when the last level comes back to them.
+ * @tparam chunk_size    number of timers to pre-alloc each time that is needed.
+ * @tparam reserve_size  timers reserved when the object is created.
+ * @tparam size_limit    default value is 0 that means the wheel can grow until there is available memory.
+ *                       A value greater than 0 limit the max number of pending timers.
+ * @tparam arena_t       lock_free::arena_allocator (default), core::arena_allocator or user defined arena allocator.
+*/
+template<typename data_t, typename data_size_t, data_size_t wheel_bits = 8, data_size_t levels = 4,
+         data_size_t chunk_size = 1024, data_size_t reserve_size = chunk_size, data_size_t size_limit = 0,
+         typename arena_t = lock_free::arena_allocator<timer_node_t<data_t>, data_size_t, chunk_size, reserve_size, size_limit, (chunk_size / 3), core::default_allocator<data_size_t>> >
+requires std::is_unsigned_v<data_size_t> && (std::is_same_v<data_size_t,uint32_t> || std::is_same_v<data_size_t,uint64_t>)
+         && (wheel_bits >= 1) && (wheel_bits <= 16) && (levels >= 1) && ((wheel_bits * levels) < 64)
+         && (chunk_size >= 1)
+class timer_wheel
+{
+public:
+  using value_type      = data_t; 
+  using size_type       = data_size_t;
+  using tick_type       = uint64_t;
+  using node_type       = timer_node_t<value_type>;
+  using arena_type      = arena_t;
+
+  static constexpr const size_type wheel_slots = size_type(1) << wheel_bits;
+
+  /**
+   * @brief Returned by schedule() and used to cancel() a timer.
+   */
+  class handle_type final {
+  public:
+    /***/
+    constexpr inline handle_type() noexcept
+      : _node(nullptr), _id(0)
+    {}
+
+    /***/
+    constexpr inline explicit operator bool() const noexcept
+    { return (_node != nullptr); }
+
+  private:
+    friend class timer_wheel;
+
+    /***/
+    constexpr inline handle_type( node_type* node, uint64_t id ) noexcept
+      : _node(node), _id(id)
+    {}
+
+    node_type*  _node;
+    uint64_t    _id;
+  };
+
+public:
+  
+  /**
+   * @brief Constructor.
+   * 
+   * @param now   initial tick.
+   */
+  inline explicit timer_wheel( tick_type now = 0 ) noexcept
+    : _slots( new(std::nothrow) node_type*[levels * wheel_slots]() ), _incoming( nullptr ), 
+      _next_id( 1 ), _size( 0 ), _now( now ), _in_wheel( 0 )
+  {
+    static_assert(std::atomic<node_type*>::is_always_lock_free);
+    assert( _slots != nullptr );
+  }
+
+  /***/
+  inline ~timer_wheel() noexcept
+  {
+    clear();
+  }
+
+  timer_wheel( const timer_wheel& ) = delete;
+  timer_wheel& operator=( const timer_wheel& ) = delete;
+
+  /**
+   * @brief Number of timers scheduled, neither expired nor cancelled.
+   */
+  constexpr inline size_type       size()  const noexcept
+  { return _size.load( std::memory_order_acquire ); }
+
+  /**
+   * @brief Query if there are pending timers.
+   * 
+   * @return true    if there are no timers, false otherwise.
+   */
+  constexpr inline bool            empty() const noexcept
+  { return (size()==0); }
+
+  /**
+   * @brief Last tick processed by expire().
+   */
+  constexpr inline tick_type       now() const noexcept
+  { return _now.load( std::memory_order_acquire ); }
+
+  /**
+   * @brief Schedule a timer expiring at @param deadline, with data constructed from @param args.
+   *        A deadline that is already passed will expire with the next call to expire().
+   * 
+   * @param handle                     output parameter updated only in case of success.
+   * @return core::result_t::eSuccess  if the timer has been scheduled.
+   *         core::result_t::eFailure  if it was not possible to allocate a new timer.
+   */
+  template<typename... Args>
+  constexpr inline core::result_t  schedule( tick_type deadline, handle_type& handle, Args&&... args ) noexcept
+  {
+    const uint64_t id       = _next_id.fetch_add( 1, std::memory_order_relaxed );
+    node_type*     new_node = _arena.allocate( deadline, make_state( id, status_t::ePending ), std::forward<Args>(args)... );
+    if ( new_node == nullptr )
+      return core::result_t::eFailure;
+
+    _size.fetch_add( 1, std::memory_order_release );
+
+    node_type* old_head = _incoming.load( std::memory_order_relaxed );
+    do {
+      new_node->_next = old_head;
+    } while ( _incoming.compare_exchange_weak( old_head, new_node, std::memory_order_release, std::memory_order_relaxed ) == false );
+
+    handle = handle_type( new_node, id );
+
+    return core::result_t::eSuccess;
+  }
+
+  /**
+   * @brief Cancel the timer referred by @param handle.
+   * 
+   * @return core::result_t::eSuccess   if the timer has been cancelled, its callback will not be invoked.
+   *         core::result_t::eNotFound  if the timer already expired or has been cancelled.
+   */
+  constexpr inline core::result_t  cancel( const handle_type& handle ) noexcept
+  {
+    if ( handle._node == nullptr )
+      return core::result_t::eNotFound;
+
+    // nodes are never returned to the system while the wheel is alive, when the node has been 
+    // released or reused the id doesn't match and the CAS fails.
+    uint64_t expected = make_state( handle._id, status_t::ePending );
+    if ( handle._node->_state.compare_exchange_strong( expected, make_state( handle._id, status_t::eCancelled ), std::memory_order_acq_rel, std::memory_order_relaxed ) == false )
+      return core::result_t::eNotFound;
+
+    _size.fetch_sub( 1, std::memory_order_release );
+
+    return core::result_t::eSuccess;
+  }
+
+  /**
+   * @brief Move the wheel forward up to @param now, invoking @param callback for each timer with a
+   *        deadline lower or equal to @param now; timers expiring on the same tick are not ordered.
+   *        Note: only one thread at time can call this method, @param callback can schedule() 
+   *              new timers that will be evaluated with the next call.
+   * 
+   * @param callback  invoked as callback( value_type& ).
+   * @return number of expired timers.
+   */
+  template<typename callback_t>
+  constexpr inline size_type       expire( tick_type now, callback_t&& callback ) noexcept
+  {
+    size_type  expired = 0;
+    tick_type  curr    = _now.load( std::memory_order_relaxed );
+    node_type* due     = nullptr;
+
+    // place incoming timers, relative to current tick.
+    node_type* node = _incoming.exchange( nullptr, std::memory_order_acquire );
+    while ( node != nullptr )
+    {
+      node_type* next = node->_next;
+      place( curr, node, due );
+      node = next;
+    }
+
+    expired += fire( due, callback, false );
+
+    while ( curr < now )
+    {
+      // nothing to cascade, jump directly to the target tick.
+      if ( _in_wheel == 0 )
+      {
+        curr = now;
+        break;
+      }
+
+      ++curr;
+
+      // upper levels first, since they can move timers on a lower level slot cascaded on the same tick.
+      for ( size_type level = levels - 1; level > 0; --level )
+      {
+        if ( ( curr & ( (tick_type(1) << (wheel_bits * level)) - 1 ) ) == 0 )
+          cascade( curr, level );
+      }
+
+      node_type*& head = slot( 0, curr );
+      due  = head;
+      head = nullptr;
+
+      expired += fire( due, callback, true );
+    }
+
+    _now.store( curr, std::memory_order_release );
+
+    return expired;
+  }
+
+  /**
+   * @brief Remove all timers without invoking callbacks, releasing the memory.
+   *        Note: this method is not thread safe.
+   */
+  constexpr inline void            clear() noexcept
+  {
+    _incoming.store( nullptr, std::memory_order_relaxed );
+
+    for ( size_type ndx = 0; ndx < levels * wheel_slots; ++ndx )
+      _slots[ndx] = nullptr;
+
+    _in_wheel = 0;
+    _size.store( 0, std::memory_order_release );
+
+    _arena.clear();
+  }
+
+private:
+  /***/
+  enum class status_t : uint64_t {
+    ePending   = 0,
+    eCancelled = 1,
+    eExpired   = 2
+  };
+
+  /***/
+  static constexpr inline uint64_t     make_state( uint64_t id, status_t status ) noexcept
+  { return (id << 2) | static_cast<uint64_t>(status); }
+
+  /***/
+  constexpr inline node_type*&         slot( size_type level, tick_type tick ) noexcept
+  { return _slots[ (level << wheel_bits) + ( (tick >> (wheel_bits * level)) & (wheel_slots - 1) ) ]; }
+
+  /**
+   * @brief Link @param node on the level where its deadline fits, relative to @param curr,
+   *        or in @param due when its deadline is not after @param curr.
+   */
+  constexpr inline void                place( tick_type curr, node_type* node, node_type*& due ) noexcept
+  {
+    tick_type deadline = node->_deadline;
+    if ( deadline <= curr )
+    {
+      node->_next = due;
+      due         = node;
+      return;
+    }
+
+    size_type level = 0;
+    while ( ( level < levels - 1 ) && ( ( deadline - curr ) >= ( tick_type(1) << (wheel_bits * (level + 1)) ) ) )
+      ++level;
+
+    // too far, it will be placed again when the last level will reach this slot.
+    constexpr const tick_type max_delta = ( tick_type(1) << (wheel_bits * levels) ) - 1;
+    if ( ( deadline - curr ) > max_delta )
+      deadline = curr + max_delta;
+
+    node_type*& head = slot( level, deadline );
+    node->_next = head;
+    head        = node;
+
+    ++_in_wheel;
+  }
+
+  /**
+   * @brief Place again timers from the slot of @param level reached at @param curr, on lower levels.
+   */
+  constexpr inline void                cascade( tick_type curr, size_type level ) noexcept
+  {
+    node_type*& head = slot( level, curr );
+    node_type*  node = head;
+    head = nullptr;
+
+    node_type*  due  = nullptr;
+    while ( node != nullptr )
+    {
+      node_type* next = node->_next;
+      --_in_wheel;
+
+      if ( is_cancelled( node ) )
+        release( node );
+      else
+        place( curr, node, due );
+
+      node = next;
+    }
+
+    // timers with this deadline expire with the level 0 slot of the same tick.
+    while ( due != nullptr )
+    {
+      node_type* next = due->_next;
+      node_type*& first = slot( 0, curr );
+      due->_next = first;
+      first      = due;
+      ++_in_wheel;
+      due = next;
+    }
+  }
+
+  /**
+   * @brief Invoke @param callback for each timer in @param list not cancelled, releasing all nodes.
+   * 
+   * @param in_wheel  true when @param list has been taken from a wheel slot.
+   */
+  template<typename callback_t>
+  constexpr inline size_type           fire( node_type* list, callback_t& callback, bool in_wheel ) noexcept
+  {
+    size_type expired = 0;
+
+    while ( list != nullptr )
+    {
+      node_type* next = list->_next;
+      if ( in_wheel )
+        --_in_wheel;
+
+      uint64_t state = list->_state.load( std::memory_order_acquire );
+      if ( ( ( state & 3 ) == static_cast<uint64_t>(status_t::ePending) ) && 
+             list->_state.compare_exchange_strong( state, ( state & ~uint64_t(3) ) | static_cast<uint64_t>(status_t::eExpired), std::memory_order_acq_rel, std::memory_order_relaxed ) )
+      {
+        _size.fetch_sub( 1, std::memory_order_release );
+        callback( list->_data );
+        ++expired;
+      }
+
+      release( list );
+      list = next;
+    }
+
+    return expired;
+  }
+
+  /***/
+  static constexpr inline bool         is_cancelled( node_type* node ) noexcept
+  { return ( ( node->_state.load( std::memory_order_acquire ) & 3 ) == static_cast<uint64_t>(status_t::eCancelled) ); }
+
+  /***/
+  constexpr inline void                release( node_type* node ) noexcept
+  { (void)_arena.deallocate( node ); }
+
+private:
+  arena_type                    _arena;
+  std::unique_ptr<node_type*[]> _slots;
+  std::atomic<node_type*>       _incoming;
+  std::atomic<uint64_t>         _next_id;
+  std::atomic<size_type>        _size;
+  std::atomic<tick_type>        _now;
+  size_type                     _in_wheel;
+};
+
+}
+
+#endif // LOCK_FREE_TIMER_WHEEL_H
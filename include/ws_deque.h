@@ -0,0 +1,314 @@
+/**************************************************************************************************
+ * 
+ * Copyright 2022 https://github.com/fe-dagostino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this 
+ * software and associated documentation files (the "Software"), to deal in the Software 
+ * without restriction, including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to the following 
+ * conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies 
+ * or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, 
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR 
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE 
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR 
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *************************************************************************************************/
+
+#ifndef LOCK_FREE_WS_DEQUE_H
+#define LOCK_FREE_WS_DEQUE_H
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+#include "config.h"
+#include "core/memory_allocators.h"
+#include "core/types.h"
+
+namespace lock_free {
+
+/***
+ * @brief Work-stealing deque as described by Chase and Lev, with the memory orders from
+ *        "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al.).
+ *        The thread that owns the deque push() and pop() items at the bottom without 
+ *        any atomic RMW, except when only one item is left, while other threads 
+ *        steal() items from the top with a single CAS.
+ *        When the owner finds the array full it is replaced with one having double capacity;
+ *        previous arrays can still be accessed from thieves, so they are released only
+ *        when the deque is destroyed. 
+ * 
+ * @tparam data_t        data type held by the deque, it must be trivially copyable and std::atomic<data_t> 
+ *                       must be lock free, since thieves may read an item while the owner overwrite it.
+ *                       Typically this is a pointer or an handle to a task.
+ * @tparam data_size_t   data type to be used internally for counting and sizing. 
+ *                       This is required to be 32 bits or 64 bits in order to keep performances.
+ * @tparam initial_size  initial capacity, rounded up to the next power of two.
+ * @tparam allocator_t   allocator used for the arrays, core::default_allocator (default) or core::virtual_allocator.
+ */
+template<typename data_t, typename data_size_t, data_size_t initial_size = 1024,
+         typename allocator_t = core::default_allocator<data_size_t> >
+requires std::is_unsigned_v<data_size_t> && (std::is_same_v<data_size_t,uint32_t> || std::is_same_v<data_size_t,uint64_t>)
+         && std::is_trivially_copyable_v<data_t> && std::atomic<data_t>::is_always_lock_free
+         && (initial_size >= 1)
+class ws_deque
+{
+public:
+  using value_type      = data_t; 
+  using size_type       = data_size_t;
+  using reference       = data_t&;
+  using const_reference = const data_t&;
+  using pointer         = data_t*;
+  using const_pointer   = const data_t*;
+  using allocator_type  = allocator_t;
+
+private:
+  /** Positions are signed and 64 bits wide, so that bottom-1 can be lower than top and they never wrap. */
+  using index_type      = int64_t;
+  using item_type       = std::atomic<value_type>;
+
+  /**
+   * @brief Header of a circular array, items are stored right after the header in the 
+   *        same memory block.
+   */
+  struct array_t
+  {
+    /***/
+    constexpr inline array_t( size_type capacity, array_t* previous ) noexcept
+      : _mask( capacity-1 ), _retired( previous )
+    {
+      for ( size_type ndx = 0; ndx < capacity; ++ndx )
+      { new (items()+ndx) item_type(); }
+    }
+
+    /***/
+    static constexpr inline size_type memory_required( size_type capacity ) noexcept
+    { return sizeof(array_t) + capacity*sizeof(item_type); }
+
+    /***/
+    constexpr inline size_type  capacity() const noexcept
+    { return _mask+1; }
+
+    /***/
+    inline item_type*           items() noexcept
+    { return reinterpret_cast<item_type*>(this+1); }
+
+    /***/
+    inline value_type           get( index_type ndx ) noexcept
+    { return items()[static_cast<size_type>(ndx) & _mask].load( std::memory_order_relaxed ); }
+
+    /***/
+    inline void                 put( index_type ndx, const value_type& value ) noexcept
+    { items()[static_cast<size_type>(ndx) & _mask].store( value, std::memory_order_relaxed ); }
+
+    size_type   _mask;
+    array_t*    _retired;
+  };
+
+  static_assert( (sizeof(array_t) % alignof(item_type)) == 0 );
+
+public:
+  static constexpr const size_type default_capacity = std::bit_ceil(initial_size);
+
+  /***/
+  inline ws_deque() noexcept
+    : _top( 0 ), _bottom( 0 ), _array( create_array( default_capacity, nullptr ) )
+  { }
+
+  /**
+   * @brief Return false if the initial array couldn't be allocated in the constructor; in such case 
+   *        push() retries to allocate it and returns core::result_t::eFailure until it succeeds.
+   */
+  inline bool                 is_valid() const noexcept
+  { return (_array.load( std::memory_order_relaxed ) != nullptr); }
+
+  /***/
+  inline ~ws_deque() noexcept
+  {
+    array_t* curr = _array.load( std::memory_order_relaxed );
+    while ( curr != nullptr )
+    {
+      array_t* retired = curr->_retired;
+      allocator_type::deallocate( curr, array_t::memory_required( curr->capacity() ) );
+      curr = retired;
+    }
+  }
+
+  /**
+   * @brief Return an approximation of items in the deque, exact only when called from the owner
+   *        with no concurrent steal().
+   */
+  inline size_type            size() const noexcept
+  { 
+    const index_type b = _bottom.load( std::memory_order_relaxed );
+    const index_type t = _top.load( std::memory_order_relaxed );
+    return (b > t)?static_cast<size_type>(b-t):0;
+  }
+
+  /***/
+  inline bool                 empty() const noexcept
+  { return (size()==0); }
+
+  /**
+   * @brief Current capacity, it can be accessed only from the owner thread.
+   */
+  inline size_type            capacity() const noexcept
+  { 
+    const array_t* a = _array.load( std::memory_order_relaxed );
+    return (a != nullptr)?a->capacity():0; 
+  }
+
+  /**
+   * @brief Push an item at the bottom of the deque. Must be called only from the owner thread.
+   * 
+   * @param data                       item to be pushed.
+   * @return core::result_t::eSuccess  if @param data have been pushed.
+   *         core::result_t::eFailure  if the array was full, or not yet allocated, and it couldn't be allocated.
+   */
+  inline core::result_t       push( const value_type& data ) noexcept
+  {
+    const index_type b = _bottom.load( std::memory_order_relaxed );
+    const index_type t = _top.load( std::memory_order_acquire );
+    array_t*         a = _array.load( std::memory_order_relaxed );
+
+    if ( a == nullptr ) [[unlikely]]
+    {
+      // allocation failed in the constructor, retry; pop() and steal() never reach the array 
+      // while it is null since no item could have been pushed.
+      a = create_array( default_capacity, nullptr );
+      if ( a == nullptr )
+        return core::result_t::eFailure;
+      _array.store( a, std::memory_order_release );
+    }
+
+    if ( b - t > static_cast<index_type>(a->capacity()) - 1 ) [[unlikely]]
+    {
+      a = grow( a, b, t );
+      if ( a == nullptr )
+        return core::result_t::eFailure;
+    }
+
+    a->put( b, data );
+
+    std::atomic_thread_fence( std::memory_order_release );
+    _bottom.store( b + 1, std::memory_order_relaxed );
+
+    return core::result_t::eSuccess;
+  }
+
+  /**
+   * @brief Extract last pushed item from the bottom of the deque. Must be called only from the owner thread.
+   * 
+   * @param data                       output parameter updated only in case of success.
+   * @return core::result_t::eSuccess  if @param data have been populated.
+   *         core::result_t::eEmpty    if there are no items or the last one has been stolen.
+   */
+  inline core::result_t       pop( value_type& data ) noexcept
+  {
+    const index_type b = _bottom.load( std::memory_order_relaxed ) - 1;
+    array_t*         a = _array.load( std::memory_order_relaxed );
+    _bottom.store( b, std::memory_order_relaxed );
+
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    index_type       t = _top.load( std::memory_order_relaxed );
+
+    if ( t > b )
+    {
+      // deque was already empty
+      _bottom.store( b + 1, std::memory_order_relaxed );
+      return core::result_t::eEmpty;
+    }
+
+    data = a->get( b );
+
+    if ( t == b )
+    {
+      // last item, race against thieves
+      const bool won = _top.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed );
+      _bottom.store( b + 1, std::memory_order_relaxed );
+      if ( won == false )
+        return core::result_t::eEmpty;
+    }
+
+    return core::result_t::eSuccess;
+  }
+
+  /**
+   * @brief Extract the oldest item from the top of the deque. Can be called from any thread.
+   * 
+   * @param data                       output parameter updated only in case of success.
+   * @return core::result_t::eSuccess  if @param data have been populated.
+   *         core::result_t::eEmpty    if there are no items.
+   *         core::result_t::eFailure  if another thread extracted the same item first, 
+   *                                   the caller may retry or move to a different victim.
+   */
+  inline core::result_t       steal( value_type& data ) noexcept
+  {
+    index_type       t = _top.load( std::memory_order_acquire );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    const index_type b = _bottom.load( std::memory_order_acquire );
+
+    if ( t >= b )
+      return core::result_t::eEmpty;
+
+    // acquire pairs with the release store in grow(), so items copied in the new array are visible.
+    array_t*    a     = _array.load( std::memory_order_acquire );
+    value_type  value = a->get( t );
+
+    if ( _top.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) == false )
+      return core::result_t::eFailure;
+
+    data = value;
+
+    return core::result_t::eSuccess;
+  }
+
+private:
+  /***/
+  static inline array_t*      create_array( size_type capacity, array_t* previous ) noexcept
+  {
+    void* mem = allocator_type::allocate( array_t::memory_required( capacity ) );
+    if ( mem == nullptr )
+      return nullptr;
+
+    return new (mem) array_t( capacity, previous );
+  }
+
+  /**
+   * @brief Replace @param a with an array with double capacity, copying items in [@param t, @param b).
+   */
+  inline array_t*             grow( array_t* a, index_type b, index_type t ) noexcept
+  {
+    if ( a->capacity() > (std::numeric_limits<size_type>::max() / 2) ) [[unlikely]]
+      return nullptr;
+
+    array_t* new_array = create_array( a->capacity()*2, a );
+    if ( new_array == nullptr )
+      return nullptr;
+
+    for ( index_type ndx = t; ndx < b; ++ndx )
+    { new_array->put( ndx, a->get( ndx ) ); }
+
+    _array.store( new_array, std::memory_order_release );
+
+    return new_array;
+  }
+
+private:
+  alignas(core::cache_line_size) std::atomic<index_type>  _top;
+  alignas(core::cache_line_size) std::atomic<index_type>  _bottom;
+                                 std::atomic<array_t*>    _array;
+};
+
+}
+
+#endif // LOCK_FREE_WS_DEQUE_H
@@ -0,0 +1,54 @@
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+#include <iostream>
+#include <cstdlib>
+#include <thread>
+
+#include "core/types.h"
+
+/**
+ * Stop the test with a failure, reporting @param what, when @param condition is false.
+ */
+inline void check( bool condition, const char* what )
+{
+  if ( condition == false )
+  {
+    std::cerr << "FAILED: " << what << std::endl;
+    std::exit( EXIT_FAILURE );
+  }
+}
+
+/***/
+constexpr inline bool failed( core::result_t result ) noexcept
+{ return ( result == core::result_t::eFailure ); }
+
+/***/
+constexpr inline bool failed( bool result ) noexcept
+{ return ( result == false ); }
+
+/***/
+template<typename data_t>
+constexpr inline bool failed( data_t* result ) noexcept
+{ return ( result == nullptr ); }
+
+/**
+ * Invoke @param fn until it doesn't fail: push(), insert(), allocate() and similar calls fail
+ * while the container is full or arena_allocator waits for refill_service to allocate a new chunk.
+ *
+ * @return the first result that is not a failure.
+ */
+template<typename fn_t>
+inline auto retry( fn_t&& fn )
+{
+  auto result = fn();
+  while ( failed( result ) )
+  {
+    std::this_thread::yield();
+    result = fn();
+  }
+
+  return result;
+}
+
+#endif // TESTS_CHECK_H
@@ -0,0 +1,181 @@
+#include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "hash_map.h"
+#include "check.h"
+
+/**
+ * Keys colliding on the same bucket, since the hash is the key itself and there are few buckets.
+ */
+struct identity_hash
+{
+  std::size_t operator()( uint64_t key ) const noexcept
+  { return static_cast<std::size_t>(key); }
+};
+
+/**
+ * insert() retried while arena_allocator waits for refill_service.
+ */
+template<typename map_type>
+static core::result_t insert( map_type& map, uint64_t key, uint64_t value )
+{ return retry( [&]() { return map.insert( key, value ); } ); }
+
+using hash_map_t   = lock_free::hash_map<uint64_t,uint64_t,uint32_t,1024>;
+using collisions_t = lock_free::hash_map<uint64_t,uint64_t,uint32_t,4,1024,1024,0,identity_hash>;
+
+/**
+ * Single thread, insert(), find(), contains() and erase() outcomes.
+ */
+template<typename map_type>
+static void test_basic()
+{
+  map_type map;
+  uint64_t value = 0;
+
+  check( map.empty()                                           , "empty after construction" );
+  check( map.find( 1, value ) == core::result_t::eNotFound     , "find() on an empty map" );
+  check( map.erase( 1 ) == core::result_t::eNotFound           , "erase() on an empty map" );
+
+  for ( uint64_t key = 0; key < 256; ++key )
+  { check( map.insert( key, key * 2 ) == core::result_t::eSuccess, "insert() new key" ); }
+
+  check( map.size() == 256                                     , "size() after insert()" );
+  check( map.insert( 7, uint64_t(0) ) == core::result_t::eAlreadyExists, "insert() existing key" );
+  check( map.find( 7, value ) == core::result_t::eSuccess && value == 14, "insert() existing key keeps the value" );
+
+  for ( uint64_t key = 0; key < 256; ++key )
+  { check( map.find( key, value ) == core::result_t::eSuccess && value == key * 2, "find() inserted key" ); }
+  check( map.contains( 256 ) == false                          , "contains() missing key" );
+
+  // erase odd keys, even ones must be still reachable in the same buckets.
+  for ( uint64_t key = 1; key < 256; key += 2 )
+  { check( map.erase( key ) == core::result_t::eSuccess, "erase() present key" ); }
+  check( map.erase( 1 ) == core::result_t::eNotFound           , "erase() twice" );
+  check( map.size() == 128                                     , "size() after erase()" );
+
+  for ( uint64_t key = 0; key < 256; ++key )
+  { check( map.contains( key ) == ( (key % 2) == 0 ), "contains() after erase()" ); }
+
+  check( map.insert( 1, uint64_t(100) ) == core::result_t::eSuccess, "insert() erased key" );
+  check( map.find( 1, value ) == core::result_t::eSuccess && value == 100, "find() key inserted again" );
+
+  map.clear();
+  check( map.empty() && !map.contains( 0 )                     , "clear()" );
+  check( insert( map, 0, 1 ) == core::result_t::eSuccess       , "insert() after clear()" );
+}
+
+/**
+ * Each thread owns a range of keys that is inserted, looked up and erased while other
+ * threads do the same on keys sharing the same buckets.
+ */
+template<typename map_type>
+static void test_concurrent_disjoint()
+{
+  constexpr uint64_t nthreads = 4;
+  constexpr uint64_t keys     = 512;
+  constexpr uint64_t rounds   = 50;
+
+  map_type                 map;
+  std::atomic<uint64_t>    errors{0};
+  std::vector<std::thread> threads;
+
+  for ( uint64_t tid = 0; tid < nthreads; ++tid )
+  {
+    threads.emplace_back( [&map,&errors,tid]() {
+      uint64_t value = 0;
+      for ( uint64_t round = 0; round < rounds; ++round )
+      {
+        for ( uint64_t key = tid; key < keys * nthreads; key += nthreads )
+        {
+          if ( insert( map, key, key + round ) != core::result_t::eSuccess )
+            ++errors;
+        }
+
+        for ( uint64_t key = tid; key < keys * nthreads; key += nthreads )
+        {
+          if ( ( map.find( key, value ) != core::result_t::eSuccess ) || ( value != key + round ) )
+            ++errors;
+        }
+
+        for ( uint64_t key = tid; key < keys * nthreads; key += nthreads )
+        {
+          if ( map.erase( key ) != core::result_t::eSuccess )
+            ++errors;
+          if ( map.contains( key ) )
+            ++errors;
+        }
+      }
+    } );
+  }
+
+  for ( auto& thread : threads )
+  { thread.join(); }
+
+  check( errors.load() == 0                                    , "concurrent insert()/find()/erase() on disjoint keys" );
+  check( map.empty()                                           , "map empty after concurrent erase()" );
+}
+
+/**
+ * All threads compete on the same keys, each insert() and erase() must succeed exactly once.
+ */
+template<typename map_type>
+static void test_concurrent_shared()
+{
+  constexpr uint64_t nthreads = 4;
+  constexpr uint64_t keys     = 1024;
+  constexpr uint64_t rounds   = 20;
+
+  map_type                 map;
+  std::atomic<uint64_t>    inserted{0};
+  std::atomic<uint64_t>    erased{0};
+  std::atomic<uint64_t>    errors{0};
+  std::vector<std::thread> threads;
+
+  for ( uint64_t tid = 0; tid < nthreads; ++tid )
+  {
+    threads.emplace_back( [&]() {
+      uint64_t value = 0;
+      for ( uint64_t round = 0; round < rounds; ++round )
+      {
+        for ( uint64_t key = 0; key < keys; ++key )
+        {
+          if ( insert( map, key, key * 3 ) == core::result_t::eSuccess )
+            ++inserted;
+
+          // a value is never seen partially constructed.
+          if ( ( map.find( key, value ) == core::result_t::eSuccess ) && ( value != key * 3 ) )
+            ++errors;
+
+          if ( map.erase( key ) == core::result_t::eSuccess )
+            ++erased;
+        }
+      }
+    } );
+  }
+
+  for ( auto& thread : threads )
+  { thread.join(); }
+
+  check( errors.load() == 0                                    , "concurrent find() returned a wrong value" );
+  check( inserted.load() == erased.load()                      , "concurrent insert() and erase() on shared keys" );
+  check( map.empty()                                           , "map empty after concurrent insert() and erase()" );
+}
+
+int main()
+{
+  test_basic<hash_map_t>();
+  test_basic<collisions_t>();
+
+  test_concurrent_disjoint<hash_map_t>();
+  test_concurrent_disjoint<collisions_t>();
+
+  test_concurrent_shared<hash_map_t>();
+  test_concurrent_shared<collisions_t>();
+
+  std::cout << "hash_map: all tests passed" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,317 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "queue.h"
+#include "core/reclamation.h"
+#include "check.h"
+
+using node_t    = core::node_t<uint64_t,false,true,true>;
+using arena_t   = lock_free::arena_allocator<node_t, uint32_t, 1024, 1024, 0, 341>;
+
+template<typename order_t>
+using queue_t   = lock_free::queue<uint64_t, uint32_t, core::ds_impl_t::lockfree, 1024, 1024, 0, arena_t, core::epoch_reclaimer<>, core::layout_t::padded, order_t>;
+
+using mpsc_t    = lock_free::queue<uint64_t, uint32_t, core::ds_impl_t::mpsc>;
+
+// reclaimer_t is used only by the lockfree implementation, where consumers and producers run 
+// concurrently; collect_rate is below size_limit so that retired nodes give room back early.
+template<core::ds_impl_t imp_type>
+using bounded_t = lock_free::queue<uint64_t, uint32_t, imp_type, 64, 64, 64, core::default_arena, core::epoch_reclaimer<16>>;
+
+/**
+ * Single thread, items are extracted in fifo order both from pop() and pop_bulk().
+ */
+template<typename queue_type>
+static void test_fifo()
+{
+  queue_type queue;
+  uint64_t value = 0;
+
+  check( queue.pop( value ) == core::result_t::eEmpty, "pop() from an empty queue" );
+
+  for ( uint64_t i = 0; i < 100; ++i )
+  { check( queue.push( uint64_t(i) ) == core::result_t::eSuccess, "push()" ); }
+
+  check( queue.pop( value ) == core::result_t::eSuccess && value == 0, "pop() first item" );
+
+  uint64_t expected = 1;
+  uint64_t items[16];
+  while ( expected < 100 )
+  {
+    const std::size_t count = queue.pop_bulk( items, 16 );
+    check( count > 0, "pop_bulk() with items in the queue" );
+    for ( std::size_t i = 0; i < count; ++i )
+    { check( items[i] == expected++, "pop_bulk() order" ); }
+  }
+
+  check( queue.pop_bulk( items, 16 ) == 0, "pop_bulk() from an empty queue" );
+  check( queue.push( uint64_t(100) ) == core::result_t::eSuccess, "push() after drain" );
+  check( queue.pop( value ) == core::result_t::eSuccess && value == 100, "pop() after drain" );
+}
+
+/**
+ * Producers and consumers run concurrently, the queue repeatedly goes empty so the last node is
+ * extracted while producers are linking new ones; all items must be received exactly once.
+ */
+template<typename queue_type>
+static void test_concurrent( bool use_bulk )
+{
+  constexpr uint64_t producers = 3;
+  constexpr uint64_t consumers = 3;
+  constexpr uint64_t items     = 100000;
+  constexpr uint64_t total     = producers * items;
+
+  queue_type               queue;
+  std::atomic<uint64_t>    popped{0};
+  std::atomic<uint64_t>    sum{0};
+  std::vector<std::thread> threads;
+
+  for ( uint64_t p = 0; p < producers; ++p )
+  {
+    threads.emplace_back( [&queue,p]() {
+      for ( uint64_t i = 0; i < items; ++i )
+      { (void)retry( [&]() { return queue.push( p*items + i + 1 ); } ); }
+    } );
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  for ( uint64_t c = 0; c < consumers; ++c )
+  {
+    threads.emplace_back( [&queue,&popped,&sum,use_bulk,deadline]() {
+      uint64_t buffer[16];
+      while ( ( popped.load() < total ) && ( std::chrono::steady_clock::now() < deadline ) )
+      {
+        std::size_t count = 0;
+        if ( use_bulk )
+          count = queue.pop_bulk( buffer, 16 );
+        else
+          count = ( queue.pop( buffer[0] ) == core::result_t::eSuccess )?1:0;
+
+        for ( std::size_t i = 0; i < count; ++i )
+        { sum += buffer[i]; }
+        popped += count;
+
+        if ( count == 0 )
+          std::this_thread::yield();
+      }
+    } );
+  }
+
+  for ( auto& thread : threads )
+  { thread.join(); }
+
+  check( popped.load() == total       , use_bulk?"concurrent push() and pop_bulk(), items lost":"concurrent push() and pop(), items lost" );
+  check( sum.load() == total*(total+1)/2, "concurrent push() and pop(), items duplicated" );
+  check( queue.empty()                  , "queue empty after test" );
+}
+
+/**
+ * Producers push concurrently while a single consumer extracts, items of each producer
+ * must be received in the same order they have been pushed.
+ */
+template<typename queue_type>
+static void test_single_consumer()
+{
+  constexpr uint64_t producers = 3;
+  constexpr uint64_t items     = 100000;
+  constexpr uint64_t total     = producers * items;
+
+  queue_type               queue;
+  std::vector<std::thread> threads;
+
+  for ( uint64_t p = 0; p < producers; ++p )
+  {
+    threads.emplace_back( [&queue,p]() {
+      for ( uint64_t i = 0; i < items; ++i )
+      { (void)retry( [&]() { return queue.push( p*items + i + 1 ); } ); }
+    } );
+  }
+
+  uint64_t   last[producers] = {};
+  uint64_t   popped = 0;
+  uint64_t   sum    = 0;
+  uint64_t   value  = 0;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  while ( ( popped < total ) && ( std::chrono::steady_clock::now() < deadline ) )
+  {
+    if ( queue.pop( value ) != core::result_t::eSuccess )
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    const uint64_t p = ( value - 1 ) / items;
+    check( value > last[p]                                     , "single consumer, items out of order" );
+    last[p] = value;
+
+    sum += value;
+    ++popped;
+  }
+
+  for ( auto& thread : threads )
+  { thread.join(); }
+
+  check( popped == total                                       , "single consumer, items lost" );
+  check( sum == total*(total+1)/2                              , "single consumer, items duplicated" );
+  check( queue.empty()                                         , "queue empty after test" );
+}
+
+/**
+ * With size_limit, push_wait() expires on a full queue and otherwise waits until the consumer
+ * releases a node; producers never receive eTimeout while the consumer is running.
+ */
+template<typename queue_type>
+static void test_push_wait()
+{
+  constexpr uint64_t producers = 3;
+  constexpr uint64_t items     = 20000;
+  constexpr uint64_t total     = producers * items;
+
+  queue_type queue;
+  uint64_t   value = 0;
+  uint64_t   count = 0;
+
+  while ( queue.push( uint64_t(count) ) == core::result_t::eSuccess )
+  { ++count; }
+  check( count > 0                                             , "push() before the queue is full" );
+  check( queue.push_wait( uint64_t(0), 20 ) == core::result_t::eTimeout, "push_wait() on a full queue" );
+
+  while ( queue.pop( value ) == core::result_t::eSuccess )
+  {}
+
+  std::atomic<uint64_t>    timeouts{0};
+  std::vector<std::thread> threads;
+
+  for ( uint64_t p = 0; p < producers; ++p )
+  {
+    threads.emplace_back( [&queue,&timeouts,p]() {
+      for ( uint64_t i = 0; i < items; )
+      {
+        if ( queue.push_wait( p*items + i + 1, 10000 ) == core::result_t::eSuccess )
+          ++i;
+        else
+          ++timeouts;
+      }
+    } );
+  }
+
+  uint64_t   popped   = 0;
+  uint64_t   sum      = 0;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  while ( ( popped < total ) && ( std::chrono::steady_clock::now() < deadline ) )
+  {
+    if ( queue.pop( value ) != core::result_t::eSuccess )
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    sum += value;
+    ++popped;
+  }
+
+  for ( auto& thread : threads )
+  { thread.join(); }
+
+  check( timeouts.load() == 0                                  , "push_wait() timeout with a running consumer" );
+  check( popped == total                                       , "push_wait(), items lost" );
+  check( sum == total*(total+1)/2                              , "push_wait(), items duplicated" );
+}
+
+/**
+ * Element without default constructor and assignments, counting the move constructions.
+ */
+struct movable_t
+{
+  static inline uint32_t moves = 0;
+
+  explicit movable_t( uint64_t v ) noexcept
+    : value(v)
+  {}
+
+  movable_t( movable_t&& rhs ) noexcept
+    : value(rhs.value)
+  { ++moves; }
+
+  movable_t( const movable_t& ) = delete;
+  movable_t& operator=( const movable_t& ) = delete;
+  movable_t& operator=( movable_t&& ) = delete;
+
+  uint64_t  value;
+};
+
+/**
+ * push_bulk() constructs each node in place from the range, with both forward and single 
+ * pass iterators, and with size_limit it pushes only the elements that fit the queue.
+ */
+template<core::ds_impl_t imp_type>
+static void test_push_bulk()
+{
+  lock_free::queue<movable_t, uint32_t, imp_type> queue;
+  std::vector<movable_t>                          items;
+  for ( uint64_t i = 0; i < 150; ++i )
+  { items.emplace_back( i ); }
+
+  movable_t::moves = 0;
+  check( queue.push_bulk( items.begin(), items.end() ) == 150  , "push_bulk() forward range" );
+  check( movable_t::moves == 150                               , "push_bulk() moves each element once" );
+
+  uint64_t expected = 0;
+  while ( queue.consume( [&expected]( movable_t& item ) noexcept { check( item.value == expected++, "push_bulk() order" ); } ) == core::result_t::eSuccess )
+  {}
+  check( expected == 150                                       , "push_bulk() items extracted" );
+
+  std::istringstream                             input( "1 2 3 4 5" );
+  lock_free::queue<uint64_t, uint32_t, imp_type> values;
+  check( values.push_bulk( std::istream_iterator<uint64_t>( input ), std::istream_iterator<uint64_t>() ) == 5, "push_bulk() input range" );
+
+  // single thread, popped nodes can go back to the arena immediately.
+  lock_free::queue<uint64_t, uint32_t, imp_type, 64, 64, 64> bounded;
+  std::vector<uint64_t>                                      many( 100, 1 );
+  const uint32_t pushed = bounded.push_bulk( many.begin(), many.end() );
+  check( pushed > 0 && pushed < many.size()                    , "push_bulk() limited by size_limit" );
+  check( bounded.push( uint64_t(0) ) == core::result_t::eFailure, "push_bulk() filled the queue" );
+
+  uint64_t value = 0;
+  check( bounded.pop( value ) == core::result_t::eSuccess      , "pop() after push_bulk()" );
+  check( bounded.push_bulk( many.begin(), many.begin() + 1 ) == 1, "push_bulk() the room of a single node" );
+}
+
+template<typename queue_type>
+static void run()
+{
+  test_fifo<queue_type>();
+
+  for ( int round = 0; round < 3; ++round )
+  {
+    test_concurrent<queue_type>( false );
+    test_concurrent<queue_type>( true  );
+  }
+}
+
+int main()
+{
+  run<queue_t<core::minimal_order>>();
+  run<queue_t<core::seq_cst_order>>();
+
+  test_fifo<mpsc_t>();
+  test_single_consumer<mpsc_t>();
+  test_single_consumer<queue_t<core::minimal_order>>();
+
+  test_push_bulk<core::ds_impl_t::mutex>();
+  test_push_bulk<core::ds_impl_t::lockfree>();
+
+  test_push_wait<bounded_t<core::ds_impl_t::mutex>>();
+  test_push_wait<bounded_t<core::ds_impl_t::lockfree>>();
+  test_push_wait<bounded_t<core::ds_impl_t::mpsc>>();
+
+  std::cout << "queue: all tests passed" << std::endl;
+
+  return 0;
+}
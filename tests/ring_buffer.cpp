@@ -0,0 +1,188 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ring_buffer.h"
+#include "check.h"
+
+template<core::access_t access>
+using heap_ring_t   = lock_free::ring_buffer<uint64_t,uint32_t,1024,access>;
+
+template<core::access_t access, uint32_t items = 1024>
+using mapped_ring_t = lock_free::ring_buffer<uint64_t,uint32_t,items,access,core::counter_t::exact,core::minimal_order,core::mapped_storage>;
+
+/**
+ * An item removed before its insertion is counted, as a consumer can do with push() publishing 
+ * the slot before counter.add(), never makes size() wrap around.
+ */
+template<core::counter_t policy>
+static void test_counter()
+{
+  core::counter<uint32_t,policy> counter;
+
+  counter.sub();
+  check( counter.size() == 0 && counter.quiescent_size() == 0  , "counter removed before added" );
+  counter.add();
+  check( counter.size() == 0                                   , "counter after late add()" );
+  counter.add( 3 );
+  check( counter.size() == 3                                   , "counter add()" );
+}
+
+/**
+ * Single thread, full and empty outcomes and fifo order across laps.
+ */
+template<typename ring_type>
+static void test_fifo( ring_type& rbuffer )
+{
+  uint64_t value = 0;
+
+  check( rbuffer.is_valid()                                    , "is_valid()" );
+  check( rbuffer.pop( value ) == false                         , "pop() from an empty ring buffer" );
+
+  for ( uint64_t lap = 0; lap < 3; ++lap )
+  {
+    for ( uint64_t ndx = 0; ndx < ring_type::capacity(); ++ndx )
+    { check( rbuffer.push( lap * 10000 + ndx ), "push() with room" ); }
+
+    check( rbuffer.push( uint64_t(0) ) == false                , "push() in a full ring buffer" );
+    check( rbuffer.size() == ring_type::capacity()             , "size() of a full ring buffer" );
+
+    for ( uint64_t ndx = 0; ndx < ring_type::capacity(); ++ndx )
+    { check( rbuffer.pop( value ) && value == lap * 10000 + ndx, "pop() order" ); }
+
+    check( rbuffer.pop( value ) == false && rbuffer.size() == 0, "pop() after drain" );
+  }
+}
+
+/**
+ * Producers and consumers run concurrently, all items must be received exactly once and,
+ * with a single producer, in order.
+ */
+template<typename ring_type>
+static void test_concurrent( ring_type& producer_side, ring_type& consumer_side, uint64_t producers, uint64_t consumers )
+{
+  constexpr uint64_t items = 200000;
+  const uint64_t     total = producers * items;
+
+  std::atomic<uint64_t>    popped{0};
+  std::atomic<uint64_t>    sum{0};
+  std::atomic<uint64_t>    errors{0};
+  std::vector<std::thread> threads;
+
+  for ( uint64_t p = 0; p < producers; ++p )
+  {
+    threads.emplace_back( [&producer_side,p]() {
+      for ( uint64_t ndx = 0; ndx < items; ++ndx )
+      {
+        (void)retry( [&]() { return producer_side.push( p*items + ndx + 1 ); } );
+      }
+    } );
+  }
+
+  for ( uint64_t c = 0; c < consumers; ++c )
+  {
+    threads.emplace_back( [&consumer_side,&popped,&sum,&errors,total,producers]() {
+      uint64_t value = 0;
+      uint64_t last  = 0;
+      while ( popped.load() < total )
+      {
+        if ( consumer_side.pop( value ) == false )
+        {
+          std::this_thread::yield();
+          continue;
+        }
+
+        if ( ( producers == 1 ) && ( value <= last ) )
+          ++errors;
+        last = value;
+
+        sum += value;
+        ++popped;
+      }
+    } );
+  }
+
+  for ( auto& thread : threads )
+  { thread.join(); }
+
+  check( errors.load() == 0                                    , "concurrent push() and pop(), items out of order" );
+  check( popped.load() == total                                , "concurrent push() and pop(), items lost" );
+  check( sum.load() == total*(total+1)/2                       , "concurrent push() and pop(), items duplicated" );
+  check( consumer_side.size() == 0                             , "ring buffer empty after test" );
+}
+
+/**
+ * Items survive the ring buffer that pushed them, and the file can be mapped by more
+ * ring buffers at the same time, as cooperating processes do.
+ */
+template<core::access_t access>
+static void test_mapped( uint64_t producers, uint64_t consumers )
+{
+  using ring_type = mapped_ring_t<access>;
+
+  const std::string path = ( std::filesystem::temp_directory_path() / ( "lf_test_ring_buffer_" + std::to_string( std::chrono::steady_clock::now().time_since_epoch().count() ) ) ).string();
+  (void)core::mapped_storage::remove( path );
+
+  {
+    ring_type rbuffer( (core::mapped_storage(path)) );
+    test_fifo( rbuffer );
+
+    for ( uint64_t ndx = 0; ndx < 100; ++ndx )
+    { check( rbuffer.push( ndx ), "push() in a mapped ring buffer" ); }
+    check( rbuffer.flush()                                     , "flush()" );
+  }
+
+  {
+    ring_type rbuffer( (core::mapped_storage(path)) );
+    check( rbuffer.is_valid() && rbuffer.size() == 100         , "pending items found by a new mapping" );
+
+    uint64_t value = 0;
+    for ( uint64_t ndx = 0; ndx < 100; ++ndx )
+    { check( rbuffer.pop( value ) && value == ndx, "pop() pending items" ); }
+  }
+
+  {
+    ring_type producer_side( (core::mapped_storage(path)) );
+    ring_type consumer_side( (core::mapped_storage(path)) );
+    check( producer_side.is_valid() && consumer_side.is_valid(), "same file mapped twice" );
+    test_concurrent( producer_side, consumer_side, producers, consumers );
+  }
+
+  {
+    mapped_ring_t<access,64> rbuffer( (core::mapped_storage(path)) );
+    check( rbuffer.is_valid() == false                         , "file mapped with a different geometry" );
+  }
+
+  check( core::mapped_storage::remove( path )                  , "remove()" );
+}
+
+int main()
+{
+  test_counter<core::counter_t::exact>();
+  test_counter<core::counter_t::striped>();
+
+  {
+    heap_ring_t<core::access_t::mpmc> rbuffer;
+    test_fifo( rbuffer );
+    test_concurrent( rbuffer, rbuffer, 2, 2 );
+    test_concurrent( rbuffer, rbuffer, 1, 1 );
+  }
+
+  {
+    heap_ring_t<core::access_t::spsc> rbuffer;
+    test_fifo( rbuffer );
+    test_concurrent( rbuffer, rbuffer, 1, 1 );
+  }
+
+  test_mapped<core::access_t::mpmc>( 2, 2 );
+  test_mapped<core::access_t::spsc>( 1, 1 );
+
+  std::cout << "ring_buffer: all tests passed" << std::endl;
+
+  return 0;
+}
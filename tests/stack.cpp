@@ -0,0 +1,98 @@
+#include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "stack.h"
+#include "core/reclamation.h"
+#include "check.h"
+
+template<typename reclaimer_t, typename order_t>
+using stack_t = lock_free::stack<uint64_t, uint32_t, core::ds_impl_t::lockfree, 1024, 1024, 0, core::default_arena, reclaimer_t, core::layout_t::padded, order_t>;
+
+/**
+ * Single thread, items are extracted in lifo order.
+ */
+template<typename stack_type>
+static void test_lifo()
+{
+  stack_type stack;
+  uint64_t   value = 0;
+
+  check( stack.pop( value ) == core::result_t::eEmpty, "pop() from an empty stack" );
+
+  for ( uint64_t i = 0; i < 100; ++i )
+  { check( stack.push( uint64_t(i) ) == core::result_t::eSuccess, "push()" ); }
+
+  for ( uint64_t i = 100; i > 0; --i )
+  { check( ( stack.pop( value ) == core::result_t::eSuccess ) && ( value == i-1 ), "pop() order" ); }
+
+  check( stack.pop( value ) == core::result_t::eEmpty, "pop() after drain" );
+}
+
+/**
+ * Each thread pushes and pops concurrently with the others, so popped nodes are immediately 
+ * reused by the arena; all items must be received exactly once.
+ */
+template<typename stack_type>
+static void test_concurrent()
+{
+  constexpr uint64_t threads_nb = 4;
+  constexpr uint64_t items      = 100000;
+  constexpr uint64_t total      = threads_nb * items;
+
+  stack_type               stack;
+  std::atomic<uint64_t>    popped{0};
+  std::atomic<uint64_t>    sum{0};
+  std::vector<std::thread> threads;
+
+  for ( uint64_t t = 0; t < threads_nb; ++t )
+  {
+    threads.emplace_back( [&stack,&popped,&sum,t]() {
+      uint64_t value = 0;
+      for ( uint64_t i = 0; i < items; ++i )
+      {
+        (void)retry( [&]() { return stack.push( t*items + i + 1 ); } );
+
+        if ( stack.pop( value ) == core::result_t::eSuccess )
+        { 
+          sum += value;
+          ++popped;
+        }
+      }
+    } );
+  }
+
+  for ( auto& thread : threads )
+  { thread.join(); }
+
+  uint64_t value = 0;
+  while ( stack.pop( value ) == core::result_t::eSuccess )
+  { 
+    sum += value;
+    ++popped;
+  }
+
+  check( popped.load() == total         , "concurrent push() and pop(), items lost" );
+  check( sum.load() == total*(total+1)/2, "concurrent push() and pop(), items duplicated" );
+}
+
+template<typename stack_type>
+static void run()
+{
+  test_lifo<stack_type>();
+  for ( int round = 0; round < 3; ++round )
+  { test_concurrent<stack_type>(); }
+}
+
+int main()
+{
+  run<stack_t<core::no_reclaimer,      core::minimal_order>>();
+  run<stack_t<core::epoch_reclaimer<>, core::minimal_order>>();
+  run<stack_t<core::no_reclaimer,      core::seq_cst_order>>();
+
+  std::cout << "stack: all tests passed" << std::endl;
+
+  return 0;
+}
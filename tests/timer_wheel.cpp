@@ -0,0 +1,143 @@
+#include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "timer_wheel.h"
+#include "check.h"
+
+// 16 slots on 3 levels, deadlines beyond 4096 ticks are cascaded again from the last level.
+using timer_wheel_t = lock_free::timer_wheel<uint64_t,uint32_t,4,3>;
+
+/**
+ * schedule() retried while arena_allocator waits for refill_service.
+ */
+static void schedule( timer_wheel_t& wheel, uint64_t deadline, timer_wheel_t::handle_type& handle )
+{ (void)retry( [&]() { return wheel.schedule( deadline, handle, deadline ); } ); }
+
+/**
+ * Moving one tick at time, each timer expires exactly at its deadline, also when it has been
+ * cascaded from upper levels or it is farther than the wheel range.
+ */
+static void test_expire()
+{
+  timer_wheel_t               wheel;
+  timer_wheel_t::handle_type  handle;
+  uint64_t                    fired  = 0;
+  uint64_t                    errors = 0;
+  uint64_t                    curr   = 0;
+
+  const uint64_t deadlines[] = { 0, 1, 15, 16, 17, 255, 256, 300, 4095, 4096, 5000, 10000 };
+  for ( uint64_t deadline : deadlines )
+  { schedule( wheel, deadline, handle ); }
+
+  check( wheel.size() == std::size(deadlines)                  , "size() after schedule()" );
+
+  for ( curr = 0; curr <= 10000; ++curr )
+  {
+    fired += wheel.expire( curr, [&]( uint64_t& deadline ) {
+      if ( deadline != curr )
+        ++errors;
+    } );
+  }
+
+  check( errors == 0                                           , "timer expired at a different tick" );
+  check( fired  == std::size(deadlines)                        , "all timers expired" );
+  check( wheel.empty() && wheel.now() == 10000                 , "wheel empty after expire()" );
+
+  // a deadline already passed expires with the next call.
+  schedule( wheel, 10, handle );
+  check( wheel.expire( 10000, []( uint64_t& ) {} ) == 1        , "expire() past deadline" );
+
+  // a single call moving over many ticks expires all timers in between.
+  for ( uint64_t deadline = 10001; deadline <= 20000; deadline += 7 )
+  { schedule( wheel, deadline, handle ); }
+  const uint64_t pending = wheel.size();
+  check( wheel.expire( 15000, []( uint64_t& ) {} ) + wheel.size() == pending, "expire() over many ticks, partial" );
+  check( wheel.expire( 20000, []( uint64_t& ) {} ) > 0 && wheel.empty(), "expire() over many ticks" );
+}
+
+/**
+ * A cancelled timer never fires, and its handle can't cancel a different timer reusing the node.
+ */
+static void test_cancel()
+{
+  timer_wheel_t               wheel;
+  timer_wheel_t::handle_type  handle_a;
+  timer_wheel_t::handle_type  handle_b;
+  timer_wheel_t::handle_type  handle_c;
+  uint64_t                    fired = 0;
+
+  check( wheel.cancel( handle_a ) == core::result_t::eNotFound , "cancel() empty handle" );
+
+  schedule( wheel, 100, handle_a );
+  schedule( wheel, 200, handle_b );
+  check( wheel.cancel( handle_a ) == core::result_t::eSuccess  , "cancel() pending timer" );
+  check( wheel.cancel( handle_a ) == core::result_t::eNotFound , "cancel() twice" );
+  check( wheel.size() == 1                                     , "size() after cancel()" );
+
+  wheel.expire( 300, [&]( uint64_t& deadline ) {
+    check( deadline == 200, "cancelled timer fired" );
+    ++fired;
+  } );
+  check( fired == 1                                            , "timer not cancelled fired" );
+  check( wheel.cancel( handle_b ) == core::result_t::eNotFound , "cancel() expired timer" );
+
+  // the node released for handle_a can now be reused.
+  schedule( wheel, 400, handle_c );
+  check( wheel.cancel( handle_a ) == core::result_t::eNotFound , "cancel() stale handle" );
+  check( wheel.cancel( handle_b ) == core::result_t::eNotFound , "cancel() stale handle" );
+  check( wheel.size() == 1                                     , "stale handle cancelled a different timer" );
+  check( wheel.cancel( handle_c ) == core::result_t::eSuccess  , "cancel() reused node" );
+}
+
+/**
+ * Threads schedule and cancel timers while a single thread moves the wheel forward,
+ * each timer either expires or it is cancelled, exactly once.
+ */
+static void test_concurrent()
+{
+  constexpr uint64_t nthreads = 3;
+  constexpr uint64_t timers   = 20000;
+
+  timer_wheel_t            wheel;
+  std::atomic<uint64_t>    cancelled{0};
+  std::atomic<uint32_t>    running{nthreads};
+  std::vector<std::thread> threads;
+
+  for ( uint64_t tid = 0; tid < nthreads; ++tid )
+  {
+    threads.emplace_back( [&wheel,&cancelled,&running]() {
+      timer_wheel_t::handle_type handle;
+      for ( uint64_t ndx = 0; ndx < timers; ++ndx )
+      {
+        schedule( wheel, wheel.now() + ( ndx % 300 ), handle );
+        if ( ( ( ndx % 3 ) == 0 ) && ( wheel.cancel( handle ) == core::result_t::eSuccess ) )
+          ++cancelled;
+      }
+      --running;
+    } );
+  }
+
+  uint64_t fired = 0;
+  uint64_t curr  = 0;
+  while ( ( running.load() > 0 ) || !wheel.empty() )
+  { fired += wheel.expire( ++curr, []( uint64_t& ) {} ); }
+
+  for ( auto& thread : threads )
+  { thread.join(); }
+
+  check( fired + cancelled.load() == nthreads * timers         , "concurrent schedule()/cancel() and expire()" );
+}
+
+int main()
+{
+  test_expire();
+  test_cancel();
+  test_concurrent();
+
+  std::cout << "timer_wheel: all tests passed" << std::endl;
+
+  return 0;
+}
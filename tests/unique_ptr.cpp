@@ -1,8 +1,14 @@
 
 #include <iostream>
+#include <cstdlib>
+#include <thread>
 #include <assert.h>
 
 #include "core/unique_ptr.h"
+#include "core/arena_ptr.h"
+#include "core/arena_allocator.h"
+#include "arena_allocator.h"
+#include "check.h"
 
 class test_unique_ptr
 {
@@ -22,6 +28,163 @@ public:
   const std::string _text;
 };
 
+/**
+ * Deleter counting objects released through it.
+ */
+struct counting_delete
+{
+  static inline uint32_t calls = 0;
+
+  template<typename data_t>
+  static constexpr inline void destroy( data_t* ptr ) noexcept
+  { 
+    ++calls;
+    delete ptr; 
+  }
+};
+
+/**
+ * Object allocated from arenas, counting destructors.
+ */
+struct arena_item_t
+{
+  static inline uint32_t destroyed = 0;
+
+  arena_item_t( uint64_t v )
+    : value(v)
+  {}
+
+  ~arena_item_t()
+  { ++destroyed; }
+
+  uint64_t value;
+};
+
+using core_arena_t = core::arena_allocator<arena_item_t,uint32_t,16,16>;
+using lf_arena_t   = lock_free::arena_allocator<arena_item_t,uint32_t,16,16>;
+
+/**
+ * deleter_t is invoked once when the owning pointer goes out of scope, and never for released
+ * or not auto_delete pointers.
+ */
+static void test_custom_deleter()
+{
+  using ptr_t = core::unique_ptr<test_unique_ptr,counting_delete>;
+
+  counting_delete::calls = 0;
+  {
+    ptr_t ptr0 = new test_unique_ptr( "custom deleter" );
+    ptr_t ptr1 = std::move(ptr0);
+    check( ptr0.get() == nullptr && ptr1.get() != nullptr      , "custom deleter, move constructor" );
+
+    ptr_t ptr2;
+    ptr2 = std::move(ptr1);
+    check( ptr1.get() == nullptr && ptr2.auto_delete()         , "custom deleter, move assignment" );
+  }
+  check( counting_delete::calls == 1                           , "custom deleter invoked once" );
+
+  test_unique_ptr* raw = nullptr;
+  {
+    ptr_t ptr = new test_unique_ptr( "custom deleter, released" );
+    raw = ptr.release();
+    check( ptr.get() == nullptr && !ptr.auto_delete()          , "release()" );
+  }
+  check( counting_delete::calls == 1                           , "custom deleter invoked on a released pointer" );
+
+  {
+    ptr_t ptr( raw, false );
+    check( ptr.get() == raw && !ptr.auto_delete()              , "pointer without auto_delete" );
+  }
+  check( counting_delete::calls == 1                           , "custom deleter invoked without auto_delete" );
+  delete raw;
+}
+
+/**
+ * Objects allocated with make_arena_ptr() go back to the arena exactly once, and handles
+ * resolve to the same object while it is allocated.
+ */
+template<typename arena_t>
+static void test_arena_ptr()
+{
+  using ptr_t    = core::arena_ptr<arena_item_t,arena_t>;
+  using handle_t = core::arena_handle<arena_t>;
+
+  static_assert( sizeof(ptr_t) == sizeof(void*) );
+
+  arena_t  arena;
+  arena_item_t::destroyed = 0;
+
+  {
+    ptr_t ptr0 = core::make_arena_ptr( arena, 7 );
+    check( ptr0.get() != nullptr && ptr0->value == 7           , "make_arena_ptr()" );
+    check( arena.length() == 1                                 , "make_arena_ptr(), arena length" );
+
+    handle_t handle( arena, ptr0.get() );
+    check( (bool)handle && handle.get( arena ) == ptr0.get()   , "arena_handle round trip" );
+    check( handle_t( handle.value() ) == handle                , "arena_handle from value()" );
+    check( arena.from_handle( arena.to_handle( ptr0.get() ) ) == ptr0.get(), "to_handle()/from_handle() round trip" );
+
+    ptr_t ptr1 = std::move(ptr0);
+    check( ptr0.get() == nullptr && ptr1->value == 7           , "arena_ptr move" );
+    check( arena.length() == 1                                 , "arena_ptr move, arena length" );
+  }
+  check( arena.length() == 0 && arena_item_t::destroyed == 1   , "arena_ptr returned to the arena once" );
+
+  {
+    ptr_t         ptr = core::make_arena_ptr( arena, 8 );
+    arena_item_t* raw = ptr.release();
+    check( arena.length() == 1                                 , "arena_ptr release()" );
+    check( arena_t::deallocate( raw ) == core::result_t::eSuccess, "deallocate() a released arena_ptr" );
+  }
+  check( arena.length() == 0 && arena_item_t::destroyed == 2   , "released arena_ptr not deallocated again" );
+
+  // pointers not owned by the arena have no handle.
+  arena_t      other;
+  ptr_t        foreign = core::make_arena_ptr( other, 9 );
+  arena_item_t local( 10 );
+  check( arena.to_handle( foreign.get() ) == arena_t::null_handle, "to_handle() of a different arena" );
+  check( arena.to_handle( &local ) == arena_t::null_handle     , "to_handle() of a pointer not from an arena" );
+  check( arena.to_handle( nullptr ) == arena_t::null_handle    , "to_handle( nullptr )" );
+  check( handle_t().get( arena ) == nullptr && !handle_t()     , "empty arena_handle" );
+  check( arena.from_handle( arena_t::null_handle ) == nullptr  , "from_handle( null_handle )" );
+}
+
+/**
+ * Handles of chunks released by shrink_to() or clear() resolve to nullptr.
+ */
+template<typename arena_t>
+static void test_stale_handle()
+{
+  using handle_t = core::arena_handle<arena_t>;
+
+  constexpr uint32_t items = 64;
+
+  arena_t        arena;
+  arena_item_t*  ptrs[items];
+  handle_t       handles[items];
+
+  // allocate() retried while the arena is waiting for a new chunk.
+  for ( uint32_t ndx = 0; ndx < items; ++ndx )
+  {
+    ptrs[ndx]    = retry( [&]() { return arena.allocate( ndx ); } );
+    handles[ndx] = handle_t( arena, ptrs[ndx] );
+    check( handles[ndx].get( arena ) == ptrs[ndx]              , "handle of an allocated object" );
+  }
+
+  for ( uint32_t ndx = 0; ndx < items; ++ndx )
+  { check( arena_t::deallocate( ptrs[ndx] ) == core::result_t::eSuccess, "deallocate()" ); }
+
+  check( arena.shrink_to( 0 ) > 0                              , "shrink_to() release grown chunks" );
+
+  uint32_t stale = 0;
+  for ( uint32_t ndx = 0; ndx < items; ++ndx )
+  { stale += ( handles[ndx].get( arena ) == nullptr )?1:0; }
+  check( stale > 0 && stale < items                            , "handles of released chunks" );
+
+  arena.clear();
+  for ( uint32_t ndx = 0; ndx < items; ++ndx )
+  { check( handles[ndx].get( arena ) == nullptr, "handle after clear()" ); }
+}
 
 int main()
 {
@@ -66,5 +229,15 @@ int main()
   assert( _ptr4.get() == nullptr );
   assert( _ptr5.get() != nullptr );
 
+  test_custom_deleter();
+
+  test_arena_ptr<core_arena_t>();
+  test_arena_ptr<lf_arena_t>();
+
+  test_stale_handle<core_arena_t>();
+  test_stale_handle<lf_arena_t>();
+
+  std::cout << "unique_ptr: all tests passed" << std::endl;
+
   return 0;
 }
\ No newline at end of file